@@ -11,6 +11,8 @@
 
 #include "shader.h"
 #include "texture.h"
+#include "mesh_base.h"
+#include "mesh_cache.h"
 
 // Edit by: Samuel Zaprazny
 // Adding assimp library
@@ -20,21 +22,7 @@
 
 namespace ppgso {
 
-    class Mesh_Assimp {
-        struct gl_buffer {
-        public:
-            GLuint vao, vbo, tbo, nbo, ibo = 0;
-            GLsizei size = 0;
-        };
-
-        std::vector<gl_buffer> buffers;
-        const aiScene * scene;
-
-        // Loaded materials
-        std::vector<glm::vec3> ambient;
-        std::vector<glm::vec3> diffuse;
-        std::vector<glm::vec3> specular;
-
+    class Mesh_Assimp : public MeshBase {
     public:
 
         /*!
@@ -45,20 +33,39 @@ namespace ppgso {
          * vec2 TexCoord - Texture coordinate, position 1
          * vec3 Normal - Normal vector, position 2
          *
+         * Geometry is read from the binary mesh cache when it is up to date, see MeshCache.
+         *
          * @param obj - File path to the obj file to load.
          */
         Mesh_Assimp(const std::string &obj);
 
-        ~Mesh_Assimp();
-
-        void processNode(aiNode *node, const aiScene *pScene);
+        /*!
+         * Upload already decoded geometry, see decode(). Must be called on the thread owning the OpenGL context.
+         *
+         * @param data - Geometry to upload.
+         * @param format - Vertex layout, VertexFormat::Compact requires a shader decoding it, see MeshBase.
+         */
+        explicit Mesh_Assimp(const MeshData &data, VertexFormat format = VertexFormat::Float);
 
-        void processMesh(aiMesh *mesh);
+        /*!
+         * Decode a mesh file into CPU side geometry using the mesh cache.
+         * Does not touch OpenGL, so it is safe to call from worker threads.
+         *
+         * @param obj - File path to the obj file to load.
+         * @return - Decoded geometry.
+         */
+        static MeshData decode(const std::string &obj);
 
         /*!
-         * Render the geometry associated with the mesh using glDrawElements.
+         * Import a mesh file into CPU side geometry, bypassing the mesh cache.
+         *
+         * @param obj - File path to the obj file to load.
+         * @return - Decoded geometry.
          */
-        void render();
+        static MeshData import(const std::string &obj);
+
+        static void processNode(aiNode *node, const aiScene *pScene, MeshData &data);
+
+        static void processMesh(aiMesh *mesh, MeshData &data);
     };
 }
-
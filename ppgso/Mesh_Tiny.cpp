@@ -2,16 +2,32 @@
 #include <sstream>
 
 #include "Mesh_Tiny.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
 
 ppgso::Mesh_Tiny::Mesh_Tiny(const std::string &obj_file) {
 #ifdef DEBBUG_MODE
     std::cout << "Using Tiny Obj Loader!" << std::endl;
 #endif
 
-  // Load OBJ file
-  shapes.clear();
-  materials.clear();
-  std::string err = tinyobj::LoadObj(shapes, materials, obj_file.c_str());
+  // Load OBJ file or its cached geometry and initialize OpenGL Buffers
+  upload(decode(obj_file));
+}
+
+ppgso::Mesh_Tiny::Mesh_Tiny(const MeshData &data, VertexFormat format) {
+  upload(data, format);
+}
+
+ppgso::MeshData ppgso::Mesh_Tiny::decode(const std::string &obj_file) {
+  return MeshCache::load(obj_file, [&obj_file]() { return import(obj_file); });
+}
+
+ppgso::MeshData ppgso::Mesh_Tiny::import(const std::string &obj_file) {
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  // Large files are tokenized on several threads
+  std::string err = tinyobj::LoadObjParallel(shapes, materials, obj_file.c_str());
 
   if (!err.empty()) {
     std::stringstream msg;
@@ -19,73 +35,21 @@ ppgso::Mesh_Tiny::Mesh_Tiny(const std::string &obj_file) {
     throw std::runtime_error(msg.str());
   }
 
-  // Initialize OpenGL Buffers
-  for(auto& shape : shapes) {
-    gl_buffer buffer;
-
-    if(!shape.mesh.positions.empty()) {
-      // Generate a vertex array object
-      glGenVertexArrays(1, &buffer.vao);
-      glBindVertexArray(buffer.vao);
-
-      // Generate and upload a buffer with vertex positions to GPU
-      glGenBuffers(1, &buffer.vbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.positions.size() * sizeof(float), shape.mesh.positions.data(),
-                   GL_STATIC_DRAW);
-
-      // Bind the buffer to "Position" attribute in program
-      glEnableVertexAttribArray(0);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
-
-    if(!shape.mesh.texcoords.empty()) {
-      // Generate and upload a buffer with texture coordinates to GPU
-      glGenBuffers(1, &buffer.tbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.tbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.texcoords.size() * sizeof(float), shape.mesh.texcoords.data(),
-                   GL_STATIC_DRAW);
-
-      glEnableVertexAttribArray(1);
-      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
-
-    if(!shape.mesh.normals.empty()) {
-      // Generate and upload a buffer with texture coordinates to GPU
-      glGenBuffers(1, &buffer.nbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.nbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.normals.size() * sizeof(float), shape.mesh.normals.data(),
-                   GL_STATIC_DRAW);
-
-      glEnableVertexAttribArray(2);
-      glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
-
-    // Generate and upload a buffer with indices to GPU
-    glGenBuffers(1, &buffer.ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, shape.mesh.indices.size() * sizeof(unsigned int), shape.mesh.indices.data(), GL_STATIC_DRAW);
-    buffer.size = (GLsizei) shape.mesh.indices.size();
-
-    // Copy it to the end of the buffers vector
-    buffers.push_back(buffer);
-  }
-}
-
-ppgso::Mesh_Tiny::~Mesh_Tiny() {
-  for(auto& buffer : buffers) {
-    glDeleteBuffers(1, &buffer.ibo);
-    glDeleteBuffers(1, &buffer.nbo);
-    glDeleteBuffers(1, &buffer.tbo);
-    glDeleteBuffers(1, &buffer.vbo);
-    glDeleteVertexArrays(1, &buffer.vao);
-  }
-}
-
-void ppgso::Mesh_Tiny::render() {
-  for(auto& buffer : buffers) {
-    // Draw object
-    glBindVertexArray(buffer.vao);
-    glDrawElements(GL_TRIANGLES, buffer.size, GL_UNSIGNED_INT, nullptr);
+  // Take over the parsed vectors without copying
+  MeshData data;
+  data.shapes.resize(shapes.size());
+  for (size_t i = 0; i < shapes.size(); i++) {
+    auto &mesh = shapes[i].mesh;
+    auto &shape = data.shapes[i];
+    shape.positions = std::move(mesh.positions);
+    shape.texcoords = std::move(mesh.texcoords);
+    shape.normals = std::move(mesh.normals);
+    shape.indices = std::move(mesh.indices);
+    // Reorder for vertex cache, overdraw and vertex fetch and group into meshlets, the result ends up in the mesh cache
+    optimizeShape(shape);
+    buildMeshlets(shape);
+    shape.computeBounds();
+    generateLods(shape);
   }
+  return data;
 }
@@ -12,19 +12,12 @@
 #include "shader.h"
 #include "texture.h"
 #include "tiny_obj_loader.h"
+#include "mesh_base.h"
+#include "mesh_cache.h"
 
 namespace ppgso {
 
-  class Mesh_Tiny {
-    struct gl_buffer {
-    public:
-      GLuint vao, vbo, tbo, nbo, ibo = 0;
-      GLsizei size = 0;
-    };
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::vector<gl_buffer> buffers;
-
+  class Mesh_Tiny : public MeshBase {
   public:
 
     /*!
@@ -35,16 +28,35 @@ namespace ppgso {
      * vec2 TexCoord - Texture coordinate, position 1
      * vec3 Normal - Normal vector, position 2
      *
+     * Geometry is read from the binary mesh cache when it is up to date, see MeshCache.
+     *
      * @param obj - File path to the obj file to load.
      */
     Mesh_Tiny(const std::string &obj);
 
-    ~Mesh_Tiny();
+    /*!
+     * Upload already decoded geometry, see decode(). Must be called on the thread owning the OpenGL context.
+     *
+     * @param data - Geometry to upload.
+     * @param format - Vertex layout, VertexFormat::Compact requires a shader decoding it, see MeshBase.
+     */
+    explicit Mesh_Tiny(const MeshData &data, VertexFormat format = VertexFormat::Float);
 
     /*!
-     * Render the geometry associated with the mesh using glDrawElements.
+     * Decode a Wavefront .obj file into CPU side geometry using the mesh cache.
+     * Does not touch OpenGL, so it is safe to call from worker threads.
+     *
+     * @param obj - File path to the obj file to load.
+     * @return - Decoded geometry.
      */
-    void render();
+    static MeshData decode(const std::string &obj);
+
+    /*!
+     * Parse a Wavefront .obj file into CPU side geometry, bypassing the mesh cache.
+     *
+     * @param obj - File path to the obj file to load.
+     * @return - Decoded geometry.
+     */
+    static MeshData import(const std::string &obj);
   };
 }
-
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+#include "asset_pack.h"
+#include "hash.h"
+#include "lz_block.h"
+#include "mesh_cache.h"
+#include "texture_cache.h"
+
+namespace fs = std::filesystem;
+
+namespace ppgso {
+
+  // On-disk layout: header, entry data 16 byte aligned, table of contents sorted by name hash, then the names
+  static const char PACK_MAGIC[4] = {'P', 'P', 'G', 'A'};
+  static const uint32_t PACK_VERSION = 2;
+  static const uint32_t CHUNK_SIZE = 256 * 1024;
+  static const uint32_t STORED_CHUNK = 0x80000000u;    // Chunk size flag, chunk kept uncompressed
+
+  struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t chunkSize;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+  };
+  static_assert(sizeof(PackHeader) == 40, "Unexpected asset pack header size");
+
+  // Compressed entries start with a table of chunk sizes followed by the chunks
+  struct AssetPack::Entry {
+    uint64_t nameHash;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t type;
+    uint32_t chunkCount;        // 0 when stored uncompressed
+    uint32_t width;             // Images and textures only
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;              // Uncompressed size
+    uint64_t storedSize;        // Size in the pack including the chunk table
+  };
+
+  struct AssetPackWriter::Record {
+    AssetPack::Entry entry;
+    std::string name;
+  };
+
+  static uint64_t align16(uint64_t offset) {
+    return (offset + 15) & ~uint64_t{15};
+  }
+
+  static uint64_t nameHash(const std::string &name) {
+    return hash64(name.data(), name.size());
+  }
+
+  static std::runtime_error packError(const std::string &message, const std::string &detail) {
+    std::stringstream msg;
+    msg << "AssetPack: " << message << " " << detail;
+    return std::runtime_error(msg.str());
+  }
+
+  AssetPack::AssetPack(std::unique_ptr<MappedFile> file) : file{std::move(file)} {
+    static_assert(sizeof(Entry) == 56, "Unexpected asset pack entry size");
+  }
+
+  std::shared_ptr<AssetPack> AssetPack::open(const std::string &path) {
+    auto file = std::make_unique<MappedFile>(path);
+    auto data = file->data();
+    auto size = (uint64_t) file->size();
+
+    PackHeader header;
+    if (size < sizeof(header)) throw packError("File too small.", path);
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, PACK_MAGIC, 4) != 0 || header.version != PACK_VERSION)
+      throw packError("Unsupported format or version.", path);
+
+    uint64_t tocSize = (uint64_t) header.entryCount * sizeof(Entry);
+    if (header.tocOffset % 8 != 0 || header.tocOffset + tocSize > size || header.namesOffset + header.namesSize > size ||
+        header.chunkSize == 0)
+      throw packError("Truncated table of contents.", path);
+
+    auto pack = std::shared_ptr<AssetPack>(new AssetPack(std::move(file)));
+    pack->entries = (const Entry *) (data + header.tocOffset);
+    pack->entryCount = header.entryCount;
+    pack->names = (const char *) (data + header.namesOffset);
+    pack->chunkSize = header.chunkSize;
+
+    // Validate once so lookups can trust the table
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+      auto &entry = pack->entries[i];
+      uint64_t chunks = entry.chunkCount;
+      bool valid = (uint64_t) entry.nameOffset + entry.nameLength <= header.namesSize &&
+                   entry.offset % 16 == 0 && entry.offset + entry.storedSize <= size &&
+                   (chunks ? chunks == (entry.size + header.chunkSize - 1) / header.chunkSize &&
+                             chunks * sizeof(uint32_t) <= entry.storedSize
+                           : entry.storedSize == entry.size) &&
+                   (i == 0 || pack->entries[i - 1].nameHash <= entry.nameHash);
+      if (!valid) throw packError("Corrupted table of contents.", path);
+    }
+    return pack;
+  }
+
+  const AssetPack::Entry *AssetPack::find(const std::string &name, Type type) const {
+    uint64_t hash = nameHash(name);
+    auto end = entries + entryCount;
+    auto it = std::lower_bound(entries, end, hash, [](const Entry &entry, uint64_t value) {
+      return entry.nameHash < value;
+    });
+    for (; it != end && it->nameHash == hash; ++it) {
+      if (it->type == (uint32_t) type && it->nameLength == name.size() &&
+          std::memcmp(names + it->nameOffset, name.data(), name.size()) == 0)
+        return it;
+    }
+    return nullptr;
+  }
+
+  bool AssetPack::contains(const std::string &name, Type type) const {
+    return find(name, type) != nullptr;
+  }
+
+  std::vector<std::string> AssetPack::list(Type type, const std::string &prefix) const {
+    std::vector<std::string> result;
+    for (uint32_t i = 0; i < entryCount; i++) {
+      auto &entry = entries[i];
+      if (entry.type != (uint32_t) type || entry.nameLength < prefix.size()) continue;
+      if (std::memcmp(names + entry.nameOffset, prefix.data(), prefix.size()) != 0) continue;
+      result.emplace_back(names + entry.nameOffset, entry.nameLength);
+    }
+    return result;
+  }
+
+  void AssetPack::read(const Entry &entry, uint8_t *out) const {
+    auto data = file->data() + entry.offset;
+    if (!entry.chunkCount) {
+      std::memcpy(out, data, entry.size);
+      return;
+    }
+
+    auto chunkSizes = (const uint32_t *) data;
+    uint64_t in = entry.chunkCount * sizeof(uint32_t);
+    for (uint32_t c = 0; c < entry.chunkCount; c++) {
+      uint64_t first = (uint64_t) c * chunkSize;
+      uint64_t bytes = std::min<uint64_t>(chunkSize, entry.size - first);
+      uint64_t stored = chunkSizes[c] & ~STORED_CHUNK;
+      bool valid = in + stored <= entry.storedSize;
+      if (valid && (chunkSizes[c] & STORED_CHUNK)) {
+        valid = stored == bytes;
+        if (valid) std::memcpy(out + first, data + in, bytes);
+      } else if (valid) {
+        valid = decompressBlock(data + in, stored, out + first, bytes);
+      }
+      if (!valid) throw packError("Corrupted entry.", std::string(names + entry.nameOffset, entry.nameLength));
+      in += stored;
+    }
+  }
+
+  MeshData AssetPack::loadMesh(const std::string &name) const {
+    auto entry = find(name, Type::Mesh);
+    if (!entry) throw packError("Mesh not found.", name);
+
+    MeshData data;
+    const uint8_t *image = file->data() + entry->offset;
+    if (entry->chunkCount) {
+      auto buffer = std::make_shared<std::vector<uint8_t>>(entry->size);
+      read(*entry, buffer->data());
+      image = buffer->data();
+      data.storage = buffer;
+    } else {
+      data.storage = shared_from_this();
+    }
+    if (!MeshCache::parse(image, entry->size, data.storedShapes)) throw packError("Corrupted mesh.", name);
+    return data;
+  }
+
+  Image AssetPack::loadImage(const std::string &name) const {
+    auto entry = find(name, Type::Image);
+    if (!entry) throw packError("Image not found.", name);
+    if (entry->size != (uint64_t) entry->width * entry->height * sizeof(Image::Pixel))
+      throw packError("Corrupted image.", name);
+
+    // Uncompressed pixels are used straight from the mapping, which the image keeps alive
+    if (!entry->chunkCount)
+      return {(int) entry->width, (int) entry->height, (const Image::Pixel *) (file->data() + entry->offset),
+              shared_from_this()};
+
+    Image image{(int) entry->width, (int) entry->height};
+    read(*entry, (uint8_t *) image.getFramebuffer().data());
+    return image;
+  }
+
+  CompressedImage AssetPack::loadTexture(const std::string &name) const {
+    auto entry = find(name, Type::Texture);
+    if (!entry) throw packError("Texture not found.", name);
+
+    std::shared_ptr<const void> storage = shared_from_this();
+    const uint8_t *data = file->data() + entry->offset;
+    if (entry->chunkCount) {
+      auto buffer = std::make_shared<std::vector<uint8_t>>(entry->size);
+      read(*entry, buffer->data());
+      data = buffer->data();
+      storage = buffer;
+    }
+
+    auto image = TextureCache::parse(data, entry->size, std::move(storage));
+    if (!image || image->width != (int) entry->width || image->height != (int) entry->height)
+      throw packError("Corrupted texture.", name);
+    return *image;
+  }
+
+  std::string AssetPack::loadMaterial(const std::string &name) const {
+    auto entry = find(name, Type::Material);
+    if (!entry) throw packError("Material not found.", name);
+
+    std::string source(entry->size, '\0');
+    read(*entry, (uint8_t *) &source[0]);
+    return source;
+  }
+
+  size_t AssetPack::size() const {
+    return file->size();
+  }
+
+  AssetPackWriter::AssetPackWriter(const std::string &path, bool compress)
+          : path{path}, tmpPath{path + ".tmp"}, compress{compress} {
+    out.open(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) throw packError("Could not create pack.", tmpPath);
+
+    // Placeholder, the real header is written by finish()
+    PackHeader header = {};
+    out.write((const char *) &header, sizeof(header));
+    offset = sizeof(header);
+  }
+
+  AssetPackWriter::~AssetPackWriter() {
+    if (finished) return;
+    out.close();
+    std::error_code ec;
+    fs::remove(tmpPath, ec);
+  }
+
+  void AssetPackWriter::addMesh(const std::string &name, const MeshData &data) {
+    auto image = MeshCache::serialize(data.views());
+    add(name, AssetPack::Type::Mesh, 0, 0, image.data(), image.size());
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.meshes++;
+  }
+
+  void AssetPackWriter::addImage(const std::string &name, const Image &image) {
+    add(name, AssetPack::Type::Image, (uint32_t) image.width, (uint32_t) image.height,
+        (const uint8_t *) image.data(), (size_t) image.width * image.height * sizeof(Image::Pixel));
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.images++;
+  }
+
+  void AssetPackWriter::addTexture(const std::string &name, const CompressedImage &image) {
+    auto data = TextureCache::serialize(image);
+    add(name, AssetPack::Type::Texture, (uint32_t) image.width, (uint32_t) image.height, data.data(), data.size());
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.textures++;
+  }
+
+  void AssetPackWriter::addMaterial(const std::string &name, const std::string &source) {
+    add(name, AssetPack::Type::Material, 0, 0, (const uint8_t *) source.data(), source.size());
+    std::lock_guard<std::mutex> lock{mutex};
+    stats.materials++;
+  }
+
+  void AssetPackWriter::add(const std::string &name, AssetPack::Type type, uint32_t width, uint32_t height,
+                            const uint8_t *data, size_t size) {
+    AssetPack::Entry entry = {};
+    entry.nameHash = nameHash(name);
+    entry.type = (uint32_t) type;
+    entry.width = width;
+    entry.height = height;
+    entry.size = size;
+    entry.storedSize = size;
+
+    // Chunk table followed by the chunks, kept only when the entry as a whole gets smaller
+    std::vector<uint8_t> packed;
+    if (compress && size > 0) {
+      uint32_t chunks = (uint32_t) ((size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+      std::vector<uint32_t> chunkSizes(chunks);
+      packed.resize(chunks * sizeof(uint32_t));
+      for (uint32_t c = 0; c < chunks; c++) {
+        size_t first = (size_t) c * CHUNK_SIZE;
+        size_t bytes = std::min<size_t>(CHUNK_SIZE, size - first);
+        size_t compressed = compressBlock(data + first, bytes, packed);
+        if (compressed >= bytes) {
+          packed.resize(packed.size() - compressed);
+          packed.insert(packed.end(), data + first, data + first + bytes);
+          chunkSizes[c] = (uint32_t) bytes | STORED_CHUNK;
+        } else {
+          chunkSizes[c] = (uint32_t) compressed;
+        }
+      }
+      std::memcpy(packed.data(), chunkSizes.data(), chunks * sizeof(uint32_t));
+      if (packed.size() < size) {
+        entry.chunkCount = chunks;
+        entry.storedSize = packed.size();
+        data = packed.data();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (finished) throw packError("Adding to a finished pack.", name);
+
+    static const char zeros[16] = {};
+    uint64_t start = align16(offset);
+    out.write(zeros, (std::streamsize) (start - offset));
+    out.write((const char *) data, (std::streamsize) entry.storedSize);
+    if (!out) throw packError("Could not write pack.", tmpPath);
+    offset = start + entry.storedSize;
+
+    entry.offset = start;
+    entry.nameOffset = (uint32_t) names.size();
+    entry.nameLength = (uint32_t) name.size();
+    names += name;
+    records.push_back({entry, name});
+    stats.bytes += entry.size;
+    stats.storedBytes += entry.storedSize;
+  }
+
+  void AssetPackWriter::finish() {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (finished) return;
+
+    std::sort(records.begin(), records.end(), [](const Record &a, const Record &b) {
+      return a.entry.nameHash != b.entry.nameHash ? a.entry.nameHash < b.entry.nameHash : a.name < b.name;
+    });
+    for (size_t i = 1; i < records.size(); i++) {
+      auto &a = records[i - 1], &b = records[i];
+      if (a.name == b.name && a.entry.type == b.entry.type) throw packError("Duplicate asset.", b.name);
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.entryCount = (uint32_t) records.size();
+    header.chunkSize = CHUNK_SIZE;
+    header.tocOffset = align16(offset);
+    header.namesOffset = header.tocOffset + records.size() * sizeof(AssetPack::Entry);
+    header.namesSize = names.size();
+
+    static const char zeros[16] = {};
+    out.write(zeros, (std::streamsize) (header.tocOffset - offset));
+    for (auto &record : records) out.write((const char *) &record.entry, sizeof(record.entry));
+    out.write(names.data(), (std::streamsize) names.size());
+    out.seekp(0);
+    out.write((const char *) &header, sizeof(header));
+    out.close();
+    if (!out) throw packError("Could not write pack.", tmpPath);
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) throw packError("Could not move pack into place.", path);
+    finished = true;
+  }
+
+  AssetPackWriter::Stats AssetPackWriter::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+  }
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "compressed_image.h"
+#include "image.h"
+#include "mapped_file.h"
+#include "mesh_data.h"
+
+namespace ppgso {
+
+  /*!
+   * Single file pack of baked assets, mapped into memory once and resolved by name through a sorted table of contents.
+   *
+   * Meshes are stored in the mesh cache layout after the full import pipeline, images as the decoded RGB framebuffer,
+   * textures with all their mipmaps in the TextureCache layout and MTL material libraries as their source text, so
+   * loading involves neither directory iteration nor parsing nor opening further files. Uncompressed meshes and
+   * textures are used straight from the mapping. Compressed entries are split into chunks, each either LZ4 compressed
+   * or stored when compression does not pay off, see compressBlock. Names are relative paths with forward slashes,
+   * for example "Collection/chairs/chair.obj". Packs are written by AssetPackWriter, usually through the ppgso_bake tool.
+   */
+  class AssetPack : public std::enable_shared_from_this<AssetPack> {
+  public:
+    enum class Type : uint32_t {
+      Mesh = 1,
+      Image = 2,
+      Material = 3,
+      Texture = 4
+    };
+
+    /*!
+     * Map a pack and validate its table of contents.
+     *
+     * @param path - Path to the pack file.
+     * @return - Opened pack, asset views keep it mapped.
+     */
+    static std::shared_ptr<AssetPack> open(const std::string &path);
+
+    /*!
+     * Check whether the pack contains an asset.
+     *
+     * @param name - Asset name.
+     * @param type - Asset type.
+     * @return - True when found.
+     */
+    bool contains(const std::string &name, Type type) const;
+
+    /*!
+     * List asset names in table of contents order, which is not alphabetical.
+     *
+     * @param type - Asset type to list.
+     * @param prefix - Only names starting with the prefix are returned.
+     * @return - Asset names.
+     */
+    std::vector<std::string> list(Type type, const std::string &prefix = "") const;
+
+    /*!
+     * Get mesh geometry, pointing into the mapping unless it has to be decompressed. Safe to call from worker threads.
+     *
+     * @param name - Asset name.
+     * @return - Geometry, keeps the pack alive.
+     */
+    MeshData loadMesh(const std::string &name) const;
+
+    /*!
+     * Get a decoded image. Safe to call from worker threads.
+     * Uncompressed images wrap the mapped pixels without copying and keep the pack alive, see Image.
+     *
+     * @param name - Asset name.
+     * @return - Image in the same orientation as loadBMP returns it.
+     */
+    Image loadImage(const std::string &name) const;
+
+    /*!
+     * Get a texture with its mipmaps, block compressed or RGB8. Safe to call from worker threads.
+     * Uncompressed entries wrap the mapped levels without copying and keep the pack alive.
+     *
+     * @param name - Asset name, the path of the source image.
+     * @return - Texture levels ready for upload.
+     */
+    CompressedImage loadTexture(const std::string &name) const;
+
+    /*!
+     * Get the source of an MTL material library. Safe to call from worker threads.
+     *
+     * @param name - Asset name.
+     * @return - MTL text.
+     */
+    std::string loadMaterial(const std::string &name) const;
+
+    /*!
+     * Get size of the pack file.
+     *
+     * @return - Size in bytes.
+     */
+    size_t size() const;
+
+  private:
+    friend class AssetPackWriter;
+    struct Entry;
+
+    AssetPack(std::unique_ptr<MappedFile> file);
+    const Entry *find(const std::string &name, Type type) const;
+    void read(const Entry &entry, uint8_t *out) const;
+
+    std::unique_ptr<MappedFile> file;
+    const Entry *entries = nullptr;
+    uint32_t entryCount = 0;
+    const char *names = nullptr;
+    uint32_t chunkSize = 0;
+  };
+
+  /*!
+   * Write assets into a new pack. Entries are appended as they are added and the table of contents follows them.
+   * The pack replaces the destination file only once finish() succeeds.
+   */
+  class AssetPackWriter {
+  public:
+    /*!
+     * Sizes of the entries written so far.
+     */
+    struct Stats {
+      size_t meshes = 0;
+      size_t images = 0;
+      size_t textures = 0;
+      size_t materials = 0;
+      uint64_t bytes = 0;               // Uncompressed asset data
+      uint64_t storedBytes = 0;         // Asset data as stored in the pack
+    };
+
+    /*!
+     * Start a new pack.
+     *
+     * @param path - Destination path, written to a temporary file next to it first.
+     * @param compress - Compress entries in chunks, trading load time for pack size.
+     */
+    AssetPackWriter(const std::string &path, bool compress);
+    AssetPackWriter(const AssetPackWriter &) = delete;
+    AssetPackWriter &operator=(const AssetPackWriter &) = delete;
+    ~AssetPackWriter();
+
+    /*!
+     * Add mesh geometry. Safe to call from several threads, compression runs outside the lock.
+     *
+     * @param name - Asset name, must be unique within the pack.
+     * @param data - Geometry to store.
+     */
+    void addMesh(const std::string &name, const MeshData &data);
+
+    /*!
+     * Add a decoded image. Safe to call from several threads, compression runs outside the lock.
+     *
+     * @param name - Asset name, must be unique within the pack.
+     * @param image - Image to store.
+     */
+    void addImage(const std::string &name, const Image &image);
+
+    /*!
+     * Add a texture with its mipmaps, block compressed or RGB8. Safe to call from several threads, compression runs outside the lock.
+     *
+     * @param name - Asset name, must be unique among textures within the pack.
+     * @param image - Texture to store with all its levels.
+     */
+    void addTexture(const std::string &name, const CompressedImage &image);
+
+    /*!
+     * Add an MTL material library. Safe to call from several threads, compression runs outside the lock.
+     *
+     * @param name - Asset name, must be unique within the pack.
+     * @param source - MTL text.
+     */
+    void addMaterial(const std::string &name, const std::string &source);
+
+    /*!
+     * Write the table of contents and move the pack to its destination.
+     */
+    void finish();
+
+    /*!
+     * Get sizes of the entries written so far.
+     *
+     * @return - Current statistics.
+     */
+    Stats getStats() const;
+
+  private:
+    struct Record;
+
+    void add(const std::string &name, AssetPack::Type type, uint32_t width, uint32_t height, const uint8_t *data,
+             size_t size);
+
+    std::string path;
+    std::string tmpPath;
+    bool compress;
+    bool finished = false;
+    std::ofstream out;
+    mutable std::mutex mutex;
+    std::vector<Record> records;
+    std::string names;
+    uint64_t offset = 0;
+    Stats stats;
+  };
+}
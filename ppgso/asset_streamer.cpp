@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "asset_streamer.h"
+
+namespace ppgso {
+
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Find the request with the lowest priority value, linear scan is fine for a few thousand assets
+  template<typename F>
+  std::list<AssetStreamer::Request>::iterator AssetStreamer::nearest(std::list<Request> &requests, F priority) {
+    auto best = requests.begin();
+    float bestPriority = 0.0f;
+    for (auto it = requests.begin(); it != requests.end(); ++it) {
+      float p = priority(*it);
+      if (it == requests.begin() || p < bestPriority) {
+        best = it;
+        bestPriority = p;
+      }
+    }
+    return best;
+  }
+
+  AssetStreamer::AssetStreamer(ThreadPool &pool) : pool{pool} {}
+
+  AssetStreamer::AssetStreamer(ThreadPool &pool, Budget budget) : budget{budget}, pool{pool} {}
+
+  AssetStreamer::~AssetStreamer() {
+    clear();
+  }
+
+  void AssetStreamer::request(std::function<Upload()> decode, std::function<float()> priority,
+                              std::function<void()> failed) {
+    if (startTime < 0.0) startTime = now();
+    Request request;
+    request.decode = std::move(decode);
+    request.priority = std::move(priority);
+    request.failed = std::move(failed);
+    queued.push_back(std::move(request));
+    stats.requested++;
+  }
+
+  void AssetStreamer::dispatch() {
+    // Keep the workers busy but leave the rest queued, so priorities are evaluated as late as possible
+    size_t slots = std::max(1u, pool.size()) * 2;
+    while (decoding.size() < slots && !queued.empty()) {
+      auto it = nearest(queued, [](Request &r) { return r.priority(); });
+      it->job = pool.submit(it->decode);
+      decoding.splice(decoding.end(), queued, it);
+    }
+  }
+
+  void AssetStreamer::fail(Request &request, const std::exception &e) {
+    std::cerr << "Asset streaming failed: " << e.what() << std::endl;
+    stats.failed++;
+    if (request.failed) request.failed();
+  }
+
+  size_t AssetStreamer::pump() {
+    // Collect finished decodes
+    for (auto it = decoding.begin(); it != decoding.end();) {
+      if (it->job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        ++it;
+        continue;
+      }
+      try {
+        it->upload = it->job.get();
+        decoded.splice(decoded.end(), decoding, it++);
+      } catch (std::exception &e) {
+        fail(*it, e);
+        it = decoding.erase(it);
+      }
+    }
+    dispatch();
+
+    // Commit nearest assets first until the budget is used up
+    size_t committed = 0;
+    size_t bytes = 0;
+    double start = now();
+    while (!decoded.empty()) {
+      auto it = nearest(decoded, [](Request &r) {
+        return r.upload.priority ? r.upload.priority() : r.priority();
+      });
+      if (committed > 0 && (bytes + it->upload.bytes > budget.bytesPerFrame || now() - start >= budget.secondsPerFrame))
+        break;
+
+      try {
+        if (it->upload.commit) it->upload.commit();
+        committed++;
+        bytes += it->upload.bytes;
+      } catch (std::exception &e) {
+        fail(*it, e);
+      }
+      decoded.erase(it);
+    }
+
+    if (committed > 0) {
+      double seconds = now() - start;
+      stats.committed += committed;
+      stats.bytes += bytes;
+      stats.frames++;
+      stats.commitSeconds += seconds;
+      stats.maxFrameSeconds = std::max(stats.maxFrameSeconds, seconds);
+    }
+    if (startTime >= 0.0 && idle()) {
+      stats.elapsedSeconds = now() - startTime;
+      startTime = -1.0;
+    }
+    return committed;
+  }
+
+  void AssetStreamer::clear() {
+    queued.clear();
+    for (auto &request : decoding) {
+      try {
+        request.job.get();
+      } catch (std::exception &) {
+        // Dropped anyway
+      }
+    }
+    decoding.clear();
+    decoded.clear();
+    startTime = -1.0;
+  }
+
+  bool AssetStreamer::idle() const {
+    return queued.empty() && decoding.empty() && decoded.empty();
+  }
+
+  size_t AssetStreamer::outstanding() const {
+    return queued.size() + decoding.size() + decoded.size();
+  }
+
+  AssetStreamer::Stats AssetStreamer::getStats() const {
+    return stats;
+  }
+
+  void AssetStreamer::printStats(std::ostream &out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2)
+        << "Streamed " << stats.committed << "/" << stats.requested << " assets (" << stats.failed << " failed, "
+        << stats.bytes / (1024.0 * 1024.0) << " MB) over " << stats.frames << " frames in "
+        << stats.elapsedSeconds * 1000.0 << " ms, commit " << stats.commitSeconds * 1000.0 << " ms total, "
+        << stats.maxFrameSeconds * 1000.0 << " ms max per frame" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
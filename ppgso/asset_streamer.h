@@ -0,0 +1,150 @@
+#pragma once
+#include <functional>
+#include <future>
+#include <list>
+#include <ostream>
+
+#include "thread_pool.h"
+
+namespace ppgso {
+
+  /*!
+   * Progressive asset loading spread over many frames.
+   *
+   * Requests are decoded on pool workers, nearest (lowest priority value) first. Decoded assets are committed to
+   * OpenGL by pump(), which the render loop calls once per frame on the context thread. Commits stop once the
+   * per-frame byte or time budget is used up, so streaming never stalls a frame for long.
+   */
+  class AssetStreamer {
+  public:
+    /*!
+     * Limits of the work done by a single pump().
+     * At least one decoded asset is committed per pump() even when it alone exceeds the budget.
+     */
+    struct Budget {
+      size_t bytesPerFrame = 8 * 1024 * 1024;
+      double secondsPerFrame = 0.002;
+    };
+
+    /*!
+     * Result of decoding a request, returned by the worker.
+     */
+    struct Upload {
+      size_t bytes = 0;                 // Size of the data committed to the GPU, counted against the budget
+      std::function<void()> commit;     // Creates the OpenGL objects, runs on the context thread
+      std::function<float()> priority;  // Optional, replaces the request priority once the asset is decoded
+    };
+
+    /*!
+     * Streaming counters.
+     */
+    struct Stats {
+      size_t requested = 0;
+      size_t committed = 0;
+      size_t failed = 0;
+      size_t bytes = 0;
+      size_t frames = 0;                // Frames in which at least one asset was committed
+      double commitSeconds = 0.0;
+      double maxFrameSeconds = 0.0;     // Longest time spent committing within one pump()
+      double elapsedSeconds = 0.0;      // From the first request until the queue drained
+    };
+
+    /*!
+     * Create streamer decoding on a pool with the default budget.
+     *
+     * @param pool - Worker pool used for decoding.
+     */
+    explicit AssetStreamer(ThreadPool &pool = ThreadPool::shared());
+
+    /*!
+     * Create streamer decoding on a pool.
+     *
+     * @param pool - Worker pool used for decoding.
+     * @param budget - Per frame commit budget.
+     */
+    AssetStreamer(ThreadPool &pool, Budget budget);
+
+    /*!
+     * Drop queued requests and wait for decodes still running on the pool.
+     */
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer &) = delete;
+    AssetStreamer &operator=(const AssetStreamer &) = delete;
+
+    /*!
+     * Queue an asset for streaming.
+     *
+     * @param decode - Runs on a worker thread, must not touch OpenGL.
+     * @param priority - Evaluated on the context thread when picking what to decode and commit next, lower is sooner.
+     * @param failed - Optional, runs on the context thread within pump() when the decode or the commit threw,
+     *                 e.g. to stop waiting for the asset or to fall back to another one.
+     */
+    void request(std::function<Upload()> decode, std::function<float()> priority,
+                 std::function<void()> failed = nullptr);
+
+    /*!
+     * Start decodes and commit decoded assets within the budget. Call once per frame on the context thread.
+     *
+     * @return - Number of assets committed.
+     */
+    size_t pump();
+
+    /*!
+     * Drop all requests and decoded assets which were not committed yet. Waits for running decodes.
+     */
+    void clear();
+
+    /*!
+     * Check whether every request was committed.
+     *
+     * @return - True when nothing is queued, decoding or waiting for commit.
+     */
+    bool idle() const;
+
+    /*!
+     * Get number of requests not committed yet.
+     *
+     * @return - Number of outstanding requests.
+     */
+    size_t outstanding() const;
+
+    /*!
+     * Get streaming counters.
+     *
+     * @return - Copy of current statistics.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print streaming counters.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+    Budget budget;
+
+  private:
+    struct Request {
+      std::function<Upload()> decode;
+      std::function<float()> priority;
+      std::function<void()> failed;
+      std::future<Upload> job;
+      Upload upload;
+    };
+
+    void dispatch();
+    void fail(Request &request, const std::exception &e);
+
+    template<typename F>
+    static std::list<Request>::iterator nearest(std::list<Request> &requests, F priority);
+
+    ThreadPool &pool;
+    std::list<Request> queued;
+    std::list<Request> decoding;
+    std::list<Request> decoded;
+    Stats stats;
+    double startTime = -1.0;
+  };
+}
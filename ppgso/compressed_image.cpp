@@ -0,0 +1,83 @@
+#include <algorithm>
+
+#include "compressed_image.h"
+#include "hash.h"
+
+ppgso::CompressedImage::CompressedImage(Format format, int width, int height, int levels)
+        : format{format}, width{width}, height{height}, levels{levels},
+          blocks(byteSize(format, width, height, levels)) {}
+
+ppgso::CompressedImage::CompressedImage(Format format, int width, int height, int levels, const uint8_t *blocks,
+                                        std::shared_ptr<const void> storage)
+        : format{format}, width{width}, height{height}, levels{levels}, wrapped{blocks}, storage{std::move(storage)} {}
+
+size_t ppgso::CompressedImage::blockBytes(Format format) {
+  switch (format) {
+    case Format::BC1:
+      return 8;
+    case Format::BC5:
+      return 16;
+    default:
+      return 48;
+  }
+}
+
+bool ppgso::CompressedImage::isBlockCompressed(Format format) {
+  return format != Format::RGB8;
+}
+
+int ppgso::CompressedImage::fullChain(int width, int height) {
+  int levels = 1;
+  while ((std::max(width, height) >> levels) > 0) levels++;
+  return levels;
+}
+
+size_t ppgso::CompressedImage::levelBytes(Format format, int width, int height) {
+  if (!isBlockCompressed(format)) return (size_t) width * height * 3;
+  return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+size_t ppgso::CompressedImage::byteSize(Format format, int width, int height, int levels) {
+  size_t bytes = 0;
+  for (int level = 0; level < levels; level++)
+    bytes += levelBytes(format, std::max(width >> level, 1), std::max(height >> level, 1));
+  return bytes;
+}
+
+int ppgso::CompressedImage::levelWidth(int level) const {
+  return std::max(width >> level, 1);
+}
+
+int ppgso::CompressedImage::levelHeight(int level) const {
+  return std::max(height >> level, 1);
+}
+
+size_t ppgso::CompressedImage::levelOffset(int level) const {
+  return byteSize(format, width, height, level);
+}
+
+const uint8_t *ppgso::CompressedImage::levelData(int level) const {
+  return data() + levelOffset(level);
+}
+
+uint8_t *ppgso::CompressedImage::levelData(int level) {
+  if (wrapped) {
+    blocks.assign(wrapped, wrapped + byteSize());
+    wrapped = nullptr;
+    storage.reset();
+  }
+  return blocks.data() + levelOffset(level);
+}
+
+const uint8_t *ppgso::CompressedImage::data() const {
+  return wrapped ? wrapped : blocks.data();
+}
+
+size_t ppgso::CompressedImage::byteSize() const {
+  return byteSize(format, width, height, levels);
+}
+
+uint64_t ppgso::CompressedImage::contentHash() const {
+  int header[] = {(int) format, width, height, levels};
+  return hash64(data(), byteSize(), hash64(header, sizeof(header)));
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ppgso {
+
+  /*!
+   * Image with its mipmaps in the layout uploaded to OpenGL, so textures need neither decoding nor mipmap generation.
+   *
+   * Block compressed formats store pixels in 4x4 blocks, RGB8 stores them one by one. Rows run from the top like in
+   * Image, the levels follow one another starting with the full size. RGB8 chains are built by image::buildMipChain,
+   * block compressed ones by image::compressBC, both are stored by TextureCache.
+   */
+  class CompressedImage {
+  public:
+    enum class Format : uint32_t {
+      BC1 = 1,                          // RGB in 8 bytes per block
+      BC5 = 2,                          // Two channels in 16 bytes per block, e.g. X and Y of normal maps
+      RGB8 = 3                          // Uncompressed RGB, 3 bytes per pixel
+    };
+
+    /*!
+     * Check whether the format stores pixels in blocks.
+     *
+     * @param format - Format to check.
+     * @return - True for BC formats.
+     */
+    static bool isBlockCompressed(Format format);
+
+    /*!
+     * Get number of levels of a full mipmap chain down to 1x1.
+     *
+     * @param width - Width of the first level in pixels.
+     * @param height - Height of the first level in pixels.
+     * @return - Number of levels including the first one.
+     */
+    static int fullChain(int width, int height);
+
+    /*!
+     * Create image with zeroed blocks.
+     *
+     * @param format - Block format.
+     * @param width - Width of the first level in pixels.
+     * @param height - Height of the first level in pixels.
+     * @param levels - Number of mipmap levels including the first one.
+     */
+    CompressedImage(Format format, int width, int height, int levels);
+
+    /*!
+     * Wrap blocks owned elsewhere, e.g. in a mapped asset pack, without copying them.
+     *
+     * @param format - Block format.
+     * @param width - Width of the first level in pixels.
+     * @param height - Height of the first level in pixels.
+     * @param levels - Number of mipmap levels including the first one.
+     * @param blocks - All levels, byteSize() of them.
+     * @param storage - Keeps the blocks alive for as long as the image wraps them.
+     */
+    CompressedImage(Format format, int width, int height, int levels, const uint8_t *blocks,
+                    std::shared_ptr<const void> storage);
+
+    /*!
+     * Get size of a single 4x4 block.
+     *
+     * @param format - Block format.
+     * @return - Size in bytes, for RGB8 the size of 16 pixels.
+     */
+    static size_t blockBytes(Format format);
+
+    /*!
+     * Get size of a level of the given size.
+     *
+     * @param format - Block format.
+     * @param width - Width of the level in pixels.
+     * @param height - Height of the level in pixels.
+     * @return - Size in bytes, partial blocks at the edges of compressed levels count as full ones.
+     */
+    static size_t levelBytes(Format format, int width, int height);
+
+    /*!
+     * Get size of all levels of an image.
+     *
+     * @param format - Block format.
+     * @param width - Width of the first level in pixels.
+     * @param height - Height of the first level in pixels.
+     * @param levels - Number of levels.
+     * @return - Size in bytes.
+     */
+    static size_t byteSize(Format format, int width, int height, int levels);
+
+    /*!
+     * Get width of a level.
+     *
+     * @param level - Mipmap level, 0 is the full size.
+     * @return - Width in pixels, at least 1.
+     */
+    int levelWidth(int level) const;
+
+    /*!
+     * Get height of a level.
+     *
+     * @param level - Mipmap level, 0 is the full size.
+     * @return - Height in pixels, at least 1.
+     */
+    int levelHeight(int level) const;
+
+    /*!
+     * Get read-only access to the blocks of a level.
+     *
+     * @param level - Mipmap level, 0 is the full size.
+     * @return - Pointer to levelBytes() of the level.
+     */
+    const uint8_t *levelData(int level) const;
+
+    /*!
+     * Get write access to the blocks of a level. Copies wrapped blocks first.
+     *
+     * @param level - Mipmap level, 0 is the full size.
+     * @return - Pointer to levelBytes() of the level.
+     */
+    uint8_t *levelData(int level);
+
+    /*!
+     * Get read-only access to all levels.
+     *
+     * @return - Pointer to byteSize() bytes.
+     */
+    const uint8_t *data() const;
+
+    /*!
+     * Get size of all levels.
+     *
+     * @return - Size in bytes.
+     */
+    size_t byteSize() const;
+
+    /*!
+     * Get hash of the blocks, equal for images with identical format, size and blocks.
+     *
+     * @return - 64bit content hash.
+     */
+    uint64_t contentHash() const;
+
+    Format format;
+    int width, height, levels;
+  private:
+    size_t levelOffset(int level) const;
+
+    std::vector<uint8_t> blocks;
+    const uint8_t *wrapped = nullptr;
+    std::shared_ptr<const void> storage;
+  };
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "geometry_arena.h"
+
+namespace ppgso {
+
+  // Initial sizes, enough for a few hundred typical meshes before the first reallocation
+  static const size_t INITIAL_VERTICES = 1024 * 1024;
+  static const size_t INITIAL_INDEX_BYTES = 16 * 1024 * 1024;
+
+  static GLuint boundVertexArray = 0;
+  static size_t vertexArrayBinds = 0;
+
+  static GLuint createBuffer(size_t bytes) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) bytes, nullptr, GL_STATIC_DRAW);
+    return buffer;
+  }
+
+  GeometryArena::GeometryArena(std::string name, size_t vertexSize, std::function<void()> setupAttributes)
+          : name{std::move(name)}, vertexSize{vertexSize}, setupAttributes{std::move(setupAttributes)},
+            vertices{INITIAL_VERTICES}, indices{INITIAL_INDEX_BYTES} {
+    vbo = createBuffer(INITIAL_VERTICES * vertexSize);
+    ibo = createBuffer(INITIAL_INDEX_BYTES);
+    vertexMemory = {MemoryTracker::Category::Buffer, "Geometry arena " + this->name, INITIAL_VERTICES * vertexSize};
+    indexMemory = {MemoryTracker::Category::Buffer, "Geometry arena " + this->name, INITIAL_INDEX_BYTES};
+    glGenVertexArrays(1, &vao);
+    attach();
+  }
+
+  GeometryArena::~GeometryArena() {
+    if (boundVertexArray == vao) boundVertexArray = 0;
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+  }
+
+  size_t GeometryArena::allocateVertices(const void *data, size_t count) {
+    return allocate(vertices, vbo, vertexMemory, vertexSize, data, count);
+  }
+
+  size_t GeometryArena::allocateIndices(const void *data, size_t bytes) {
+    return allocate(indices, ibo, indexMemory, 1, data, (bytes + 3) & ~(size_t) 3);
+  }
+
+  void GeometryArena::freeVertices(size_t first) {
+    vertices.free(first);
+  }
+
+  void GeometryArena::freeIndices(size_t offset) {
+    indices.free(offset);
+  }
+
+  size_t GeometryArena::allocate(RangeAllocator &allocator, GLuint &buffer, MemoryTracker::Allocation &memory,
+                                 size_t unit, const void *data, size_t size) {
+    size_t offset = allocator.allocate(size);
+    if (offset == RangeAllocator::invalid) {
+      // Copy into a buffer at least twice as large, the old contents keep their offsets
+      size_t capacity = std::max(allocator.capacity() * 2, allocator.capacity() + size);
+      GLuint grown = createBuffer(capacity * unit);
+      glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr) (allocator.capacity() * unit));
+      glDeleteBuffers(1, &buffer);
+      buffer = grown;
+      allocator.grow(capacity);
+      memory.resize(capacity * unit);
+      grows++;
+      attach();
+      offset = allocator.allocate(size);
+    }
+
+    // The copy target keeps uploads away from whatever vertex array is bound
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) (offset * unit), (GLsizeiptr) (size * unit), data);
+    return offset;
+  }
+
+  void GeometryArena::attach() {
+    glBindVertexArray(vao);
+    boundVertexArray = vao;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    setupAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  }
+
+  void GeometryArena::bind() {
+    if (boundVertexArray == vao) return;
+    glBindVertexArray(vao);
+    boundVertexArray = vao;
+    vertexArrayBinds++;
+  }
+
+  void GeometryArena::resetBinding() {
+    boundVertexArray = 0;
+  }
+
+  size_t GeometryArena::getBindCount() {
+    return vertexArrayBinds;
+  }
+
+  void GeometryArena::resetBindCount() {
+    vertexArrayBinds = 0;
+  }
+
+  size_t GeometryArena::getVertexSize() const {
+    return vertexSize;
+  }
+
+  GeometryArena::Stats GeometryArena::getStats() const {
+    Stats stats;
+    stats.vertices = vertices.getStats();
+    stats.vertices.capacity *= vertexSize;
+    stats.vertices.used *= vertexSize;
+    stats.vertices.largestFree *= vertexSize;
+    stats.indices = indices.getStats();
+    stats.grows = grows;
+    return stats;
+  }
+
+  void GeometryArena::printStats(std::ostream &out) const {
+    auto stats = getStats();
+    auto flags = out.flags();
+    auto precision = out.precision();
+    auto print = [&out](const char *label, const RangeAllocator::Stats &s) {
+      out << label << " " << s.used / (1024.0 * 1024.0) << "/" << s.capacity / (1024.0 * 1024.0) << " MB in "
+          << s.allocations << " ranges, " << s.freeBlocks << " free blocks, largest "
+          << s.largestFree / (1024.0 * 1024.0) << " MB, fragmentation " << s.fragmentation() * 100.0f << "%";
+    };
+    out << std::fixed << std::setprecision(2) << "Geometry arena " << name << ": ";
+    print("vertices", stats.vertices);
+    out << "; ";
+    print("indices", stats.indices);
+    out << "; " << stats.grows << " reallocations" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "memory_tracker.h"
+#include "range_allocator.h"
+
+namespace ppgso {
+
+  /*!
+   * Vertex and index buffer shared by all meshes with the same vertex layout, drawn through a single vertex array
+   * object. Meshes sub-allocate ranges and draw them with glDrawElementsBaseVertex, so switching between meshes does
+   * not touch the vertex array state. Full buffers are replaced by larger copies and freed ranges are reused.
+   */
+  class GeometryArena {
+  public:
+    /*!
+     * Usage of both buffers in bytes.
+     */
+    struct Stats {
+      RangeAllocator::Stats vertices;
+      RangeAllocator::Stats indices;
+      size_t grows = 0;                 // Buffer reallocations since creation
+    };
+
+    /*!
+     * Create the buffers and the vertex array object, requires a current OpenGL context.
+     *
+     * @param name - Layout name used in statistics.
+     * @param vertexSize - Size of a single vertex in bytes.
+     * @param setupAttributes - Called with the vertex array and vertex buffer bound to set up attribute pointers.
+     */
+    GeometryArena(std::string name, size_t vertexSize, std::function<void()> setupAttributes);
+    GeometryArena(const GeometryArena &) = delete;
+    GeometryArena &operator=(const GeometryArena &) = delete;
+    ~GeometryArena();
+
+    /*!
+     * Upload vertices into a free range, growing the vertex buffer when needed.
+     *
+     * @param data - Vertices in the layout of the arena.
+     * @param count - Number of vertices, must be positive.
+     * @return - Index of the first vertex, usable as base vertex.
+     */
+    size_t allocateVertices(const void *data, size_t count);
+
+    /*!
+     * Upload indices into a free range, growing the index buffer when needed.
+     *
+     * @param data - Index data, 16bit and 32bit indices may be mixed as long as each block is 4 byte aligned.
+     * @param bytes - Size of the data, rounded up to a multiple of 4.
+     * @return - Offset of the range in bytes.
+     */
+    size_t allocateIndices(const void *data, size_t bytes);
+
+    /*!
+     * Release vertices for reuse.
+     *
+     * @param first - Index returned by allocateVertices().
+     */
+    void freeVertices(size_t first);
+
+    /*!
+     * Release indices for reuse.
+     *
+     * @param offset - Offset returned by allocateIndices().
+     */
+    void freeIndices(size_t offset);
+
+    /*!
+     * Bind the vertex array object unless it already is.
+     */
+    void bind();
+
+    /*!
+     * Forget which arena is bound, call after binding other vertex array objects.
+     */
+    static void resetBinding();
+
+    /*!
+     * Get number of vertex array binds issued by bind() since the last reset.
+     *
+     * @return - Bind count.
+     */
+    static size_t getBindCount();
+
+    /*!
+     * Reset the vertex array bind counter, usually once per frame.
+     */
+    static void resetBindCount();
+
+    /*!
+     * Get size of a single vertex.
+     *
+     * @return - Size in bytes.
+     */
+    size_t getVertexSize() const;
+
+    /*!
+     * Get buffer usage and fragmentation.
+     *
+     * @return - Current statistics.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print used and reserved memory, free blocks and fragmentation of both buffers.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+  private:
+    size_t allocate(RangeAllocator &allocator, GLuint &buffer, MemoryTracker::Allocation &memory, size_t unit,
+                    const void *data, size_t size);
+    void attach();
+
+    std::string name;
+    size_t vertexSize;
+    std::function<void()> setupAttributes;
+    RangeAllocator vertices;            // In vertices
+    RangeAllocator indices;             // In bytes, every allocation is a multiple of 4
+    GLuint vao = 0, vbo = 0, ibo = 0;
+    size_t grows = 0;
+    MemoryTracker::Allocation vertexMemory, indexMemory;
+  };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace ppgso {
+
+  /*!
+   * Fast non-cryptographic 64bit hash of a memory block, used to identify file and asset content.
+   *
+   * @param data - Pointer to the data to hash.
+   * @param size - Number of bytes to hash.
+   * @param seed - Optional seed to chain multiple blocks.
+   * @return - 64bit hash value.
+   */
+  inline uint64_t hash64(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+    const uint64_t prime = 0x100000001b3ull;
+    auto bytes = (const uint8_t *) data;
+    uint64_t h = seed ^ (size * prime);
+
+    // Consume 8 bytes per step, FNV-1a style with a stronger multiplier
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; i++) {
+      uint64_t word;
+      std::memcpy(&word, bytes + i * 8, 8);
+      h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+      h ^= h >> 29;
+    }
+    for (size_t i = words * 8; i < size; i++)
+      h = (h ^ bytes[i]) * prime;
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+  }
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include "image.h"
+#include "hash.h"
 
 uint8_t clamp(float value) {
   return (uint8_t) (std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
@@ -9,20 +10,48 @@ ppgso::Image::Image(int width, int height) : width{width}, height{height} {
   framebuffer.resize((size_t) (width * height));
 }
 
+ppgso::Image::Image(int width, int height, const Pixel *pixels, std::shared_ptr<const void> storage)
+        : width{width}, height{height}, wrapped{pixels}, storage{std::move(storage)} {}
+
+void ppgso::Image::detach() {
+  if (!wrapped) return;
+  framebuffer.assign(wrapped, wrapped + (size_t) width * height);
+  wrapped = nullptr;
+  storage.reset();
+}
+
 std::vector<ppgso::Image::Pixel>& ppgso::Image::getFramebuffer() {
+  detach();
   return framebuffer;
 }
 
+const ppgso::Image::Pixel *ppgso::Image::data() const {
+  if (wrapped) return wrapped;
+  return framebuffer.empty() ? nullptr : framebuffer.data();
+}
+
+bool ppgso::Image::isWrapped() const {
+  return wrapped != nullptr;
+}
+
 ppgso::Image::Pixel& ppgso::Image::getPixel(int x, int y) {
+  detach();
   return framebuffer[x+y*width];
 }
 
+const ppgso::Image::Pixel& ppgso::Image::getPixel(int x, int y) const {
+  return data()[x+y*width];
+}
+
 void ppgso::Image::setPixel(int x, int y, const Image::Pixel& color) {
+  detach();
   framebuffer[x+y*width] = color;
 }
 
 void ppgso::Image::clear(const ppgso::Image::Pixel &color) {
-  framebuffer = std::vector<Pixel>(framebuffer.size(), color);
+  wrapped = nullptr;
+  storage.reset();
+  framebuffer.assign((size_t) width * height, color);
 }
 
 void ppgso::Image::setPixel(int x, int y, int r, int g, int b) {
@@ -32,3 +61,8 @@ void ppgso::Image::setPixel(int x, int y, int r, int g, int b) {
 void ppgso::Image::setPixel(int x, int y, float r, float g, float b) {
   setPixel(x,y,{clamp(r), clamp(g), clamp(b)});
 }
+
+uint64_t ppgso::Image::contentHash() const {
+  int size[] = {width, height};
+  return hash64(data(), (size_t) width * height * sizeof(Pixel), hash64(size, sizeof(size)));
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <cstdint>
 
 namespace ppgso {
 
@@ -21,12 +22,37 @@ namespace ppgso {
     Image(int width, int height);
 
     /*!
-     * Get raw access to the image data.
+     * Wrap pixels owned elsewhere, e.g. in a mapped file, without copying them.
+     * Read access through data() uses the wrapped pixels, the first non-const access copies them into the framebuffer.
+     *
+     * @param width - Width in pixels.
+     * @param height - Height in pixels.
+     * @param pixels - Rows of RGB pixels from the top, width * height of them.
+     * @param storage - Keeps the pixels alive for as long as the image wraps them.
+     */
+    Image(int width, int height, const Pixel *pixels, std::shared_ptr<const void> storage);
+
+    /*!
+     * Get raw access to the image data. Copies wrapped pixels into the framebuffer first.
      *
      * @return - Pointer to the raw RGB framebuffer data.
      */
     std::vector<Pixel>& getFramebuffer();
 
+    /*!
+     * Get read-only access to the pixels without copying wrapped ones.
+     *
+     * @return - Pointer to width * height RGB pixels, nullptr for empty images.
+     */
+    const Pixel *data() const;
+
+    /*!
+     * Check whether the pixels are wrapped rather than owned by the image.
+     *
+     * @return - True for images created from external memory and not modified since.
+     */
+    bool isWrapped() const;
+
     /*!
      * Get single pixel from the framebuffer.
      *
@@ -36,6 +62,15 @@ namespace ppgso {
      */
     Pixel& getPixel(int x, int y);
 
+    /*!
+     * Get single pixel without copying wrapped pixels.
+     *
+     * @param x - X position of the pixel.
+     * @param y - Y position of the pixel.
+     * @return - Reference to the pixel.
+     */
+    const Pixel& getPixel(int x, int y) const;
+
     /*!
      * Set pixel on coordinates x and y
      * @param x Horizontal coordinate
@@ -70,9 +105,20 @@ namespace ppgso {
      */
     void clear(const Pixel& color = {0,0,0});
 
+    /*!
+     * Get hash of the pixel data, equal for images with identical size and pixels.
+     *
+     * @return - 64bit content hash.
+     */
+    uint64_t contentHash() const;
+
     int width, height;
   private:
+    void detach();
+
     std::vector<Pixel> framebuffer;
+    const Pixel *wrapped = nullptr;
+    std::shared_ptr<const void> storage;
   };
 }
 
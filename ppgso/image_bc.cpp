@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "image_bc.h"
+#include "image_mips.h"
+
+namespace ppgso {
+  namespace image {
+
+    // Pixels of one 4x4 block, rows from the top
+    struct Block {
+      uint8_t rgb[16][3];
+    };
+
+    static void readBlock(const Image &image, int bx, int by, Block &block) {
+      auto pixels = image.data();
+      for (int y = 0; y < 4; y++) {
+        // Edge blocks repeat the last row and column
+        int sy = std::min(by * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; x++) {
+          int sx = std::min(bx * 4 + x, image.width - 1);
+          auto &pixel = pixels[(size_t) sy * image.width + sx];
+          block.rgb[y * 4 + x][0] = pixel.r;
+          block.rgb[y * 4 + x][1] = pixel.g;
+          block.rgb[y * 4 + x][2] = pixel.b;
+        }
+      }
+    }
+
+    static void write16(uint8_t *out, uint16_t value) {
+      out[0] = (uint8_t) value;
+      out[1] = (uint8_t) (value >> 8);
+    }
+
+    static uint16_t read16(const uint8_t *in) {
+      return (uint16_t) (in[0] | in[1] << 8);
+    }
+
+    static uint16_t to565(const float color[3]) {
+      auto quantize = [](float value, int max) {
+        return (int) std::lround(std::min(std::max(value, 0.0f), 255.0f) * max / 255.0f);
+      };
+      return (uint16_t) (quantize(color[0], 31) << 11 | quantize(color[1], 63) << 5 | quantize(color[2], 31));
+    }
+
+    static void from565(uint16_t value, int color[3]) {
+      int r = value >> 11 & 31, g = value >> 5 & 63, b = value & 31;
+      color[0] = r << 3 | r >> 2;
+      color[1] = g << 2 | g >> 4;
+      color[2] = b << 3 | b >> 2;
+    }
+
+    // Four color palette of a block with c0 > c1
+    static void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+      from565(c0, palette[0]);
+      from565(c1, palette[1]);
+      for (int i = 0; i < 3; i++) {
+        palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+        palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+      }
+    }
+
+    static uint32_t bc1Indices(const Block &block, uint16_t c0, uint16_t c1, int &error) {
+      int palette[4][3];
+      bc1Palette(c0, c1, palette);
+      uint32_t indices = 0;
+      error = 0;
+      for (int p = 0; p < 16; p++) {
+        int best = 0, bestError = 0;
+        for (int i = 0; i < 4; i++) {
+          int dr = block.rgb[p][0] - palette[i][0], dg = block.rgb[p][1] - palette[i][1];
+          int db = block.rgb[p][2] - palette[i][2];
+          int e = dr * dr + dg * dg + db * db;
+          if (i == 0 || e < bestError) {
+            best = i;
+            bestError = e;
+          }
+        }
+        indices |= (uint32_t) best << (2 * p);
+        error += bestError;
+      }
+      return indices;
+    }
+
+    // Endpoints on the principal axis of the colors, refined once by least squares over the chosen indices
+    static void encodeBC1(const Block &block, uint8_t *out) {
+      float mean[3] = {};
+      for (auto &pixel : block.rgb)
+        for (int i = 0; i < 3; i++) mean[i] += pixel[i] / 16.0f;
+
+      float cov[6] = {};
+      for (auto &pixel : block.rgb) {
+        float d[3] = {pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2]};
+        cov[0] += d[0] * d[0];
+        cov[1] += d[0] * d[1];
+        cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1];
+        cov[4] += d[1] * d[2];
+        cov[5] += d[2] * d[2];
+      }
+
+      float axis[3] = {1.0f, 1.0f, 1.0f};
+      for (int iteration = 0; iteration < 6; iteration++) {
+        float next[3] = {cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                         cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                         cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f) break;
+        for (int i = 0; i < 3; i++) axis[i] = next[i] / length;
+      }
+
+      float low = 0.0f, high = 0.0f;
+      for (auto &pixel : block.rgb) {
+        float t = (pixel[0] - mean[0]) * axis[0] + (pixel[1] - mean[1]) * axis[1] + (pixel[2] - mean[2]) * axis[2];
+        low = std::min(low, t);
+        high = std::max(high, t);
+      }
+      // Inset the endpoints a little, the extremes are rarely worth a palette entry of their own
+      float inset = (high - low) / 16.0f;
+      float e0[3], e1[3];
+      for (int i = 0; i < 3; i++) {
+        e0[i] = mean[i] + axis[i] * (high - inset);
+        e1[i] = mean[i] + axis[i] * (low + inset);
+      }
+
+      auto candidate = [&block](const float a[3], const float b[3], uint16_t &c0, uint16_t &c1, uint32_t &indices) {
+        c0 = to565(a);
+        c1 = to565(b);
+        if (c0 < c1) std::swap(c0, c1);
+        int error = 0;
+        // Equal endpoints select the three color mode, where index 0 is still the endpoint
+        indices = c0 == c1 ? 0 : bc1Indices(block, c0, c1, error);
+        if (c0 == c1) {
+          int color[3];
+          from565(c0, color);
+          for (auto &pixel : block.rgb)
+            for (int i = 0; i < 3; i++) error += (pixel[i] - color[i]) * (pixel[i] - color[i]);
+        }
+        return error;
+      };
+
+      uint16_t c0, c1;
+      uint32_t indices;
+      int error = candidate(e0, e1, c0, c1, indices);
+
+      if (c0 != c1) {
+        // Least squares endpoints for the chosen indices, weights of the first endpoint per index
+        static const float WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0, bb = 0, ab = 0, ax[3] = {}, bx[3] = {};
+        for (int p = 0; p < 16; p++) {
+          float a = WEIGHTS[indices >> (2 * p) & 3], b = 1.0f - a;
+          aa += a * a;
+          bb += b * b;
+          ab += a * b;
+          for (int i = 0; i < 3; i++) {
+            ax[i] += a * block.rgb[p][i];
+            bx[i] += b * block.rgb[p][i];
+          }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) > 1e-6f) {
+          float r0[3], r1[3];
+          for (int i = 0; i < 3; i++) {
+            r0[i] = (ax[i] * bb - bx[i] * ab) / det;
+            r1[i] = (bx[i] * aa - ax[i] * ab) / det;
+          }
+          uint16_t r0c, r1c;
+          uint32_t refined;
+          if (candidate(r0, r1, r0c, r1c, refined) < error) {
+            c0 = r0c;
+            c1 = r1c;
+            indices = refined;
+          }
+        }
+      }
+
+      write16(out, c0);
+      write16(out + 2, c1);
+      for (int i = 0; i < 4; i++) out[4 + i] = (uint8_t) (indices >> (8 * i));
+    }
+
+    // Eight value palette of a single channel block with a0 > a1
+    static void bc4Palette(int a0, int a1, int palette[8]) {
+      palette[0] = a0;
+      palette[1] = a1;
+      for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+
+    static void encodeBC4(const Block &block, int channel, uint8_t *out) {
+      int low = 255, high = 0;
+      for (auto &pixel : block.rgb) {
+        low = std::min(low, (int) pixel[channel]);
+        high = std::max(high, (int) pixel[channel]);
+      }
+      out[0] = (uint8_t) high;
+      out[1] = (uint8_t) low;
+
+      uint64_t indices = 0;
+      if (high > low) {
+        int palette[8];
+        bc4Palette(high, low, palette);
+        for (int p = 0; p < 16; p++) {
+          int value = block.rgb[p][channel], best = 0;
+          for (int i = 1; i < 8; i++)
+            if (std::abs(value - palette[i]) < std::abs(value - palette[best])) best = i;
+          indices |= (uint64_t) best << (3 * p);
+        }
+      }
+      for (int i = 0; i < 6; i++) out[2 + i] = (uint8_t) (indices >> (8 * i));
+    }
+
+    static void decodeBC4(const uint8_t *in, uint8_t values[16]) {
+      int palette[8];
+      if (in[0] > in[1]) {
+        bc4Palette(in[0], in[1], palette);
+      } else {
+        // Six interpolated values followed by 0 and 255
+        palette[0] = in[0];
+        palette[1] = in[1];
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * in[0] + i * in[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+      }
+      uint64_t indices = 0;
+      for (int i = 0; i < 6; i++) indices |= (uint64_t) in[2 + i] << (8 * i);
+      for (int p = 0; p < 16; p++) values[p] = (uint8_t) palette[indices >> (3 * p) & 7];
+    }
+
+    static void decodeBC1(const uint8_t *in, uint8_t rgb[16][3]) {
+      uint16_t c0 = read16(in), c1 = read16(in + 2);
+      int palette[4][3];
+      bc1Palette(c0, c1, palette);
+      if (c0 <= c1) {
+        // Three color mode, the last entry is black
+        for (int i = 0; i < 3; i++) {
+          palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+          palette[3][i] = 0;
+        }
+      }
+      uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | (uint32_t) in[7] << 24;
+      for (int p = 0; p < 16; p++)
+        for (int i = 0; i < 3; i++) rgb[p][i] = (uint8_t) palette[indices >> (2 * p) & 3][i];
+    }
+
+    static void compressLevel(const Image &image, CompressedImage::Format format, uint8_t *out, ThreadPool *pool) {
+      int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+      size_t blockBytes = CompressedImage::blockBytes(format);
+      auto encodeRow = [&](size_t by) {
+        Block block;
+        for (int bx = 0; bx < blocksX; bx++) {
+          readBlock(image, bx, (int) by, block);
+          auto target = out + (by * blocksX + bx) * blockBytes;
+          if (format == CompressedImage::Format::BC1) {
+            encodeBC1(block, target);
+          } else {
+            encodeBC4(block, 0, target);
+            encodeBC4(block, 1, target + 8);
+          }
+        }
+      };
+      if (pool) {
+        pool->parallelFor((size_t) blocksY, encodeRow);
+      } else {
+        for (int by = 0; by < blocksY; by++) encodeRow((size_t) by);
+      }
+    }
+
+    CompressedImage::Format blockFormatFor(const std::string &name) {
+      return isColorTexture(name) ? CompressedImage::Format::BC1 : CompressedImage::Format::BC5;
+    }
+
+    CompressedImage compressBC(const Image &image, CompressedImage::Format format, int levels, ThreadPool *pool) {
+      // Levels are filtered before compression, so every level is encoded from uncompressed pixels
+      auto chain = buildMipChain(image, format == CompressedImage::Format::BC1, levels, pool);
+      CompressedImage result{format, image.width, image.height, chain.levels};
+      for (int level = 0; level < chain.levels; level++) {
+        Image pixels{chain.levelWidth(level), chain.levelHeight(level),
+                     (const Image::Pixel *) chain.levelData(level), nullptr};
+        compressLevel(pixels, format, result.levelData(level), pool);
+      }
+      return result;
+    }
+
+    Image decompressBC(const CompressedImage &image, int level) {
+      int width = image.levelWidth(level), height = image.levelHeight(level);
+      if (!CompressedImage::isBlockCompressed(image.format)) {
+        Image result{width, height};
+        std::memcpy(result.getFramebuffer().data(), image.levelData(level),
+                    CompressedImage::levelBytes(image.format, width, height));
+        return result;
+      }
+
+      int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+      size_t blockBytes = CompressedImage::blockBytes(image.format);
+      auto blocks = image.levelData(level);
+
+      Image result{width, height};
+      auto &pixels = result.getFramebuffer();
+      for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+          auto block = blocks + ((size_t) by * blocksX + bx) * blockBytes;
+          uint8_t rgb[16][3];
+          if (image.format == CompressedImage::Format::BC1) {
+            decodeBC1(block, rgb);
+          } else {
+            uint8_t x[16], y[16];
+            decodeBC4(block, x);
+            decodeBC4(block + 8, y);
+            for (int p = 0; p < 16; p++) {
+              float nx = x[p] / 127.5f - 1.0f, ny = y[p] / 127.5f - 1.0f;
+              float nz = std::sqrt(std::max(1.0f - nx * nx - ny * ny, 0.0f));
+              rgb[p][0] = x[p];
+              rgb[p][1] = y[p];
+              rgb[p][2] = (uint8_t) std::lround((nz + 1.0f) * 127.5f);
+            }
+          }
+          for (int p = 0; p < 16; p++) {
+            int px = bx * 4 + p % 4, py = by * 4 + p / 4;
+            if (px < width && py < height) pixels[(size_t) py * width + px] = {rgb[p][0], rgb[p][1], rgb[p][2]};
+          }
+        }
+      }
+      return result;
+    }
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+
+#include "compressed_image.h"
+#include "image.h"
+#include "thread_pool.h"
+
+namespace ppgso {
+namespace image {
+/*!
+ * Pick the block format of a texture by its file name, BC5 for normal maps such as "Concrete_Normal.bmp" and BC1
+ * for everything else.
+ *
+ * @param name - File name or path of the texture.
+ * @return - Block format to compress the texture with.
+ */
+  CompressedImage::Format blockFormatFor(const std::string &name);
+
+/*!
+ * Compress an image into blocks together with its mipmaps, filtered by buildMipChain before compression.
+ * BC1 keeps RGB at 4 bits per pixel, BC5 keeps red and green at 8 bits per pixel, which suits the X and Y of
+ * normal maps. Rows of blocks are encoded in parallel.
+ *
+ * @param image - Image to compress.
+ * @param format - Block format.
+ * @param levels - Number of mipmap levels including the full size, 0 for the full chain down to 1x1.
+ * @param pool - Pool sharing the work with the calling thread, which may be one of its workers, nullptr to encode
+ * on the calling thread only.
+ * @return - Compressed image.
+ */
+  CompressedImage compressBC(const Image &image, CompressedImage::Format format, int levels = 0,
+                             ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Decode a level of a compressed image, e.g. to check the quality or to make thumbnails.
+ * For BC5 the blue channel is reconstructed as the Z of a unit normal, RGB8 levels are copied.
+ *
+ * @param image - Compressed image.
+ * @param level - Mipmap level to decode, 0 is the full size.
+ * @return - Decoded RGB image.
+ */
+  Image decompressBC(const CompressedImage &image, int level = 0);
+
+}
+}
@@ -1,7 +1,17 @@
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
 #include "image_bmp.h"
+#include "mapped_file.h"
 
 namespace ppgso {
   namespace image {
@@ -33,21 +43,49 @@ namespace ppgso {
     } BITMAPINFOHEADER;
 #pragma pack()
 
-    Image loadBMP(const std::string &bmp) {
-      BITMAPFILEHEADER bmpFileHeader = {};
-      BITMAPINFOHEADER bmpInfoHeader = {};
-
-      std::ifstream input_file(bmp, std::ios::binary);
+    // Swap B and R of one row of BGR pixels, 16 byte blocks hold 5 whole pixels and one byte of the next pixel,
+    // which the following block rewrites, so blocks stop 6 pixels before the end of the row
+    static void bgrToRgb(const uint8_t *src, Image::Pixel *dst, int width) {
+      int i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+      // Byte k of a block takes byte k + 2 when it is red, byte k - 2 when it is blue and keeps green
+      const __m128i red = _mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, 0);
+      const __m128i blue = _mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0);
+      const __m128i keep = _mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, -1);
+      for (; i + 6 <= width; i += 5) {
+        __m128i bgr = _mm_loadu_si128((const __m128i *) (src + i * 3));
+        __m128i rgb = _mm_or_si128(_mm_and_si128(bgr, keep),
+                                   _mm_or_si128(_mm_and_si128(_mm_srli_si128(bgr, 2), red),
+                                                _mm_and_si128(_mm_slli_si128(bgr, 2), blue)));
+        _mm_storeu_si128((__m128i *) (dst + i), rgb);
+      }
+#elif defined(__ARM_NEON)
+      for (; i + 16 <= width; i += 16) {
+        uint8x16x3_t bgr = vld3q_u8(src + i * 3);
+        uint8x16x3_t rgb = {{bgr.val[2], bgr.val[1], bgr.val[0]}};
+        vst3q_u8((uint8_t *) (dst + i), rgb);
+      }
+#endif
+      for (; i < width; i++) dst[i] = {src[i * 3 + 2], src[i * 3 + 1], src[i * 3]};
+    }
 
-      // Check headers
-      if (!input_file.is_open()) {
+    Image loadBMP(const std::string &bmp) {
+      // A single mapping instead of a read per row, rows are converted straight into the framebuffer
+      std::unique_ptr<MappedFile> file;
+      try {
+        file = std::make_unique<MappedFile>(bmp);
+      } catch (std::exception &) {
         std::stringstream msg;
         msg << "Could not open BMP file. " << bmp;
         throw std::runtime_error(msg.str());
       }
 
-      input_file.read((char *) &bmpFileHeader, sizeof(BITMAPFILEHEADER));
-      input_file.read((char *) &bmpInfoHeader, sizeof(BITMAPINFOHEADER));
+      BITMAPFILEHEADER bmpFileHeader = {};
+      BITMAPINFOHEADER bmpInfoHeader = {};
+      if (file->size() >= sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER)) {
+        std::memcpy(&bmpFileHeader, file->data(), sizeof(BITMAPFILEHEADER));
+        std::memcpy(&bmpInfoHeader, file->data() + sizeof(BITMAPFILEHEADER), sizeof(BITMAPINFOHEADER));
+      }
 
       if (bmpFileHeader.bfType != 19778) {
         std::stringstream msg;
@@ -71,35 +109,27 @@ namespace ppgso {
       int height = abs(bmpInfoHeader.biHeight);
       bool flipped = bmpInfoHeader.biHeight < 0;
 
-      if (width == 0 || height == 0) {
+      if (width <= 0 || height == 0) {
         std::stringstream msg;
         msg << "BMP file does not contain any data. " << bmp;
         throw std::runtime_error(msg.str());
       }
 
-      Image image{width, height};
-      auto &framebuffer = image.getFramebuffer();
-
-      // Load data
-      input_file.seekg(bmpFileHeader.bfOffBits, input_file.beg);
-
       // BMP uses padding for rows
-      unsigned int row_padded = (width * sizeof(Image::Pixel) + 3) & (~3);
+      size_t row_padded = ((size_t) width * sizeof(Image::Pixel) + 3) & (~(size_t) 3);
+      if (bmpFileHeader.bfOffBits > file->size() || (file->size() - bmpFileHeader.bfOffBits) / row_padded < (size_t) height) {
+        std::stringstream msg;
+        msg << "BMP file is truncated. " << bmp;
+        throw std::runtime_error(msg.str());
+      }
 
+      Image image{width, height};
+      auto framebuffer = image.getFramebuffer().data();
+      auto pixels = file->data() + bmpFileHeader.bfOffBits;
       for (int j = 0; j < height; j++) {
-        auto row_data = std::vector<Image::Pixel>(row_padded);
-        input_file.read((char *) row_data.data(), row_padded);
-        for (int i = 0; i < width; i++) {
-          auto pixel = row_data[i];
-          std::swap(pixel.r, pixel.b);
-          if (flipped) {
-            framebuffer[i + j * width] = pixel;
-          } else {
-            framebuffer[i + (height - 1 - j) * width] = pixel;
-          }
-        }
+        int row = flipped ? j : height - 1 - j;
+        bgrToRgb(pixels + j * row_padded, framebuffer + (size_t) row * width, width);
       }
-      input_file.close();
 
       return image;
     }
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+#include "image_mips.h"
+
+namespace ppgso {
+  namespace image {
+
+    // Filtering happens on 14 bit linear values, so four of them plus rounding still fit 16 bits
+    static const int LINEAR_MAX = 16383;
+
+    struct GammaTables {
+      uint16_t toLinear[256];
+      uint8_t fromLinear[LINEAR_MAX + 1];
+    };
+
+    // Data textures get tables which only rescale, so both kinds share the same filter
+    static GammaTables buildTables(bool srgb) {
+      GammaTables tables;
+      for (int v = 0; v < 256; v++) {
+        double c = v / 255.0;
+        if (srgb) c = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        tables.toLinear[v] = (uint16_t) std::lround(c * LINEAR_MAX);
+      }
+      for (int i = 0; i <= LINEAR_MAX; i++) {
+        double l = (double) i / LINEAR_MAX;
+        if (srgb) l = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+        tables.fromLinear[i] = (uint8_t) std::lround(std::min(std::max(l, 0.0), 1.0) * 255.0);
+      }
+      return tables;
+    }
+
+    static const GammaTables &gammaTables(bool srgb) {
+      static const GammaTables srgbTables = buildTables(true), linearTables = buildTables(false);
+      return srgb ? srgbTables : linearTables;
+    }
+
+    // Convert 2 * width pixels of a row to linear values, columns past the edge repeat the last one
+    static void expandRow(const uint8_t *row, int rowWidth, int width, const uint16_t *toLinear, uint16_t *out) {
+      for (int x = 0; x < 2 * width; x++) {
+        auto pixel = row + std::min(x, rowWidth - 1) * 3;
+        out[x * 3] = toLinear[pixel[0]];
+        out[x * 3 + 1] = toLinear[pixel[1]];
+        out[x * 3 + 2] = toLinear[pixel[2]];
+      }
+    }
+
+    // Average 2x2 pixels of the source rows into one row of the next level. Channel c of pixel x is the sum of
+    // elements 6x + c and 6x + c + 3 of both expanded rows, so the sums are computed for all elements at once and
+    // every sixth triple is kept. Results are written over the first row, each element is read before it is replaced.
+    static void filterRow(const uint8_t *source, int sourceWidth, int sourceHeight, uint8_t *target, int width, int y,
+                          const GammaTables &tables) {
+      static thread_local std::vector<uint16_t> first, second;
+      size_t count = (size_t) width * 6;
+      first.resize(count);
+      second.resize(count);
+      int y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+      expandRow(source + (size_t) y0 * sourceWidth * 3, sourceWidth, width, tables.toLinear, first.data());
+      expandRow(source + (size_t) y1 * sourceWidth * 3, sourceWidth, width, tables.toLinear, second.data());
+
+      uint16_t *a = first.data(), *b = second.data();
+      size_t j = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+      const __m128i rounding = _mm_set1_epi16(2);
+      for (; j + 11 <= count; j += 8) {
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i *) (a + j)),
+                                                  _mm_loadu_si128((const __m128i *) (b + j))),
+                                    _mm_add_epi16(_mm_loadu_si128((const __m128i *) (a + j + 3)),
+                                                  _mm_loadu_si128((const __m128i *) (b + j + 3))));
+        _mm_storeu_si128((__m128i *) (a + j), _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2));
+      }
+#elif defined(__ARM_NEON)
+      const uint16x8_t rounding = vdupq_n_u16(2);
+      for (; j + 11 <= count; j += 8) {
+        uint16x8_t sum = vaddq_u16(vaddq_u16(vld1q_u16(a + j), vld1q_u16(b + j)),
+                                   vaddq_u16(vld1q_u16(a + j + 3), vld1q_u16(b + j + 3)));
+        vst1q_u16(a + j, vshrq_n_u16(vaddq_u16(sum, rounding), 2));
+      }
+#endif
+      for (; j + 3 < count; j++) a[j] = (uint16_t) ((a[j] + b[j] + a[j + 3] + b[j + 3] + 2) >> 2);
+
+      auto out = target + (size_t) y * width * 3;
+      for (int x = 0; x < width; x++) {
+        out[x * 3] = tables.fromLinear[a[x * 6]];
+        out[x * 3 + 1] = tables.fromLinear[a[x * 6 + 1]];
+        out[x * 3 + 2] = tables.fromLinear[a[x * 6 + 2]];
+      }
+    }
+
+    bool isColorTexture(const std::string &name) {
+      auto file = name.substr(name.find_last_of("/\\") + 1);
+      file = file.substr(0, file.find_last_of('.'));
+      std::transform(file.begin(), file.end(), file.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+      auto endsWith = [&file](const std::string &suffix) {
+        return file.size() >= suffix.size() && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0;
+      };
+      // "Concrete_Normal", "Entrance_N", "Trim02_Nrm"
+      return file.find("normal") == std::string::npos && !endsWith("_n") && !endsWith("_nrm");
+    }
+
+    CompressedImage buildMipChain(const Image &image, bool srgb, int levels, ThreadPool *pool) {
+      if (levels <= 0) levels = CompressedImage::fullChain(image.width, image.height);
+      CompressedImage result{CompressedImage::Format::RGB8, image.width, image.height, levels};
+      if (image.data())
+        std::memcpy(result.levelData(0), image.data(), CompressedImage::levelBytes(result.format, image.width,
+                                                                                   image.height));
+
+      auto &tables = gammaTables(srgb);
+      for (int level = 1; level < levels; level++) {
+        int sourceWidth = result.levelWidth(level - 1), sourceHeight = result.levelHeight(level - 1);
+        int width = result.levelWidth(level), height = result.levelHeight(level);
+        auto source = static_cast<const CompressedImage &>(result).levelData(level - 1);
+        auto target = result.levelData(level);
+        auto filter = [&](size_t y) {
+          filterRow(source, sourceWidth, sourceHeight, target, width, (int) y, tables);
+        };
+        // Small levels are not worth waking the workers
+        if (pool && (size_t) width * height >= 64 * 64) {
+          pool->parallelFor((size_t) height, filter);
+        } else {
+          for (int y = 0; y < height; y++) filter((size_t) y);
+        }
+      }
+      return result;
+    }
+  }
+}
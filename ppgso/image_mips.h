@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+
+#include "compressed_image.h"
+#include "image.h"
+#include "thread_pool.h"
+
+namespace ppgso {
+namespace image {
+/*!
+ * Check whether a texture holds colors stored in sRGB, by its file name. Normal maps such as "Concrete_Normal.bmp"
+ * or "Entrance_N.bmp" hold vectors and are filtered linearly.
+ *
+ * @param name - File name or path of the texture.
+ * @return - True for color textures.
+ */
+  bool isColorTexture(const std::string &name);
+
+/*!
+ * Build the mipmaps of an image down to 1x1 ahead of time, so textures are uploaded level by level without
+ * glGenerateMipmap. Each level averages 2x2 pixels of the previous one, color textures in linear light so dark and
+ * bright details keep their brightness when minified. Rows are filtered in parallel.
+ *
+ * @param image - Image to build the chain from, copied into the first level.
+ * @param srgb - True for color textures, false for data such as normal maps.
+ * @param levels - Number of levels including the full size, 0 for the full chain.
+ * @param pool - Pool sharing the work with the calling thread, which may be one of its workers, nullptr to filter
+ * on the calling thread only.
+ * @return - RGB8 image with all levels.
+ */
+  CompressedImage buildMipChain(const Image &image, bool srgb = true, int levels = 0,
+                                ThreadPool *pool = &ThreadPool::shared());
+
+}
+}
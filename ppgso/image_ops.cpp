@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+#include "compressed_image.h"
+#include "image_mips.h"
+#include "image_ops.h"
+
+namespace ppgso {
+  namespace image {
+
+    // Filters work on rows of interleaved RGB floats, the same channel of the next pixel is 3 values away, so
+    // shifting a whole row by 3 values shifts it by a pixel and every kernel tap is one multiply-add over the row.
+
+    // out[i] += weight * in[i]
+    static void accumulate(float *out, const float *in, float weight, size_t count) {
+      size_t i = 0;
+#if defined(__AVX__)
+      const __m256 weight8 = _mm256_set1_ps(weight);
+      for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i),
+                                                _mm256_mul_ps(weight8, _mm256_loadu_ps(in + i))));
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+      const __m128 weight4 = _mm_set1_ps(weight);
+      for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(weight4, _mm_loadu_ps(in + i))));
+#elif defined(__ARM_NEON)
+      for (; i + 4 <= count; i += 4) vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(in + i), weight));
+#endif
+      for (; i < count; i++) out[i] += weight * in[i];
+    }
+
+    static void toFloat(const uint8_t *in, float *out, size_t count) {
+      size_t i = 0;
+#if defined(__AVX2__)
+      for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (in + i)));
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(values));
+      }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+      const __m128i zero = _mm_setzero_si128();
+      for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (in + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(out + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_ps(out + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_ps(out + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+      }
+#elif defined(__ARM_NEON)
+      for (; i + 8 <= count; i += 8) {
+        uint16x8_t words = vmovl_u8(vld1_u8(in + i));
+        vst1q_f32(out + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))));
+        vst1q_f32(out + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))));
+      }
+#endif
+      for (; i < count; i++) out[i] = in[i];
+    }
+
+    // Round to the nearest byte, values outside <0, 255> are clamped
+    static void toBytes(const float *in, uint8_t *out, size_t count) {
+      size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+      const __m128 low = _mm_setzero_ps(), high = _mm_set1_ps(255.0f);
+      auto convert = [&](size_t j) {
+        return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + j), low), high));
+      };
+      for (; i + 16 <= count; i += 16) {
+        __m128i words0 = _mm_packs_epi32(convert(i), convert(i + 4));
+        __m128i words1 = _mm_packs_epi32(convert(i + 8), convert(i + 12));
+        _mm_storeu_si128((__m128i *) (out + i), _mm_packus_epi16(words0, words1));
+      }
+#elif defined(__ARM_NEON)
+      const float32x4_t low = vdupq_n_f32(0.0f), high = vdupq_n_f32(255.0f), half = vdupq_n_f32(0.5f);
+      auto convert = [&](size_t j) {
+        return vmovn_u32(vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(vld1q_f32(in + j), low), high), half)));
+      };
+      for (; i + 8 <= count; i += 8) vst1_u8(out + i, vmovn_u16(vcombine_u16(convert(i), convert(i + 4))));
+#endif
+      for (; i < count; i++) out[i] = (uint8_t) std::lround(std::min(std::max(in[i], 0.0f), 255.0f));
+    }
+
+    // Row by row on the pool, small images are not worth waking the workers
+    static void forEachRow(int width, int height, ThreadPool *pool, const std::function<void(size_t)> &body) {
+      if (pool && (size_t) width * height >= 64 * 64) {
+        pool->parallelFor((size_t) height, body);
+      } else {
+        for (int y = 0; y < height; y++) body((size_t) y);
+      }
+    }
+
+    static const uint8_t *pixels(const Image &image) {
+      return reinterpret_cast<const uint8_t *>(image.data());
+    }
+
+    static uint8_t *pixels(Image &image) {
+      return reinterpret_cast<uint8_t *>(image.getFramebuffer().data());
+    }
+
+    // Convert a row to floats with pad pixels on both sides repeating the edge pixels
+    static void loadPadded(const uint8_t *row, int width, int pad, float *out) {
+      toFloat(row, out + pad * 3, (size_t) width * 3);
+      for (int x = 0; x < pad; x++) {
+        std::memcpy(out + x * 3, out + pad * 3, 3 * sizeof(float));
+        std::memcpy(out + (pad + width + x) * 3, out + (pad + width - 1) * 3, 3 * sizeof(float));
+      }
+    }
+
+    struct GammaTables {
+      static const int STEPS = 16383;
+      float toLinear[256];
+      uint8_t toLinearByte[256];
+      uint8_t fromLinear[STEPS + 1];
+
+      GammaTables() {
+        for (int v = 0; v < 256; v++) {
+          double c = v / 255.0;
+          double l = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+          toLinear[v] = (float) l;
+          toLinearByte[v] = (uint8_t) std::lround(l * 255.0);
+        }
+        for (int i = 0; i <= STEPS; i++) {
+          double l = (double) i / STEPS;
+          double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+          fromLinear[i] = (uint8_t) std::lround(std::min(std::max(c, 0.0), 1.0) * 255.0);
+        }
+      }
+
+      uint8_t encode(float linear) const {
+        return fromLinear[(int) (std::min(std::max(linear, 0.0f), 1.0f) * STEPS + 0.5f)];
+      }
+    };
+
+    static const GammaTables &gammaTables() {
+      static const GammaTables tables;
+      return tables;
+    }
+
+    Image resize(const Image &image, int width, int height, ThreadPool *pool) {
+      Image result{width, height};
+      if (width <= 0 || height <= 0 || image.width <= 0 || image.height <= 0) return result;
+
+      // Pixel centers of the result mapped into the source, with the neighbour to the right or below and its weight
+      struct Tap {
+        int first, second;
+        float weight;
+      };
+      auto taps = [](int size, int sourceSize) {
+        std::vector<Tap> result((size_t) size);
+        float scale = (float) sourceSize / size;
+        for (int i = 0; i < size; i++) {
+          float position = std::min(std::max((i + 0.5f) * scale - 0.5f, 0.0f), (float) (sourceSize - 1));
+          int first = (int) position;
+          result[i] = {first, std::min(first + 1, sourceSize - 1), position - first};
+        }
+        return result;
+      };
+      auto columns = taps(width, image.width), rows = taps(height, image.height);
+
+      auto source = pixels(image);
+      auto target = pixels(result);
+      size_t sourceRow = (size_t) image.width * 3;
+      forEachRow(width, height, pool, [&](size_t y) {
+        static thread_local std::vector<float> first, second, blended, out;
+        first.resize(sourceRow);
+        second.resize(sourceRow);
+        blended.assign(sourceRow, 0.0f);
+        out.resize((size_t) width * 3);
+
+        // Blend the two source rows, then sample the blended row at every column
+        auto &row = rows[y];
+        toFloat(source + row.first * sourceRow, first.data(), sourceRow);
+        toFloat(source + row.second * sourceRow, second.data(), sourceRow);
+        accumulate(blended.data(), first.data(), 1.0f - row.weight, sourceRow);
+        accumulate(blended.data(), second.data(), row.weight, sourceRow);
+        for (int x = 0; x < width; x++) {
+          auto &column = columns[x];
+          auto a = blended.data() + column.first * 3, b = blended.data() + column.second * 3;
+          for (int c = 0; c < 3; c++) out[x * 3 + c] = a[c] + (b[c] - a[c]) * column.weight;
+        }
+        toBytes(out.data(), target + y * width * 3, out.size());
+      });
+      return result;
+    }
+
+    Image downsample(const Image &image, bool srgb, ThreadPool *pool) {
+      if (image.width <= 0 || image.height <= 0) return Image{image.width, image.height};
+      auto chain = buildMipChain(image, srgb, 2, pool);
+      int level = chain.levels > 1 ? 1 : 0;
+      Image result{chain.levelWidth(level), chain.levelHeight(level)};
+      std::memcpy(pixels(result), chain.levelData(level),
+                  CompressedImage::levelBytes(chain.format, result.width, result.height));
+      return result;
+    }
+
+    Image gaussianBlur(const Image &image, float sigma, ThreadPool *pool) {
+      Image result{image.width, image.height};
+      if (image.width <= 0 || image.height <= 0) return result;
+      int width = image.width, height = image.height;
+      size_t rowSize = (size_t) width * 3;
+      if (sigma <= 0.0f) {
+        std::memcpy(pixels(result), pixels(image), rowSize * height);
+        return result;
+      }
+
+      int radius = std::max((int) std::ceil(sigma * 3.0f), 1);
+      std::vector<float> weights((size_t) radius * 2 + 1);
+      float sum = 0.0f;
+      for (int i = -radius; i <= radius; i++) sum += weights[i + radius] = std::exp(-0.5f * i * i / (sigma * sigma));
+      for (auto &weight : weights) weight /= sum;
+
+      // Rows into a float image, then columns of it back into bytes
+      std::vector<float> horizontal(rowSize * height, 0.0f);
+      auto source = pixels(image);
+      forEachRow(width, height, pool, [&](size_t y) {
+        static thread_local std::vector<float> padded;
+        padded.resize((size_t) (width + 2 * radius) * 3);
+        loadPadded(source + y * rowSize, width, radius, padded.data());
+        auto out = horizontal.data() + y * rowSize;
+        for (size_t k = 0; k < weights.size(); k++) accumulate(out, padded.data() + k * 3, weights[k], rowSize);
+      });
+
+      auto target = pixels(result);
+      forEachRow(width, height, pool, [&](size_t y) {
+        static thread_local std::vector<float> out;
+        out.assign(rowSize, 0.0f);
+        for (int k = -radius; k <= radius; k++) {
+          int row = std::min(std::max((int) y + k, 0), height - 1);
+          accumulate(out.data(), horizontal.data() + row * rowSize, weights[k + radius], rowSize);
+        }
+        toBytes(out.data(), target + y * rowSize, rowSize);
+      });
+      return result;
+    }
+
+    Image convolve5x5(const Image &image, const float kernel[25], float factor, float bias, ThreadPool *pool) {
+      Image result{image.width, image.height};
+      if (image.width <= 0 || image.height <= 0) return result;
+      int width = image.width, height = image.height;
+      size_t rowSize = (size_t) width * 3, paddedSize = (size_t) (width + 4) * 3;
+
+      auto source = pixels(image);
+      auto target = pixels(result);
+      forEachRow(width, height, pool, [&](size_t y) {
+        static thread_local std::vector<float> padded, out;
+        padded.resize(paddedSize * 5);
+        out.assign(rowSize, bias * 255.0f);
+        for (int i = 0; i < 5; i++) {
+          int row = std::min(std::max((int) y + i - 2, 0), height - 1);
+          auto line = padded.data() + i * paddedSize;
+          loadPadded(source + row * rowSize, width, 2, line);
+          for (int j = 0; j < 5; j++) {
+            float weight = kernel[i * 5 + j] / factor;
+            if (weight != 0.0f) accumulate(out.data(), line + j * 3, weight, rowSize);
+          }
+        }
+        toBytes(out.data(), target + y * rowSize, rowSize);
+      });
+      return result;
+    }
+
+    void convertGamma(Image &image, bool toLinear, ThreadPool *pool) {
+      if (image.width <= 0 || image.height <= 0) return;
+      auto &tables = gammaTables();
+      uint8_t table[256];
+      for (int v = 0; v < 256; v++) table[v] = toLinear ? tables.toLinearByte[v] : tables.encode(v / 255.0f);
+
+      auto data = pixels(image);
+      size_t rowSize = (size_t) image.width * 3;
+      forEachRow(image.width, image.height, pool, [&](size_t y) {
+        auto row = data + y * rowSize;
+        for (size_t i = 0; i < rowSize; i++) row[i] = table[row[i]];
+      });
+    }
+
+    PlanarImage toPlanar(const Image &image, bool linear, ThreadPool *pool) {
+      PlanarImage result{image.width, image.height};
+      if (image.width <= 0 || image.height <= 0) return result;
+      auto &tables = gammaTables();
+      auto source = pixels(image);
+      int width = image.width;
+      forEachRow(width, image.height, pool, [&](size_t y) {
+        auto row = source + y * width * 3;
+        float *planes[3] = {result.row(0, (int) y), result.row(1, (int) y), result.row(2, (int) y)};
+        if (linear) {
+          for (int x = 0; x < width; x++)
+            for (int c = 0; c < 3; c++) planes[c][x] = tables.toLinear[row[x * 3 + c]];
+          return;
+        }
+        static thread_local std::vector<float> values;
+        values.resize((size_t) width * 3);
+        toFloat(row, values.data(), values.size());
+        for (int x = 0; x < width; x++)
+          for (int c = 0; c < 3; c++) planes[c][x] = values[x * 3 + c] * (1.0f / 255.0f);
+      });
+      return result;
+    }
+
+    Image fromPlanar(const PlanarImage &image, bool srgb, ThreadPool *pool) {
+      Image result{image.width, image.height};
+      if (image.width <= 0 || image.height <= 0) return result;
+      auto &tables = gammaTables();
+      auto target = pixels(result);
+      int width = image.width;
+      forEachRow(width, image.height, pool, [&](size_t y) {
+        auto row = target + y * width * 3;
+        const float *planes[3] = {image.row(0, (int) y), image.row(1, (int) y), image.row(2, (int) y)};
+        if (srgb) {
+          for (int x = 0; x < width; x++)
+            for (int c = 0; c < 3; c++) row[x * 3 + c] = tables.encode(planes[c][x]);
+          return;
+        }
+        static thread_local std::vector<float> values;
+        values.resize((size_t) width * 3);
+        for (int x = 0; x < width; x++)
+          for (int c = 0; c < 3; c++) values[x * 3 + c] = planes[c][x] * 255.0f;
+        toBytes(values.data(), row, values.size());
+      });
+      return result;
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "image.h"
+#include "planar_image.h"
+#include "thread_pool.h"
+
+namespace ppgso {
+namespace image {
+/*!
+ * Resize an image with bilinear filtering. Reductions by more than half skip source pixels, halve the image with
+ * downsample() first to keep all of them.
+ *
+ * @param image - Image to resize.
+ * @param width - Width of the result in pixels.
+ * @param height - Height of the result in pixels.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to filter on the calling thread only.
+ * @return - Resized image.
+ */
+  Image resize(const Image &image, int width, int height, ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Halve an image by averaging 2x2 pixels, the same filter buildMipChain uses for the levels of a texture.
+ *
+ * @param image - Image to halve, odd sizes repeat the last row or column.
+ * @param srgb - True to average colors in linear light, false for data such as normal maps.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to filter on the calling thread only.
+ * @return - Image of half the size, at least 1x1.
+ */
+  Image downsample(const Image &image, bool srgb = true, ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Blur an image with a Gaussian kernel as two separable passes, rows then columns. Pixels past the edges repeat
+ * the edge pixels.
+ *
+ * @param image - Image to blur.
+ * @param sigma - Standard deviation in pixels, the kernel reaches 3 sigma to each side.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to filter on the calling thread only.
+ * @return - Blurred image, a copy when sigma is not positive.
+ */
+  Image gaussianBlur(const Image &image, float sigma, ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Convolve an image with a 5x5 kernel like the convolution shader does, result = sum / factor + bias.
+ * Pixels past the edges repeat the edge pixels, results are clamped to <0, 255>.
+ *
+ * @param image - Image to convolve.
+ * @param kernel - 25 weights by rows from the top, the center weight applies to the pixel itself.
+ * @param factor - Divisor of the weighted sum, e.g. the sum of the weights.
+ * @param bias - Added to the result in the range <0, 1>.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to filter on the calling thread only.
+ * @return - Convolved image.
+ */
+  Image convolve5x5(const Image &image, const float kernel[25], float factor = 1.0f, float bias = 0.0f,
+                    ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Convert all pixels between sRGB and linear values in place, 8 bits per channel.
+ * Dark linear values lose precision, convert to PlanarImage to keep it.
+ *
+ * @param image - Image to convert.
+ * @param toLinear - True to decode sRGB into linear values, false to encode linear values as sRGB.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to convert on the calling thread only.
+ */
+  void convertGamma(Image &image, bool toLinear, ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Convert an image into floating point planes in the range <0, 1>.
+ *
+ * @param image - Image to convert.
+ * @param linear - True to decode sRGB colors into linear light.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to convert on the calling thread only.
+ * @return - Planar image of the same size.
+ */
+  PlanarImage toPlanar(const Image &image, bool linear = false, ThreadPool *pool = &ThreadPool::shared());
+
+/*!
+ * Convert floating point planes back to an image, values outside <0, 1> are clamped.
+ *
+ * @param image - Planar image to convert.
+ * @param srgb - True to encode linear light as sRGB colors.
+ * @param pool - Pool sharing the rows with the calling thread, nullptr to convert on the calling thread only.
+ * @return - Image of the same size.
+ */
+  Image fromPlanar(const PlanarImage &image, bool srgb = false, ThreadPool *pool = &ThreadPool::shared());
+
+}
+}
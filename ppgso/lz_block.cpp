@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+
+#include "lz_block.h"
+
+namespace ppgso {
+
+  // Limits of the LZ4 block format
+  static const size_t MIN_MATCH = 4;
+  static const size_t LAST_LITERALS = 5;        // The block always ends with at least 5 literals
+  static const size_t MATCH_LIMIT = 12;         // No match may start within the last 12 bytes
+  static const size_t MAX_OFFSET = 65535;
+  static const int HASH_BITS = 16;
+  static const size_t WILD_COPY = 16;           // Short copies move a fixed 16 bytes when the buffers have room
+
+  static uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+  }
+
+  // Lengths above the 4 bit token field continue in bytes of 255
+  static void writeLength(std::vector<uint8_t> &out, size_t length) {
+    while (length >= 255) {
+      out.push_back(255);
+      length -= 255;
+    }
+    out.push_back((uint8_t) length);
+  }
+
+  static bool readLength(const uint8_t *data, size_t size, size_t &pos, size_t &length) {
+    uint8_t byte;
+    do {
+      if (pos >= size) return false;
+      byte = data[pos++];
+      length += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  static void writeSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literalCount,
+                            size_t offset, size_t matchLength) {
+    size_t match = matchLength ? matchLength - MIN_MATCH : 0;
+    out.push_back((uint8_t) ((literalCount < 15 ? literalCount : 15) << 4 | (match < 15 ? match : 15)));
+    if (literalCount >= 15) writeLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (!matchLength) return;
+    out.push_back((uint8_t) (offset & 0xff));
+    out.push_back((uint8_t) (offset >> 8));
+    if (match >= 15) writeLength(out, match - 15);
+  }
+
+  size_t compressBlock(const uint8_t *data, size_t size, std::vector<uint8_t> &out) {
+    size_t start = out.size();
+    size_t anchor = 0, pos = 0;
+
+    if (size > MATCH_LIMIT) {
+      // Last position seen for every hash of 4 bytes, offset by one so zero means empty
+      std::vector<uint32_t> table((size_t) 1 << HASH_BITS, 0);
+      size_t lastStart = size - MATCH_LIMIT;
+      size_t matchEnd = size - LAST_LITERALS;
+
+      while (pos <= lastStart) {
+        uint32_t sequence = read32(data + pos);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        size_t candidate = table[hash];
+        table[hash] = (uint32_t) (pos + 1);
+
+        if (!candidate || pos - (candidate - 1) > MAX_OFFSET || read32(data + candidate - 1) != sequence) {
+          pos++;
+          continue;
+        }
+
+        // Extend backwards into the pending literals, then forwards as far as the format allows
+        size_t ref = candidate - 1;
+        while (pos > anchor && ref > 0 && data[pos - 1] == data[ref - 1]) {
+          pos--;
+          ref--;
+        }
+        size_t length = MIN_MATCH;
+        while (pos + length < matchEnd && data[ref + length] == data[pos + length]) length++;
+
+        writeSequence(out, data + anchor, pos - anchor, pos - ref, length);
+        pos += length;
+        anchor = pos;
+      }
+    }
+
+    writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return out.size() - start;
+  }
+
+  bool decompressBlock(const uint8_t *data, size_t size, uint8_t *out, size_t outSize) {
+    size_t in = 0, written = 0;
+    while (in < size) {
+      uint8_t token = data[in++];
+
+      size_t literals = token >> 4;
+      if (literals == 15 && !readLength(data, size, in, literals)) return false;
+      if (literals > size - in || literals > outSize - written) return false;
+      if (literals <= WILD_COPY && size - in >= WILD_COPY && outSize - written >= WILD_COPY) {
+        std::memcpy(out + written, data + in, WILD_COPY);
+      } else {
+        std::memcpy(out + written, data + in, literals);
+      }
+      in += literals;
+      written += literals;
+
+      // The last sequence has no match
+      if (in == size) break;
+
+      if (size - in < 2) return false;
+      size_t offset = data[in] | (size_t) data[in + 1] << 8;
+      in += 2;
+      if (offset == 0 || offset > written) return false;
+
+      size_t length = token & 15;
+      if (length == 15 && !readLength(data, size, in, length)) return false;
+      length += MIN_MATCH;
+      if (length > outSize - written) return false;
+
+      // Bytes written past the match are overwritten by the following sequences
+      uint8_t *dst = out + written;
+      if (offset >= WILD_COPY && outSize - written >= length + WILD_COPY) {
+        for (size_t copied = 0; copied < length; copied += WILD_COPY)
+          std::memcpy(dst + copied, dst + copied - offset, WILD_COPY);
+      } else {
+        // Overlapping matches repeat the last offset bytes, copy whole periods so every copy reads finished output
+        for (size_t copied = 0; copied < length;) {
+          size_t bytes = std::min(copied + offset, length - copied);
+          std::memcpy(dst + copied, dst - offset, bytes);
+          copied += bytes;
+        }
+      }
+      written += length;
+    }
+    return written == outSize;
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ppgso {
+
+  /*!
+   * Compress a block of data into the LZ4 block format: literal runs and back references of at least 4 bytes into
+   * the previous 64 KiB, found with a single hash probe per position. Favours decompression speed over ratio.
+   *
+   * @param data - Data to compress.
+   * @param size - Size of the data in bytes.
+   * @param out - Compressed block is appended to the vector.
+   * @return - Size of the compressed block in bytes, may exceed size for incompressible data.
+   */
+  size_t compressBlock(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+
+  /*!
+   * Decompress a block produced by compressBlock, checking every length and offset against both buffers.
+   *
+   * @param data - Compressed block.
+   * @param size - Size of the compressed block in bytes.
+   * @param out - Destination buffer.
+   * @param outSize - Exact size of the decompressed data.
+   * @return - False when the block is corrupted or does not decompress to exactly outSize bytes.
+   */
+  bool decompressBlock(const uint8_t *data, size_t size, uint8_t *out, size_t outSize);
+}
@@ -0,0 +1,96 @@
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+
+ppgso::MappedFile::MappedFile(const std::string &path) {
+  fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    fileHandle = nullptr;
+    std::stringstream msg;
+    msg << "Could not open file for mapping. " << path;
+    throw std::runtime_error(msg.str());
+  }
+
+  LARGE_INTEGER fileSize;
+  GetFileSizeEx(fileHandle, &fileSize);
+  length = (size_t) fileSize.QuadPart;
+  if (length == 0) return;
+
+  mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle)
+    mapped = (const uint8_t *) MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+  if (!mapped) {
+    if (mappingHandle) CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    std::stringstream msg;
+    msg << "Could not map file. " << path;
+    throw std::runtime_error(msg.str());
+  }
+}
+
+ppgso::MappedFile::~MappedFile() {
+  if (mapped) UnmapViewOfFile(mapped);
+  if (mappingHandle) CloseHandle(mappingHandle);
+  if (fileHandle) CloseHandle(fileHandle);
+}
+
+#else
+
+ppgso::MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::stringstream msg;
+    msg << "Could not open file for mapping. " << path;
+    throw std::runtime_error(msg.str());
+  }
+
+  struct stat st = {};
+  fstat(fd, &st);
+  length = (size_t) st.st_size;
+  if (length == 0) {
+    close(fd);
+    return;
+  }
+
+  void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+
+  if (ptr == MAP_FAILED) {
+    std::stringstream msg;
+    msg << "Could not map file. " << path;
+    throw std::runtime_error(msg.str());
+  }
+  madvise(ptr, length, MADV_SEQUENTIAL);
+  mapped = (const uint8_t *) ptr;
+}
+
+ppgso::MappedFile::~MappedFile() {
+  if (mapped) munmap((void *) mapped, length);
+}
+
+#endif
+
+const uint8_t *ppgso::MappedFile::data() const {
+  return mapped;
+}
+
+size_t ppgso::MappedFile::size() const {
+  return length;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace ppgso {
+
+  /*!
+   * Read-only memory mapping of a whole file.
+   *
+   * The mapping stays valid for the lifetime of the object, pointers returned by data() must not outlive it.
+   */
+  class MappedFile {
+  public:
+    /*!
+     * Map file into memory.
+     *
+     * @param path - File path to map.
+     */
+    MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /*!
+     * Get pointer to the first byte of the mapped file.
+     *
+     * @return - Pointer to mapped data, nullptr for empty files.
+     */
+    const uint8_t *data() const;
+
+    /*!
+     * Get size of the mapped file.
+     *
+     * @return - Size in bytes.
+     */
+    size_t size() const;
+
+  private:
+    const uint8_t *mapped = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+  };
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include "material_library.h"
+#include "tiny_obj_loader.h"
+
+namespace fs = std::filesystem;
+
+namespace ppgso {
+
+  // Suffixes of exported PBR base color textures, "Wood_baseColor.bmp" is the texture of material "Wood"
+  static const char *TEXTURE_SUFFIXES[] = {"_basecolor", "basecolor", "_albedo", "albedo", "_base"};
+
+  static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    return text;
+  }
+
+  MaterialLibrary::MaterialLibrary(std::shared_ptr<AssetPack> pack)
+          : pack{std::move(pack)}, fallback{std::make_shared<Material>()} {}
+
+  void MaterialLibrary::indexTextures(const std::vector<std::string> &textures) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto &texture : textures) {
+      auto stem = toLower(fs::path(texture).stem().string());
+      textureIndex.emplace(stem, texture);
+      for (auto suffix : TEXTURE_SUFFIXES) {
+        size_t length = std::strlen(suffix);
+        if (stem.size() > length && stem.compare(stem.size() - length, length, suffix) == 0)
+          textureIndex.emplace(stem.substr(0, stem.size() - length), texture);
+      }
+    }
+    stats.textures += textures.size();
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::string MaterialLibrary::findTexture(const std::string &name) const {
+    auto found = textureIndex.find(name);
+    return found != textureIndex.end() ? found->second : std::string();
+  }
+
+  std::shared_ptr<const Material> MaterialLibrary::parse(const std::string &mtl) {
+    std::string source;
+    if (pack && pack->contains(mtl, AssetPack::Type::Material)) {
+      source = pack->loadMaterial(mtl);
+    } else {
+      std::ifstream file(mtl, std::ios::binary);
+      if (!file.is_open()) return fallback;
+      std::stringstream buffer;
+      buffer << file.rdbuf();
+      source = buffer.str();
+    }
+
+    std::map<std::string, int> materialMap;
+    std::vector<tinyobj::material_t> materials;
+    std::istringstream stream(source);
+    if (!tinyobj::LoadMtl(materialMap, materials, stream).empty() || materials.empty()) return fallback;
+
+    auto &first = materials.front();
+    auto material = std::make_shared<Material>();
+    material->name = first.name;
+    material->diffuse = {first.diffuse[0], first.diffuse[1], first.diffuse[2]};
+    material->opacity = first.dissolve;
+    // map_Kd is a file name while material names may contain dots, so only the former loses its extension
+    if (!first.diffuse_texname.empty())
+      material->texture = findTexture(toLower(fs::path(first.diffuse_texname).stem().string()));
+    if (material->texture.empty()) material->texture = findTexture(toLower(first.name));
+    return material;
+  }
+
+  std::shared_ptr<const Material> MaterialLibrary::resolve(const std::string &mtl) {
+    auto start = std::chrono::steady_clock::now();
+    auto found = libraries.find(mtl);
+    if (found == libraries.end()) {
+      found = libraries.emplace(mtl, parse(mtl)).first;
+      stats.libraries++;
+    }
+
+    auto &material = found->second;
+    stats.resolved++;
+    if (!material->texture.empty()) stats.textured++;
+    if (material == fallback) stats.missing++;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return material;
+  }
+
+  MaterialLibrary::Stats MaterialLibrary::getStats() const {
+    return stats;
+  }
+
+  void MaterialLibrary::printStats(std::ostream &out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2) << "Materials: " << stats.resolved << " models resolved from "
+        << stats.libraries << " MTL files against " << stats.textures << " textures in " << stats.seconds * 1000.0
+        << " ms (" << stats.textured << " textured, " << stats.missing << " without material)" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "asset_pack.h"
+
+namespace ppgso {
+
+  /*!
+   * Surface of a model as described by the MTL file next to it, with the diffuse texture resolved.
+   */
+  struct Material {
+    std::string name;
+    glm::vec3 diffuse{1.0f};              // Kd
+    float opacity = 1.0f;                 // d, 1 is opaque
+    std::string texture;                  // Resolved texture path or asset name, empty when untextured
+  };
+
+  /*!
+   * Resolves models to materials without scanning directories per model.
+   *
+   * Texture names are indexed once, each MTL file is parsed once and models sharing it share the resolved material.
+   * The diffuse texture is looked up by the map_Kd file name, falling back to the material name, against texture
+   * stems with and without the "_baseColor", "_albedo" and "_base" suffixes of exported PBR textures.
+   */
+  class MaterialLibrary {
+  public:
+    /*!
+     * Resolution counters and time spent, including indexing and MTL parsing.
+     */
+    struct Stats {
+      size_t textures = 0;              // Indexed texture files
+      size_t libraries = 0;             // Parsed MTL files
+      size_t resolved = 0;              // resolve() calls
+      size_t textured = 0;              // Of those resolved to a texture
+      size_t missing = 0;               // Of those without a usable MTL file
+      double seconds = 0.0;
+    };
+
+    /*!
+     * Create an empty library.
+     *
+     * @param pack - Pack to read MTL files from before falling back to the disk, may be null.
+     */
+    explicit MaterialLibrary(std::shared_ptr<AssetPack> pack = nullptr);
+
+    /*!
+     * Index texture files, call once with every candidate before resolving.
+     *
+     * @param textures - Texture paths or asset names, earlier ones win when stems collide.
+     */
+    void indexTextures(const std::vector<std::string> &textures);
+
+    /*!
+     * Get the material of a model, parsing its MTL file on first use.
+     *
+     * @param mtl - Path or asset name of the MTL file, the first material in it is used.
+     * @return - Shared material, a white untextured one when the file is missing or empty.
+     */
+    std::shared_ptr<const Material> resolve(const std::string &mtl);
+
+    /*!
+     * Get resolution counters.
+     *
+     * @return - Current statistics.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print how many models were resolved and how long it took.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+  private:
+    std::shared_ptr<const Material> parse(const std::string &mtl);
+    std::string findTexture(const std::string &name) const;
+
+    std::shared_ptr<AssetPack> pack;
+    std::unordered_map<std::string, std::string> textureIndex;                  // Normalized stem to texture
+    std::unordered_map<std::string, std::shared_ptr<const Material>> libraries; // MTL path to its material
+    std::shared_ptr<const Material> fallback;
+    Stats stats;
+  };
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "memory_tracker.h"
+
+namespace ppgso {
+
+  static const char *CATEGORY_NAMES[] = {"buffers", "textures", "render targets", "CPU"};
+
+  struct TrackerState {
+    std::mutex mutex;
+    std::map<std::pair<MemoryTracker::Category, std::string>, MemoryTracker::Usage> usages;
+    size_t bytes[(int) MemoryTracker::Category::Count] = {};
+  };
+
+  // Never destroyed, resources in static storage may be released after it would be
+  static TrackerState &state() {
+    static auto *tracker = new TrackerState;
+    return *tracker;
+  }
+
+  static void add(MemoryTracker::Category category, MemoryTracker::Usage &usage, size_t bytes) {
+    usage.bytes += bytes;
+    usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+    state().bytes[(int) category] += bytes;
+  }
+
+  static void subtract(MemoryTracker::Category category, MemoryTracker::Usage &usage, size_t bytes) {
+    usage.bytes -= bytes;
+    state().bytes[(int) category] -= bytes;
+  }
+
+  MemoryTracker::Allocation::Allocation(Category category, const std::string &owner, size_t bytes)
+          : category{category}, bytes{bytes} {
+    auto &tracker = state();
+    std::lock_guard<std::mutex> lock{tracker.mutex};
+    usage = &tracker.usages[{category, owner}];
+    usage->allocations++;
+    add(category, *usage, bytes);
+  }
+
+  MemoryTracker::Allocation::Allocation(Allocation &&other) noexcept
+          : category{other.category}, usage{other.usage}, bytes{other.bytes} {
+    other.usage = nullptr;
+    other.bytes = 0;
+  }
+
+  MemoryTracker::Allocation &MemoryTracker::Allocation::operator=(Allocation &&other) noexcept {
+    if (this != &other) {
+      release();
+      category = other.category;
+      usage = other.usage;
+      bytes = other.bytes;
+      other.usage = nullptr;
+      other.bytes = 0;
+    }
+    return *this;
+  }
+
+  MemoryTracker::Allocation::~Allocation() {
+    release();
+  }
+
+  void MemoryTracker::Allocation::release() {
+    if (!usage) return;
+    std::lock_guard<std::mutex> lock{state().mutex};
+    subtract(category, *usage, bytes);
+    usage->allocations--;
+    usage = nullptr;
+    bytes = 0;
+  }
+
+  void MemoryTracker::Allocation::resize(size_t size) {
+    if (!usage) return;
+    std::lock_guard<std::mutex> lock{state().mutex};
+    subtract(category, *usage, bytes);
+    add(category, *usage, size);
+    bytes = size;
+  }
+
+  void MemoryTracker::Allocation::setOwner(const std::string &owner) {
+    if (!usage) return;
+    auto size = bytes;
+    *this = Allocation{category, owner, size};
+  }
+
+  size_t MemoryTracker::Allocation::getBytes() const {
+    return bytes;
+  }
+
+  MemoryTracker::Usage MemoryTracker::getUsage(Category category, const std::string &owner) {
+    auto &tracker = state();
+    std::lock_guard<std::mutex> lock{tracker.mutex};
+    auto found = tracker.usages.find({category, owner});
+    return found != tracker.usages.end() ? found->second : Usage{};
+  }
+
+  size_t MemoryTracker::getBytes(Category category) {
+    auto &tracker = state();
+    std::lock_guard<std::mutex> lock{tracker.mutex};
+    return tracker.bytes[(int) category];
+  }
+
+  size_t MemoryTracker::getGpuBytes() {
+    return getBytes(Category::Buffer) + getBytes(Category::Texture) + getBytes(Category::RenderTarget);
+  }
+
+  void MemoryTracker::printTotals(std::ostream &out) {
+    double mb = 1024.0 * 1024.0;
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1) << "Memory: " << getGpuBytes() / mb << " MB GPU (";
+    for (int i = 0; i < (int) Category::Cpu; i++)
+      out << (i ? ", " : "") << getBytes((Category) i) / mb << " MB " << CATEGORY_NAMES[i];
+    out << "), " << getBytes(Category::Cpu) / mb << " MB CPU" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+  void MemoryTracker::printStats(std::ostream &out) {
+    printTotals(out);
+
+    std::vector<std::pair<std::pair<Category, std::string>, Usage>> usages;
+    {
+      auto &tracker = state();
+      std::lock_guard<std::mutex> lock{tracker.mutex};
+      usages.assign(tracker.usages.begin(), tracker.usages.end());
+    }
+    std::stable_sort(usages.begin(), usages.end(), [](auto &a, auto &b) {
+      return a.first.first != b.first.first ? a.first.first < b.first.first : a.second.bytes > b.second.bytes;
+    });
+
+    double mb = 1024.0 * 1024.0;
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    for (auto &[key, usage] : usages) {
+      out << "  " << std::left << std::setw(16) << CATEGORY_NAMES[(int) key.first] << std::setw(28) << key.second
+          << std::right << std::setw(9) << usage.bytes / mb << " MB in " << usage.allocations << " allocations (peak "
+          << usage.peakBytes / mb << " MB)" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
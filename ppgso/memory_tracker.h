@@ -0,0 +1,122 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+namespace ppgso {
+
+  /*!
+   * Accounting of the memory held by buffers, textures, render targets and CPU side data.
+   *
+   * Every resource keeps an Allocation tagged with a category and an owner, such as the class or the subsystem which
+   * created it. Allocations add their size to the totals of their category and owner while they live, which makes
+   * the cost of a scene visible at runtime. GPU sizes are computed from the requested formats, drivers may pad them.
+   */
+  class MemoryTracker {
+  public:
+    enum class Category {
+      Buffer,           // Vertex, index and other GPU buffers
+      Texture,          // Sampled textures including their mipmaps
+      RenderTarget,     // Framebuffer attachments such as shadow maps
+      Cpu,              // CPU side copies and metadata of uploaded resources
+      Count
+    };
+
+    /*!
+     * Totals of a single category and owner.
+     */
+    struct Usage {
+      size_t allocations = 0;
+      size_t bytes = 0;
+      size_t peakBytes = 0;
+    };
+
+    /*!
+     * Tracked block of memory, counted from construction until destruction. Movable, not copyable.
+     */
+    class Allocation {
+    public:
+      Allocation() = default;
+
+      /*!
+       * Start tracking memory.
+       *
+       * @param category - What kind of memory it is.
+       * @param owner - Who holds it, allocations of the same category and owner are reported together.
+       * @param bytes - Initial size.
+       */
+      Allocation(Category category, const std::string &owner, size_t bytes = 0);
+
+      Allocation(Allocation &&other) noexcept;
+      Allocation &operator=(Allocation &&other) noexcept;
+      Allocation(const Allocation &) = delete;
+      Allocation &operator=(const Allocation &) = delete;
+      ~Allocation();
+
+      /*!
+       * Change the size, e.g. when a buffer grows or a CPU copy is dropped.
+       *
+       * @param bytes - New size.
+       */
+      void resize(size_t bytes);
+
+      /*!
+       * Report the memory under another owner.
+       *
+       * @param owner - New owner.
+       */
+      void setOwner(const std::string &owner);
+
+      /*!
+       * Get tracked size.
+       *
+       * @return - Size in bytes.
+       */
+      size_t getBytes() const;
+
+    private:
+      void release();
+
+      Category category = Category::Cpu;
+      Usage *usage = nullptr;
+      size_t bytes = 0;
+    };
+
+    /*!
+     * Get totals of a category and owner.
+     *
+     * @param category - Category of the allocations.
+     * @param owner - Owner of the allocations.
+     * @return - Copy of the totals, empty when nothing was tracked.
+     */
+    static Usage getUsage(Category category, const std::string &owner);
+
+    /*!
+     * Get bytes currently tracked in a category.
+     *
+     * @param category - Category to sum.
+     * @return - Size in bytes.
+     */
+    static size_t getBytes(Category category);
+
+    /*!
+     * Get bytes currently tracked in all GPU categories.
+     *
+     * @return - Size in bytes.
+     */
+    static size_t getGpuBytes();
+
+    /*!
+     * Print GPU and CPU totals on a single line.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printTotals(std::ostream &out);
+
+    /*!
+     * Print the totals followed by every category and owner, largest first.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printStats(std::ostream &out);
+  };
+}
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "mesh_base.h"
+
+namespace ppgso {
+  static std::mutex statsMutex;
+  static std::map<int, GeometryArena *> arenas;
+  static MeshBase::Stats totalStats;
+  static size_t trianglesSubmitted = 0;
+  static MeshBase::CullStats cullStats;
+
+  // Add or remove counters of a single mesh from the totals
+  static void accumulate(const MeshBase::Stats &stats, bool add) {
+    auto apply = [add](size_t &total, size_t value) { total = add ? total + value : total - value; };
+    std::lock_guard<std::mutex> lock{statsMutex};
+    apply(totalStats.meshes, stats.meshes);
+    apply(totalStats.shapes, stats.shapes);
+    apply(totalStats.buffers, stats.buffers);
+    apply(totalStats.vertexArrays, stats.vertexArrays);
+    apply(totalStats.bytes, stats.bytes);
+    apply(totalStats.separateBuffers, stats.separateBuffers);
+    apply(totalStats.separateVertexArrays, stats.separateVertexArrays);
+    apply(totalStats.separateBytes, stats.separateBytes);
+  }
+
+  // Compact vertex, decoded by the shader with the constant attributes set in render()
+  struct CompactVertex {
+    int16_t position[4];    // Normalized to mesh bounds, w unused padding
+    uint16_t texcoord[2];   // Normalized to texture coordinate bounds
+    int16_t normal[2];      // Octahedral encoding
+  };
+
+  static int16_t snorm16(float value) {
+    return (int16_t) std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+  }
+
+  static uint16_t unorm16(float value) {
+    return (uint16_t) std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+  }
+
+  // Project the unit normal onto an octahedron and unfold the lower half, see Cigolle et al. 2014
+  static glm::vec2 octahedral(glm::vec3 n) {
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (length == 0.0f) return {0.0f, 0.0f};
+    n /= length;
+    if (n.z >= 0.0f) return {n.x, n.y};
+    return {(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)};
+  }
+
+  // One arena per vertex layout, never destroyed as meshes in static storage may be released after it
+  static GeometryArena &arenaFor(MeshBase::VertexFormat format, bool hasTexcoords, bool hasNormals) {
+    bool compact = format == MeshBase::VertexFormat::Compact;
+    int key = compact ? 4 : (hasTexcoords ? 2 : 0) | (hasNormals ? 1 : 0);
+    auto &arena = arenas[key];
+    if (arena) return *arena;
+
+    // Bind the attributes to "Position", "TexCoord" and "Normal" in program
+    if (compact) {
+      arena = new GeometryArena("compact", sizeof(CompactVertex), []() {
+        auto stride = (GLsizei) sizeof(CompactVertex);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void *) offsetof(CompactVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *) offsetof(CompactVertex, texcoord));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void *) offsetof(CompactVertex, normal));
+      });
+      return *arena;
+    }
+
+    size_t floats = 3 + (hasTexcoords ? 2 : 0) + (hasNormals ? 3 : 0);
+    std::string name = std::string{"float"} + (hasTexcoords ? "+uv" : "") + (hasNormals ? "+normal" : "");
+    arena = new GeometryArena(name, floats * sizeof(float), [=]() {
+      auto stride = (GLsizei) (floats * sizeof(float));
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+      if (hasTexcoords) {
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void *) (3 * sizeof(float)));
+      }
+      if (hasNormals) {
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void *) ((hasTexcoords ? 5 : 3) * sizeof(float)));
+      }
+    });
+    return *arena;
+  }
+}
+
+void ppgso::MeshBase::upload(const MeshData &data, VertexFormat vertexFormat) {
+  auto views = data.views();
+  format = vertexFormat;
+
+  // Attributes missing in some shapes are zero filled, which matches a disabled attribute array
+  bool hasTexcoords = false, hasNormals = false;
+  size_t vertexCount = 0, indexBytes = 0;
+  glm::vec2 uvMin{0.0f}, uvMax{0.0f};
+  for (auto &shape : views) {
+    if (shape.texcoords) {
+      for (uint32_t i = 0; i < shape.vertexCount; i++) {
+        glm::vec2 uv{shape.texcoords[i * 2], shape.texcoords[i * 2 + 1]};
+        uvMin = hasTexcoords || i ? glm::min(uvMin, uv) : uv;
+        uvMax = hasTexcoords || i ? glm::max(uvMax, uv) : uv;
+      }
+    }
+    hasTexcoords |= shape.texcoords != nullptr;
+    hasNormals |= shape.normals != nullptr;
+    vertexCount += shape.vertexCount;
+
+    // Keep every shape 4 byte aligned as 16bit and 32bit indices are mixed in one buffer
+    size_t indexSize = shape.vertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+    indexBytes += (shape.indexCount * indexSize + 3) & ~(size_t) 3;
+
+    usage.separateBuffers += 2 + (shape.texcoords ? 1 : 0) + (shape.normals ? 1 : 0);
+    usage.separateVertexArrays++;
+  }
+  usage.separateBytes = data.byteSize();
+
+  // Shapes with fewer levels draw their coarsest one, so a mesh level is as bad as the worst shape at that level
+  size_t levelCount = 1;
+  for (auto &shape : views) levelCount = std::max(levelCount, (size_t) shape.lodCount);
+  lodErrors.assign(levelCount, 0.0f);
+  for (auto &shape : views)
+    for (size_t l = 0; l < levelCount && shape.lodCount; l++)
+      lodErrors[l] = std::max(lodErrors[l], shape.lods[std::min(l, (size_t) shape.lodCount - 1)].error);
+
+  size_t stride = 3 + (hasTexcoords ? 2 : 0) + (hasNormals ? 3 : 0);
+  size_t vertexSize = format == VertexFormat::Compact ? sizeof(CompactVertex) : stride * sizeof(float);
+  std::vector<uint8_t> vertices(vertexCount * vertexSize, 0);
+  std::vector<uint8_t> indices(indexBytes, 0);
+
+  // Dequantization transforms, identity for float vertices
+  data.bounds(boundsMin, boundsMax);
+  glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+  glm::vec3 extent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3{1e-6f});
+  glm::vec2 uvRange = glm::max(uvMax - uvMin, glm::vec2{1e-6f});
+  if (format == VertexFormat::Compact) {
+    positionOffset = {center, 1.0f};
+    positionScale = {extent, 0.0f};
+    texCoordTransform = {uvMin, uvRange};
+  }
+
+  size_t vertex = 0, indexOffset = 0;
+  for (auto &shape : views) {
+    gl_shape draw;
+    draw.indexType = shape.vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    draw.baseVertex = (GLint) vertex;
+    size_t indexSize = draw.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (shape.lodCount == 0) draw.levels.push_back({(GLsizei) shape.indexCount, indexOffset});
+    for (uint32_t l = 0; l < shape.lodCount; l++) {
+      auto &lod = shape.lods[l];
+      draw.levels.push_back({(GLsizei) lod.indexCount, indexOffset + lod.indexOffset * indexSize});
+    }
+    draw.meshlets.assign(shape.meshlets, shape.meshlets + shape.meshletCount);
+    shapes.push_back(std::move(draw));
+    auto &drawn = shapes.back();
+
+    for (uint32_t i = 0; i < shape.vertexCount; i++) {
+      if (format == VertexFormat::Compact) {
+        auto &out = *(CompactVertex *) &vertices[(vertex + i) * vertexSize];
+        glm::vec3 p = (glm::vec3{shape.positions[i * 3], shape.positions[i * 3 + 1], shape.positions[i * 3 + 2]} - center) / extent;
+        out.position[0] = snorm16(p.x);
+        out.position[1] = snorm16(p.y);
+        out.position[2] = snorm16(p.z);
+        if (shape.texcoords) {
+          glm::vec2 uv = (glm::vec2{shape.texcoords[i * 2], shape.texcoords[i * 2 + 1]} - uvMin) / uvRange;
+          out.texcoord[0] = unorm16(uv.x);
+          out.texcoord[1] = unorm16(uv.y);
+        }
+        if (shape.normals) {
+          auto n = octahedral({shape.normals[i * 3], shape.normals[i * 3 + 1], shape.normals[i * 3 + 2]});
+          out.normal[0] = snorm16(n.x);
+          out.normal[1] = snorm16(n.y);
+        }
+        continue;
+      }
+
+      auto out = (float *) &vertices[(vertex + i) * vertexSize];
+      std::memcpy(out, shape.positions + i * 3, 3 * sizeof(float));
+      out += 3;
+      if (hasTexcoords) {
+        if (shape.texcoords) std::memcpy(out, shape.texcoords + i * 2, 2 * sizeof(float));
+        out += 2;
+      }
+      if (hasNormals && shape.normals) std::memcpy(out, shape.normals + i * 3, 3 * sizeof(float));
+    }
+
+    if (drawn.indexType == GL_UNSIGNED_SHORT) {
+      auto out = (uint16_t *) &indices[indexOffset];
+      for (uint32_t i = 0; i < shape.indexCount; i++) out[i] = (uint16_t) shape.indices[i];
+      indexOffset += (shape.indexCount * sizeof(uint16_t) + 3) & ~(size_t) 3;
+    } else {
+      if (shape.indexCount) std::memcpy(&indices[indexOffset], shape.indices, shape.indexCount * sizeof(uint32_t));
+      indexOffset += shape.indexCount * sizeof(uint32_t);
+    }
+    vertex += shape.vertexCount;
+  }
+
+  // Sub-allocate both ranges in the shared buffers, shapes were laid out relative to their start
+  arena = &arenaFor(format, hasTexcoords, hasNormals);
+  if (vertexCount && indexOffset) {
+    firstVertex = arena->allocateVertices(vertices.data(), vertexCount);
+    indexRange = arena->allocateIndices(indices.data(), indices.size());
+    for (auto &shape : shapes) {
+      shape.baseVertex += (GLint) firstVertex;
+      for (auto &level : shape.levels) level.indexOffset += indexRange;
+    }
+  }
+
+  usage.meshes = 1;
+  usage.shapes = views.size();
+  usage.bytes = vertices.size() + indices.size();
+  accumulate(usage, true);
+
+  // Geometry lives in the arena, only the LOD ranges and meshlet bounds stay on the CPU for drawing and culling
+  size_t cpuBytes = shapes.capacity() * sizeof(gl_shape);
+  for (auto &shape : shapes)
+    cpuBytes += shape.levels.capacity() * sizeof(gl_range) + shape.meshlets.capacity() * sizeof(Meshlet);
+  cpuMemory = {MemoryTracker::Category::Cpu, "Mesh metadata", cpuBytes};
+}
+
+ppgso::MeshBase::~MeshBase() {
+  accumulate(usage, false);
+  if (firstVertex != RangeAllocator::invalid) arena->freeVertices(firstVertex);
+  if (indexRange != RangeAllocator::invalid) arena->freeIndices(indexRange);
+}
+
+void ppgso::MeshBase::render(int lod) {
+  if (!arena) return;
+
+  // Dequantization constants are generic attribute values, so every shader sees the ones of the mesh being drawn
+  glVertexAttrib4fv(3, glm::value_ptr(positionOffset));
+  glVertexAttrib4fv(4, glm::value_ptr(positionScale));
+  glVertexAttrib4fv(5, glm::value_ptr(texCoordTransform));
+
+  // Draw all shapes from the shared buffers
+  arena->bind();
+  for (auto &shape : shapes) {
+    auto &level = shape.levels[std::min(std::max(lod, 0), (int) shape.levels.size() - 1)];
+    glDrawElementsBaseVertex(GL_TRIANGLES, level.size, shape.indexType, (void *) level.indexOffset, shape.baseVertex);
+    trianglesSubmitted += level.size / 3;
+  }
+}
+
+void ppgso::MeshBase::render(int lod, const MeshletCuller &culler) {
+  if (!arena) return;
+
+  glVertexAttrib4fv(3, glm::value_ptr(positionOffset));
+  glVertexAttrib4fv(4, glm::value_ptr(positionScale));
+  glVertexAttrib4fv(5, glm::value_ptr(texCoordTransform));
+
+  // Scratch arrays for glMultiDrawElementsBaseVertex, reused between draws
+  static std::vector<GLsizei> counts;
+  static std::vector<const void *> offsets;
+  static std::vector<GLint> baseVertices;
+
+  arena->bind();
+  for (auto &shape : shapes) {
+    int level = std::min(std::max(lod, 0), (int) shape.levels.size() - 1);
+    auto &range = shape.levels[level];
+    if (level > 0 || shape.meshlets.empty()) {
+      glDrawElementsBaseVertex(GL_TRIANGLES, range.size, shape.indexType, (void *) range.indexOffset, shape.baseVertex);
+      trianglesSubmitted += range.size / 3;
+      continue;
+    }
+
+    // Meshlets are stored in draw order, neighbouring survivors extend the previous range
+    size_t indexSize = shape.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    counts.clear();
+    offsets.clear();
+    uint32_t rangeEnd = ~0u;
+    for (auto &meshlet : shape.meshlets) {
+      cullStats.tested++;
+      auto result = culler.test(meshlet);
+      if (result == MeshletCuller::Outside) cullStats.outside++;
+      if (result == MeshletCuller::BackFacing) cullStats.backFacing++;
+      if (result != MeshletCuller::Visible) continue;
+
+      if (meshlet.indexOffset == rangeEnd) {
+        counts.back() += (GLsizei) meshlet.indexCount;
+      } else {
+        counts.push_back((GLsizei) meshlet.indexCount);
+        offsets.push_back((const void *) (range.indexOffset + meshlet.indexOffset * indexSize));
+      }
+      rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+      trianglesSubmitted += meshlet.indexCount / 3;
+    }
+    if (counts.empty()) continue;
+
+    baseVertices.assign(counts.size(), shape.baseVertex);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), shape.indexType, offsets.data(), (GLsizei) counts.size(),
+                                  baseVertices.data());
+    cullStats.ranges += counts.size();
+  }
+}
+
+const std::vector<float> &ppgso::MeshBase::getLodErrors() const {
+  return lodErrors;
+}
+
+void ppgso::MeshBase::getBounds(glm::vec3 &min, glm::vec3 &max) const {
+  min = boundsMin;
+  max = boundsMax;
+}
+
+size_t ppgso::MeshBase::getTrianglesSubmitted() {
+  return trianglesSubmitted;
+}
+
+void ppgso::MeshBase::resetTrianglesSubmitted() {
+  trianglesSubmitted = 0;
+}
+
+ppgso::MeshBase::CullStats ppgso::MeshBase::getCullStats() {
+  return cullStats;
+}
+
+void ppgso::MeshBase::resetCullStats() {
+  cullStats = {};
+}
+
+ppgso::MeshBase::VertexFormat ppgso::MeshBase::getFormat() const {
+  return format;
+}
+
+size_t ppgso::MeshBase::getBytes() const {
+  return usage.bytes;
+}
+
+ppgso::MeshBase::Stats ppgso::MeshBase::getStats() {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  auto stats = totalStats;
+  stats.buffers = arenas.size() * 2;
+  stats.vertexArrays = arenas.size();
+  return stats;
+}
+
+void ppgso::MeshBase::printStats(std::ostream &out) {
+  auto stats = getStats();
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(2)
+      << "Mesh buffers: " << stats.meshes << " meshes, " << stats.shapes << " shapes, "
+      << stats.buffers << " buffers + " << stats.vertexArrays << " VAOs, " << stats.bytes / (1024.0 * 1024.0)
+      << " MB (separate per shape: " << stats.separateBuffers << " buffers + " << stats.separateVertexArrays
+      << " VAOs, " << stats.separateBytes / (1024.0 * 1024.0) << " MB)" << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+  for (auto &arena : arenas) arena.second->printStats(out);
+}
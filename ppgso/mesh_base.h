@@ -0,0 +1,193 @@
+#pragma once
+#include <vector>
+#include <ostream>
+
+#include <GL/glew.h>
+
+#include "mesh_data.h"
+#include "meshlet.h"
+#include "geometry_arena.h"
+
+namespace ppgso {
+
+  /*!
+   * OpenGL side of a mesh shared by all mesh loaders.
+   *
+   * All shapes of a mesh are stored as one interleaved vertex range and one index range in the GeometryArena of its
+   * vertex layout, so meshes of the same layout share buffers and a vertex array object. Shapes with up to 65536
+   * vertices use 16bit indices. Geometry is bound to the shader program as follows:
+   * vec3 Position - Vertex position, position 0
+   * vec2 TexCoord - Texture coordinate, position 1
+   * vec3 Normal - Normal vector, position 2
+   *
+   * With VertexFormat::Compact the attributes are quantized and have to be decoded by the shader using constant
+   * attributes set by render():
+   * vec4 PositionOffset - Position = Position * PositionScale.xyz + PositionOffset.xyz, position 3
+   *                       PositionOffset.w is 1 when Normal.xy holds an octahedral encoded normal
+   * vec4 PositionScale - Position dequantization scale, position 4
+   * vec4 TexCoordTransform - TexCoord = TexCoordTransform.xy + TexCoord * TexCoordTransform.zw, position 5
+   * For VertexFormat::Float these are set to the identity, so shaders decoding them work with both formats.
+   */
+  class MeshBase {
+  public:
+    /*!
+     * Vertex layout of the uploaded geometry.
+     */
+    enum class VertexFormat {
+      Float,    // 32bit float position, texture coordinate and normal
+      Compact   // 16bit normalized position within mesh bounds, octahedral normal and texture coordinate, 16 bytes
+    };
+
+
+    /*!
+     * GPU buffer counters of all live meshes, compared with one buffer per attribute and shape.
+     */
+    struct Stats {
+      size_t meshes = 0;
+      size_t shapes = 0;
+      size_t buffers = 0;               // Vertex and index buffers of all arenas
+      size_t vertexArrays = 0;          // One per arena
+      size_t bytes = 0;                 // Allocated by the meshes within the arenas
+      size_t separateBuffers = 0;       // Same geometry with separate position/uv/normal/index buffers per shape
+      size_t separateVertexArrays = 0;
+      size_t separateBytes = 0;
+    };
+
+    /*!
+     * Meshlet culling counters of render() calls with a MeshletCuller.
+     */
+    struct CullStats {
+      size_t tested = 0;
+      size_t outside = 0;               // Rejected by the view frustum
+      size_t backFacing = 0;            // Rejected by the normal cone
+      size_t ranges = 0;                // Contiguous index ranges drawn from the surviving meshlets
+    };
+
+  protected:
+    struct gl_range {
+      GLsizei size = 0;                 // Number of indices
+      size_t indexOffset = 0;           // Offset into the arena index buffer in bytes
+    };
+    struct gl_shape {
+      std::vector<gl_range> levels;     // Index ranges from full detail to coarsest
+      GLenum indexType = GL_UNSIGNED_INT;
+      GLint baseVertex = 0;             // First vertex of the shape in the arena vertex buffer
+      std::vector<Meshlet> meshlets;    // Partition of the full detail level, offsets in indices of the shape
+    };
+    std::vector<gl_shape> shapes;
+    std::vector<float> lodErrors{0.0f};
+    glm::vec3 boundsMin{0.0f}, boundsMax{0.0f};
+    GeometryArena *arena = nullptr;
+    size_t firstVertex = RangeAllocator::invalid;
+    size_t indexRange = RangeAllocator::invalid;
+    VertexFormat format = VertexFormat::Float;
+    glm::vec4 positionOffset{0.0f};
+    glm::vec4 positionScale{1.0f, 1.0f, 1.0f, 0.0f};
+    glm::vec4 texCoordTransform{0.0f, 0.0f, 1.0f, 1.0f};
+    Stats usage;
+    MemoryTracker::Allocation cpuMemory;
+
+    /*!
+     * Upload decoded geometry into the arena of its layout, interleaving position, texture coordinate and normal of
+     * every vertex.
+     *
+     * @param data - Geometry to upload.
+     * @param format - Vertex layout to use.
+     */
+    void upload(const MeshData &data, VertexFormat format = VertexFormat::Float);
+
+  public:
+    MeshBase() = default;
+    MeshBase(const MeshBase &) = delete;
+    MeshBase &operator=(const MeshBase &) = delete;
+
+    /*!
+     * Free the ranges of the mesh in its arena.
+     */
+    virtual ~MeshBase();
+
+    /*!
+     * Render the geometry associated with the mesh using glDrawElementsBaseVertex.
+     *
+     * @param lod - Level of detail, shapes with fewer levels draw their coarsest one.
+     */
+    void render(int lod = 0);
+
+    /*!
+     * Render the geometry, skipping meshlets of the full detail level rejected by the culler.
+     * Surviving meshlets are merged into contiguous ranges drawn with glMultiDrawElementsBaseVertex.
+     *
+     * @param lod - Level of detail, coarser levels are drawn whole.
+     * @param culler - Camera and model transform of this draw.
+     */
+    void render(int lod, const MeshletCuller &culler);
+
+    /*!
+     * Get deviation of every level of detail from the full detail mesh, see selectLod().
+     *
+     * @return - Errors in mesh units, the first level is always 0.
+     */
+    const std::vector<float> &getLodErrors() const;
+
+    /*!
+     * Get axis aligned bounds of the mesh.
+     *
+     * @param min - Minimum corner.
+     * @param max - Maximum corner.
+     */
+    void getBounds(glm::vec3 &min, glm::vec3 &max) const;
+
+    /*!
+     * Get number of triangles submitted by render() since the last reset.
+     *
+     * @return - Triangle count.
+     */
+    static size_t getTrianglesSubmitted();
+
+    /*!
+     * Reset the submitted triangle counter, usually once per frame.
+     */
+    static void resetTrianglesSubmitted();
+
+    /*!
+     * Get meshlet culling counters since the last reset.
+     *
+     * @return - Copy of the counters.
+     */
+    static CullStats getCullStats();
+
+    /*!
+     * Reset the meshlet culling counters, usually once per frame.
+     */
+    static void resetCullStats();
+
+    /*!
+     * Get vertex layout of the mesh.
+     *
+     * @return - Format chosen on upload.
+     */
+    VertexFormat getFormat() const;
+
+    /*!
+     * Get memory allocated by the mesh within its arena.
+     *
+     * @return - Size of its vertices and indices in bytes.
+     */
+    size_t getBytes() const;
+
+    /*!
+     * Get buffer counters summed over all live meshes.
+     *
+     * @return - Copy of current statistics.
+     */
+    static Stats getStats();
+
+    /*!
+     * Print buffer count and memory of the shared layout next to the separate buffer layout, followed by the usage
+     * and fragmentation of every arena.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printStats(std::ostream &out);
+  };
+}
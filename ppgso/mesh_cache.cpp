@@ -0,0 +1,304 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+#include "hash.h"
+#include "mesh_cache.h"
+
+namespace fs = std::filesystem;
+
+namespace ppgso {
+
+  // On-disk layout, all arrays are stored 16 byte aligned after the shape table
+  static const char CACHE_MAGIC[4] = {'P', 'P', 'G', 'M'};
+  static const uint32_t CACHE_VERSION = 4;
+  static const char *CACHE_EXTENSION = ".meshcache";
+
+  struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t shapeCount;
+    uint32_t reserved;
+  };
+  static_assert(sizeof(CacheHeader) == 40, "Unexpected mesh cache header size");
+
+  struct CacheShape {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t flags;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    uint32_t reserved;
+    uint64_t positions;
+    uint64_t texcoords;
+    uint64_t normals;
+    uint64_t indices;
+    uint64_t lods;
+    uint64_t meshlets;
+  };
+  static_assert(sizeof(MeshLod) == 12, "Unexpected mesh LOD record size");
+  static_assert(sizeof(Meshlet) == 40, "Unexpected meshlet record size");
+  static_assert(sizeof(CacheShape) == 96, "Unexpected mesh cache shape record size");
+
+  struct SourceSignature {
+    uint64_t size = 0;
+    int64_t time = 0;
+  };
+
+  static bool sourceSignature(const std::string &source, SourceSignature &signature) {
+    std::error_code ec;
+    auto size = fs::file_size(source, ec);
+    if (ec) return false;
+    auto time = fs::last_write_time(source, ec);
+    if (ec) return false;
+    signature.size = (uint64_t) size;
+    signature.time = (int64_t) time.time_since_epoch().count();
+    return true;
+  }
+
+  static uint64_t sourceHash(const std::string &source) {
+    MappedFile file{source};
+    return hash64(file.data(), file.size());
+  }
+
+  static uint64_t align16(uint64_t offset) {
+    return (offset + 15) & ~uint64_t{15};
+  }
+
+  static std::mutex statsMutex;
+  static MeshCache::Stats stats;
+
+  bool MeshCache::enabled = true;
+
+  MeshCache::MeshCache(std::unique_ptr<MappedFile> file, std::vector<MeshShapeView> shapes)
+          : file{std::move(file)}, shapes{std::move(shapes)} {}
+
+  std::string MeshCache::pathFor(const std::string &source) {
+    return source + CACHE_EXTENSION;
+  }
+
+  std::shared_ptr<MeshCache> MeshCache::open(const std::string &source) {
+    auto path = pathFor(source);
+    SourceSignature signature;
+    if (!fs::exists(path) || !sourceSignature(source, signature)) return nullptr;
+
+    std::unique_ptr<MappedFile> file;
+    try {
+      file = std::make_unique<MappedFile>(path);
+    } catch (std::exception &) {
+      return nullptr;
+    }
+
+    std::vector<MeshShapeView> shapes;
+    if (!parse(file->data(), file->size(), shapes)) return nullptr;
+
+    // Cheap checks first, hash the source only when size and time match
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.sourceSize != signature.size || header.sourceTime != signature.time) return nullptr;
+    if (header.sourceHash != sourceHash(source)) return nullptr;
+
+    return std::shared_ptr<MeshCache>(new MeshCache(std::move(file), std::move(shapes)));
+  }
+
+  bool MeshCache::parse(const uint8_t *data, size_t bytes, std::vector<MeshShapeView> &shapes) {
+    auto size = (uint64_t) bytes;
+    if (!data || size < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION) return false;
+
+    uint64_t tableEnd = sizeof(CacheHeader) + (uint64_t) header.shapeCount * sizeof(CacheShape);
+    if (tableEnd > size) return false;
+
+    auto inRange = [&](uint64_t offset, uint64_t bytes) {
+      return offset == 0 || (offset >= tableEnd && offset + bytes <= size && offset % 4 == 0);
+    };
+
+    shapes.assign(header.shapeCount, MeshShapeView{});
+    for (uint32_t i = 0; i < header.shapeCount; i++) {
+      CacheShape record;
+      std::memcpy(&record, data + sizeof(CacheHeader) + i * sizeof(CacheShape), sizeof(record));
+
+      uint64_t vertices = record.vertexCount;
+      if (!inRange(record.positions, vertices * 3 * sizeof(float)) ||
+          !inRange(record.texcoords, vertices * 2 * sizeof(float)) ||
+          !inRange(record.normals, vertices * 3 * sizeof(float)) ||
+          !inRange(record.indices, (uint64_t) record.indexCount * sizeof(unsigned int)) ||
+          !inRange(record.lods, (uint64_t) record.lodCount * sizeof(MeshLod)) ||
+          !inRange(record.meshlets, (uint64_t) record.meshletCount * sizeof(Meshlet)))
+        return false;
+
+      auto &shape = shapes[i];
+      shape.vertexCount = record.vertexCount;
+      shape.indexCount = record.indexCount;
+      shape.positions = record.positions ? (const float *) (data + record.positions) : nullptr;
+      shape.texcoords = record.texcoords ? (const float *) (data + record.texcoords) : nullptr;
+      shape.normals = record.normals ? (const float *) (data + record.normals) : nullptr;
+      shape.indices = record.indices ? (const unsigned int *) (data + record.indices) : nullptr;
+      shape.lods = record.lods ? (const MeshLod *) (data + record.lods) : nullptr;
+      shape.lodCount = shape.lods ? record.lodCount : 0;
+      for (uint32_t l = 0; l < shape.lodCount; l++)
+        if ((uint64_t) shape.lods[l].indexOffset + shape.lods[l].indexCount > record.indexCount) return false;
+      shape.meshlets = record.meshlets ? (const Meshlet *) (data + record.meshlets) : nullptr;
+      shape.meshletCount = shape.meshlets ? record.meshletCount : 0;
+      for (uint32_t m = 0; m < shape.meshletCount; m++)
+        if ((uint64_t) shape.meshlets[m].indexOffset + shape.meshlets[m].indexCount > record.indexCount) return false;
+      shape.boundsMin = {record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]};
+      shape.boundsMax = {record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]};
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> MeshCache::serialize(const std::vector<MeshShapeView> &shapes) {
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.shapeCount = (uint32_t) shapes.size();
+
+    // Lay out the data blocks behind the shape table
+    std::vector<CacheShape> records(shapes.size());
+    uint64_t offset = sizeof(CacheHeader) + shapes.size() * sizeof(CacheShape);
+    auto place = [&offset](const void *ptr, uint64_t bytes) -> uint64_t {
+      if (!ptr || bytes == 0) return 0;
+      offset = align16(offset);
+      uint64_t result = offset;
+      offset += bytes;
+      return result;
+    };
+
+    for (size_t i = 0; i < shapes.size(); i++) {
+      auto &shape = shapes[i];
+      auto &record = records[i];
+      record = {};
+      record.vertexCount = shape.vertexCount;
+      record.indexCount = shape.indexCount;
+      record.lodCount = shape.lodCount;
+      record.meshletCount = shape.meshletCount;
+      for (int c = 0; c < 3; c++) {
+        record.boundsMin[c] = shape.boundsMin[c];
+        record.boundsMax[c] = shape.boundsMax[c];
+      }
+      record.positions = place(shape.positions, shape.vertexCount * 3 * sizeof(float));
+      record.texcoords = place(shape.texcoords, shape.vertexCount * 2 * sizeof(float));
+      record.normals = place(shape.normals, shape.vertexCount * 3 * sizeof(float));
+      record.indices = place(shape.indices, shape.indexCount * sizeof(unsigned int));
+      record.lods = place(shape.lods, shape.lodCount * sizeof(MeshLod));
+      record.meshlets = place(shape.meshlets, shape.meshletCount * sizeof(Meshlet));
+    }
+
+    // Gaps left by the alignment stay zero
+    std::vector<uint8_t> image(offset, 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), records.data(), records.size() * sizeof(CacheShape));
+    auto emit = [&image](uint64_t at, const void *ptr, uint64_t bytes) {
+      if (at) std::memcpy(image.data() + at, ptr, bytes);
+    };
+    for (size_t i = 0; i < shapes.size(); i++) {
+      auto &shape = shapes[i];
+      auto &record = records[i];
+      emit(record.positions, shape.positions, shape.vertexCount * 3 * sizeof(float));
+      emit(record.texcoords, shape.texcoords, shape.vertexCount * 2 * sizeof(float));
+      emit(record.normals, shape.normals, shape.vertexCount * 3 * sizeof(float));
+      emit(record.indices, shape.indices, shape.indexCount * sizeof(unsigned int));
+      emit(record.lods, shape.lods, shape.lodCount * sizeof(MeshLod));
+      emit(record.meshlets, shape.meshlets, shape.meshletCount * sizeof(Meshlet));
+    }
+    return image;
+  }
+
+  bool MeshCache::write(const std::string &source, const std::vector<MeshShapeView> &shapes) {
+    SourceSignature signature;
+    if (!sourceSignature(source, signature)) return false;
+
+    auto image = serialize(shapes);
+    CacheHeader header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    header.sourceSize = signature.size;
+    header.sourceTime = signature.time;
+    try {
+      header.sourceHash = sourceHash(source);
+    } catch (std::exception &) {
+      return false;
+    }
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    // Write into a temporary file first so an interrupted write never leaves a valid looking cache behind
+    auto path = pathFor(source);
+    auto tmpPath = path + ".tmp";
+    {
+      std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+      if (!out.is_open()) return false;
+      out.write((const char *) image.data(), (std::streamsize) image.size());
+      if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+      fs::remove(tmpPath, ec);
+      return false;
+    }
+    return true;
+  }
+
+  MeshData MeshCache::load(const std::string &source, const std::function<MeshData()> &import) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    if (enabled) {
+      auto cache = open(source);
+      if (cache) {
+        MeshData data;
+        data.storedShapes = cache->getShapes();
+        data.storage = std::move(cache);
+        std::lock_guard<std::mutex> lock{statsMutex};
+        stats.hits++;
+        stats.hitSeconds += elapsed();
+        return data;
+      }
+    }
+
+    MeshData data = import();
+    if (enabled) write(source, data.views());
+
+    std::lock_guard<std::mutex> lock{statsMutex};
+    stats.misses++;
+    stats.missSeconds += elapsed();
+    return data;
+  }
+
+  MeshCache::Stats MeshCache::getStats() {
+    std::lock_guard<std::mutex> lock{statsMutex};
+    return stats;
+  }
+
+  void MeshCache::printStats(std::ostream &out) {
+    auto s = getStats();
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1)
+        << "Mesh cache: " << s.hits << " warm loads in " << s.hitSeconds * 1000.0 << " ms";
+    if (s.hits) out << " (" << s.hitSeconds * 1000.0 / s.hits << " ms/mesh)";
+    out << ", " << s.misses << " cold loads in " << s.missSeconds * 1000.0 << " ms";
+    if (s.misses) out << " (" << s.missSeconds * 1000.0 / s.misses << " ms/mesh)";
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+
+  const std::vector<MeshShapeView> &MeshCache::getShapes() const {
+    return shapes;
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
+
+#include "mapped_file.h"
+#include "mesh_data.h"
+
+namespace ppgso {
+
+  /*!
+   * Versioned binary sidecar cache of imported mesh geometry.
+   *
+   * The first load of "model.obj" writes "model.obj.meshcache" containing positions, texture coordinates, normals,
+   * indices and bounds of every shape. Later loads map the sidecar into memory and hand the arrays to OpenGL without
+   * parsing. The cache is rebuilt when size, modification time or content hash of the source file changes.
+   */
+  class MeshCache {
+  public:
+    /*!
+     * Cache hit/miss counters and time spent loading meshes.
+     */
+    struct Stats {
+      int hits = 0;
+      int misses = 0;
+      double hitSeconds = 0.0;
+      double missSeconds = 0.0;
+    };
+
+    /*!
+     * Global switch, when false meshes are always imported from source.
+     */
+    static bool enabled;
+
+    /*!
+     * Get sidecar cache file path for a source file.
+     *
+     * @param source - Path to the source mesh file.
+     * @return - Path to the cache file.
+     */
+    static std::string pathFor(const std::string &source);
+
+    /*!
+     * Open the cache for a source file.
+     *
+     * @param source - Path to the source mesh file.
+     * @return - Mapped cache or nullptr when missing, stale or corrupted.
+     */
+    static std::shared_ptr<MeshCache> open(const std::string &source);
+
+    /*!
+     * Write geometry of a source file into its sidecar cache.
+     *
+     * @param source - Path to the source mesh file.
+     * @param shapes - Geometry to store.
+     * @return - True when the cache was written.
+     */
+    static bool write(const std::string &source, const std::vector<MeshShapeView> &shapes);
+
+    /*!
+     * Serialize geometry into the cache layout without a source signature, as used for mesh blobs in asset packs.
+     *
+     * @param shapes - Geometry to store.
+     * @return - Cache image, arrays are 16 byte aligned relative to its start.
+     */
+    static std::vector<uint8_t> serialize(const std::vector<MeshShapeView> &shapes);
+
+    /*!
+     * Validate a cache image in memory and point shape views into it. The source signature is not checked.
+     *
+     * @param data - Cache image, at least 4 byte aligned.
+     * @param size - Size of the image in bytes.
+     * @param shapes - Filled with views pointing into data.
+     * @return - False when the image is truncated, corrupted or of another version.
+     */
+    static bool parse(const uint8_t *data, size_t size, std::vector<MeshShapeView> &shapes);
+
+    /*!
+     * Load mesh geometry using the cache when possible, otherwise import it and refresh the cache.
+     *
+     * @param source - Path to the source mesh file.
+     * @param import - Importer to call on cache miss.
+     * @return - Decoded geometry.
+     */
+    static MeshData load(const std::string &source, const std::function<MeshData()> &import);
+
+    /*!
+     * Get accumulated cache statistics.
+     *
+     * @return - Copy of current statistics.
+     */
+    static Stats getStats();
+
+    /*!
+     * Print accumulated cache statistics, comparing cold (imported) and warm (cached) load times.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printStats(std::ostream &out);
+
+    /*!
+     * Get views of the cached shapes, pointing directly into the mapped file.
+     *
+     * @return - Shape views.
+     */
+    const std::vector<MeshShapeView> &getShapes() const;
+
+  private:
+    MeshCache(std::unique_ptr<MappedFile> file, std::vector<MeshShapeView> shapes);
+
+    std::unique_ptr<MappedFile> file;
+    std::vector<MeshShapeView> shapes;
+  };
+}
@@ -0,0 +1,97 @@
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "mesh_data.h"
+#include "hash.h"
+
+void ppgso::MeshShape::computeBounds() {
+  if (positions.size() < 3) {
+    boundsMin = boundsMax = glm::vec3{0.0f};
+    return;
+  }
+  boundsMin = boundsMax = {positions[0], positions[1], positions[2]};
+  for (size_t i = 3; i + 2 < positions.size(); i += 3) {
+    glm::vec3 p{positions[i], positions[i + 1], positions[i + 2]};
+    boundsMin = glm::min(boundsMin, p);
+    boundsMax = glm::max(boundsMax, p);
+  }
+}
+
+ppgso::MeshShapeView ppgso::MeshShape::view() const {
+  MeshShapeView v;
+  v.vertexCount = (uint32_t) (positions.size() / 3);
+  v.indexCount = (uint32_t) indices.size();
+  v.positions = positions.empty() ? nullptr : positions.data();
+  v.texcoords = texcoords.size() == v.vertexCount * 2 && v.vertexCount ? texcoords.data() : nullptr;
+  v.normals = normals.size() == v.vertexCount * 3 && v.vertexCount ? normals.data() : nullptr;
+  v.indices = indices.empty() ? nullptr : indices.data();
+  v.lods = lods.empty() ? nullptr : lods.data();
+  v.lodCount = (uint32_t) lods.size();
+  v.meshlets = meshlets.empty() ? nullptr : meshlets.data();
+  v.meshletCount = (uint32_t) meshlets.size();
+  v.boundsMin = boundsMin;
+  v.boundsMax = boundsMax;
+  return v;
+}
+
+std::vector<ppgso::MeshShapeView> ppgso::MeshData::views() const {
+  if (storage) return storedShapes;
+
+  std::vector<MeshShapeView> result;
+  result.reserve(shapes.size());
+  for (auto &shape : shapes) result.push_back(shape.view());
+  return result;
+}
+
+size_t ppgso::MeshData::byteSize() const {
+  size_t bytes = 0;
+  for (auto &shape : views()) {
+    size_t floats = 3 + (shape.texcoords ? 2 : 0) + (shape.normals ? 3 : 0);
+    bytes += shape.vertexCount * floats * sizeof(float) + shape.indexCount * sizeof(unsigned int);
+  }
+  return bytes;
+}
+
+void ppgso::MeshData::bounds(glm::vec3 &min, glm::vec3 &max) const {
+  auto shapes = views();
+  min = max = glm::vec3{0.0f};
+  for (size_t i = 0; i < shapes.size(); i++) {
+    min = i ? glm::min(min, shapes[i].boundsMin) : shapes[i].boundsMin;
+    max = i ? glm::max(max, shapes[i].boundsMax) : shapes[i].boundsMax;
+  }
+}
+
+float ppgso::MeshData::uvDensity() const {
+  double surface = 0.0, uv = 0.0;
+  for (auto &shape : views()) {
+    if (!shape.texcoords) continue;
+    // Simplified levels follow the full detail triangles
+    uint32_t count = shape.lodCount ? shape.lods[0].indexCount : shape.indexCount;
+    for (uint32_t i = 0; i + 2 < count; i += 3) {
+      auto a = shape.indices[i], b = shape.indices[i + 1], c = shape.indices[i + 2];
+      auto position = [&shape](uint32_t v) { return glm::make_vec3(shape.positions + v * 3); };
+      auto texcoord = [&shape](uint32_t v) { return glm::make_vec2(shape.texcoords + v * 2); };
+      surface += glm::length(glm::cross(position(b) - position(a), position(c) - position(a)));
+      glm::vec2 du = texcoord(b) - texcoord(a), dv = texcoord(c) - texcoord(a);
+      uv += std::abs(du.x * dv.y - du.y * dv.x);
+    }
+  }
+  return surface > 0.0 ? (float) std::sqrt(uv / surface) : 0.0f;
+}
+
+uint64_t ppgso::MeshData::contentHash() const {
+  // Chain the arrays of all shapes, counts go in too so attributes cannot shift between arrays
+  uint64_t h = hash64(nullptr, 0);
+  for (auto &shape : views()) {
+    uint32_t layout[] = {shape.vertexCount, shape.indexCount, shape.texcoords != nullptr, shape.normals != nullptr};
+    h = hash64(layout, sizeof(layout), h);
+    h = hash64(shape.positions, shape.vertexCount * 3 * sizeof(float), h);
+    if (shape.texcoords) h = hash64(shape.texcoords, shape.vertexCount * 2 * sizeof(float), h);
+    if (shape.normals) h = hash64(shape.normals, shape.vertexCount * 3 * sizeof(float), h);
+    h = hash64(shape.indices, shape.indexCount * sizeof(unsigned int), h);
+    h = hash64(shape.lods, shape.lodCount * sizeof(MeshLod), h);
+    h = hash64(shape.meshlets, shape.meshletCount * sizeof(Meshlet), h);
+  }
+  return h;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace ppgso {
+
+  /*!
+   * Level of detail of a shape, a range of the shape indices drawing a simplified version of the same vertices.
+   */
+  struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;                   // Geometric deviation from the full detail shape in mesh units
+  };
+
+  /*!
+   * Cluster of neighbouring full detail triangles with bounds for culling, a contiguous range of the shape indices.
+   */
+  struct Meshlet {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    glm::vec3 center{0.0f};               // Bounding sphere of the triangles
+    float radius = 0.0f;
+    glm::vec3 coneAxis{0.0f};             // Average facing of the triangles
+    float coneCutoff = 1.0f;              // Sine of the normal cone spread, 1 when the meshlet never faces away
+  };
+
+  /*!
+   * Non-owning view of a single shape, ready to be passed to glBufferData.
+   * Texture coordinates and normals are optional and set to nullptr when missing.
+   */
+  struct MeshShapeView {
+    const float *positions = nullptr;     // 3 floats per vertex
+    const float *texcoords = nullptr;     // 2 floats per vertex
+    const float *normals = nullptr;       // 3 floats per vertex
+    const unsigned int *indices = nullptr;
+    const MeshLod *lods = nullptr;        // Levels from full detail to coarsest, nullptr when not simplified
+    const Meshlet *meshlets = nullptr;    // Partition of the full detail level, nullptr when not clustered
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;              // Indices of all levels
+    uint32_t lodCount = 0;
+    uint32_t meshletCount = 0;
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+  };
+
+  /*!
+   * CPU side geometry of a single shape as produced by an importer.
+   */
+  struct MeshShape {
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    std::vector<float> normals;
+    std::vector<unsigned int> indices;    // Full detail triangles followed by the simplified levels
+    std::vector<MeshLod> lods;            // Empty when the shape has just the full detail level
+    std::vector<Meshlet> meshlets;        // Ranges covering the full detail triangles, see buildMeshlets
+    glm::vec3 boundsMin{0.0f};
+    glm::vec3 boundsMax{0.0f};
+
+    /*!
+     * Recompute axis aligned bounds from positions.
+     */
+    void computeBounds();
+
+    /*!
+     * Get view of the shape. Attributes which do not cover every vertex are left out.
+     *
+     * @return - View pointing into the shape vectors.
+     */
+    MeshShapeView view() const;
+  };
+
+  /*!
+   * Decoded mesh geometry, either owned by the importer or stored in a buffer such as the mapped mesh cache or an
+   * asset pack. Stored views take precedence over the shapes.
+   */
+  struct MeshData {
+    std::vector<MeshShape> shapes;
+    std::shared_ptr<const void> storage;          // Keeps the memory behind storedShapes alive
+    std::vector<MeshShapeView> storedShapes;
+
+    /*!
+     * Get views of all shapes regardless of where the geometry is stored.
+     *
+     * @return - Shape views, valid as long as this object is alive.
+     */
+    std::vector<MeshShapeView> views() const;
+
+    /*!
+     * Get size of the vertex and index arrays as uploaded to the GPU.
+     *
+     * @return - Size in bytes.
+     */
+    size_t byteSize() const;
+
+    /*!
+     * Get axis aligned bounds enclosing all shapes.
+     *
+     * @param min - Minimum corner, set to zero for empty meshes.
+     * @param max - Maximum corner, set to zero for empty meshes.
+     */
+    void bounds(glm::vec3 &min, glm::vec3 &max) const;
+
+    /*!
+     * Get how much texture space a unit of surface covers, the square root of the texture coordinate area over the
+     * surface area of all full detail triangles. A texture N texels wide has N times this many texels per unit.
+     *
+     * @return - Texture coordinate units per mesh unit, 0 when the mesh has no texture coordinates.
+     */
+    float uvDensity() const;
+
+    /*!
+     * Get hash of the geometry, equal for meshes with identical vertex and index arrays regardless of source file.
+     *
+     * @return - 64bit content hash.
+     */
+    uint64_t contentHash() const;
+  };
+}
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+#include "mesh_optimize.h"
+#include "hash.h"
+
+namespace ppgso {
+
+  // FIFO cache simulation with timestamps, an entry is cached when it was inserted less than cacheSize misses ago
+  class FifoCache {
+  public:
+    FifoCache(size_t vertexCount, unsigned int cacheSize) : size{cacheSize}, time(vertexCount, 0) {}
+
+    bool access(unsigned int vertex) {
+      if (time[vertex] && clock - time[vertex] < size) return true;
+      time[vertex] = ++clock;
+      return false;
+    }
+
+    void reset() {
+      clock += size;
+    }
+
+  private:
+    unsigned int size;
+    unsigned int clock = 0;
+    std::vector<unsigned int> time;
+  };
+
+  size_t positionRemap(const std::vector<float> &positions, std::vector<unsigned int> &remap) {
+    size_t vertexCount = positions.size() / 3;
+    const unsigned int empty = ~0u;
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2) capacity *= 2;
+    std::vector<unsigned int> table(capacity, empty);
+    remap.resize(vertexCount);
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+      const float *key = &positions[v * 3];
+      size_t slot = hash64(key, 3 * sizeof(float)) & (capacity - 1);
+      while (table[slot] != empty && std::memcmp(&positions[table[slot] * 3], key, 3 * sizeof(float)) != 0)
+        slot = (slot + 1) & (capacity - 1);
+      if (table[slot] == empty) {
+        table[slot] = (unsigned int) v;
+        remap[v] = (unsigned int) unique++;
+      } else {
+        remap[v] = remap[table[slot]];
+      }
+    }
+    return unique;
+  }
+
+  void weldVertices(MeshShape &shape) {
+    size_t vertexCount = shape.positions.size() / 3;
+    bool hasTexcoords = shape.texcoords.size() == vertexCount * 2;
+    bool hasNormals = shape.normals.size() == vertexCount * 3;
+    if (vertexCount == 0) return;
+
+    // Partial attributes are ignored on upload, drop them so they cannot line up with fewer vertices later
+    if (!hasTexcoords) shape.texcoords.clear();
+    if (!hasNormals) shape.normals.clear();
+
+    // Gather attributes of each vertex so they can be hashed and compared as one block
+    size_t stride = 3 + (hasTexcoords ? 2 : 0) + (hasNormals ? 3 : 0);
+    std::vector<float> attributes(vertexCount * stride);
+    for (size_t v = 0; v < vertexCount; v++) {
+      float *out = &attributes[v * stride];
+      out = std::copy_n(&shape.positions[v * 3], 3, out);
+      if (hasTexcoords) out = std::copy_n(&shape.texcoords[v * 2], 2, out);
+      if (hasNormals) std::copy_n(&shape.normals[v * 3], 3, out);
+    }
+
+    // Open addressing table of the first vertex with given attributes
+    const unsigned int empty = ~0u;
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2) capacity *= 2;
+    std::vector<unsigned int> table(capacity, empty);
+    std::vector<unsigned int> remap(vertexCount);
+    size_t unique = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+      const float *key = &attributes[v * stride];
+      size_t slot = hash64(key, stride * sizeof(float)) & (capacity - 1);
+      while (table[slot] != empty && std::memcmp(&attributes[table[slot] * stride], key, stride * sizeof(float)) != 0)
+        slot = (slot + 1) & (capacity - 1);
+      if (table[slot] == empty) {
+        table[slot] = (unsigned int) v;
+        remap[v] = (unsigned int) unique++;
+      } else {
+        remap[v] = remap[table[slot]];
+      }
+    }
+    if (unique == vertexCount) return;
+
+    // Keep the first occurrence of every vertex, ids were handed out in that order
+    unsigned int next = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+      auto to = remap[v];
+      if (to != next) continue;
+      next++;
+      std::copy_n(&shape.positions[v * 3], 3, &shape.positions[to * 3]);
+      if (hasTexcoords) std::copy_n(&shape.texcoords[v * 2], 2, &shape.texcoords[to * 2]);
+      if (hasNormals) std::copy_n(&shape.normals[v * 3], 3, &shape.normals[to * 3]);
+    }
+    shape.positions.resize(unique * 3);
+    if (hasTexcoords) shape.texcoords.resize(unique * 2);
+    if (hasNormals) shape.normals.resize(unique * 3);
+    for (auto &index : shape.indices) index = remap[index];
+  }
+
+  VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                      unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) return stats;
+
+    FifoCache cache{vertexCount, cacheSize};
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, unique = 0;
+    for (auto index : indices) {
+      if (!cache.access(index)) misses++;
+      if (!used[index]) {
+        used[index] = true;
+        unique++;
+      }
+    }
+    stats.acmr = (float) misses / (float) (indices.size() / 3);
+    stats.atvr = (float) misses / (float) unique;
+    return stats;
+  }
+
+  void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, std::vector<size_t> *clusters,
+                           unsigned int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (clusters) clusters->clear();
+    if (triangleCount == 0) return;
+
+    // Vertex to triangle adjacency
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (auto index : indices) live[index]++;
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (unsigned int) (i / 3);
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd, candidates;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    unsigned int timestamp = cacheSize + 1;
+    size_t cursor = 0;
+    long fanning = 0;
+    bool cold = true;
+    while (fanning >= 0) {
+      // Emit all remaining triangles around the fanning vertex
+      if (cold && clusters) clusters->push_back(result.size() / 3);
+      candidates.clear();
+      for (size_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+        auto triangle = adjacency[a];
+        if (emitted[triangle]) continue;
+        emitted[triangle] = true;
+        for (int k = 0; k < 3; k++) {
+          auto v = indices[triangle * 3 + k];
+          result.push_back(v);
+          deadEnd.push_back(v);
+          candidates.push_back(v);
+          live[v]--;
+          if (timestamp - cacheTime[v] > cacheSize) cacheTime[v] = timestamp++;
+        }
+      }
+
+      // Prefer the candidate which stays in cache longest while all its triangles are emitted
+      long best = -1;
+      unsigned int bestPriority = 0;
+      for (auto v : candidates) {
+        if (!live[v]) continue;
+        unsigned int priority = 0;
+        if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize) priority = timestamp - cacheTime[v];
+        if (best < 0 || priority > bestPriority) {
+          best = v;
+          bestPriority = priority;
+        }
+      }
+      cold = false;
+      if (best >= 0) {
+        fanning = best;
+        continue;
+      }
+
+      // Dead end, continue with a recently used vertex or the next unprocessed one
+      fanning = -1;
+      while (!deadEnd.empty()) {
+        auto v = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[v]) {
+          fanning = v;
+          cold = timestamp - cacheTime[v] > cacheSize;
+          break;
+        }
+      }
+      if (fanning < 0) {
+        while (cursor < vertexCount && !live[cursor]) cursor++;
+        if (cursor < vertexCount) {
+          fanning = (long) cursor;
+          cold = true;
+        }
+      }
+    }
+
+    indices.swap(result);
+  }
+
+  void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions,
+                        const std::vector<size_t> &clusters, float threshold, unsigned int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = positions.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) return;
+
+    // Split hard clusters wherever the part so far is not worse than the whole cluster
+    FifoCache cache{vertexCount, cacheSize};
+    std::vector<size_t> boundaries;
+    for (size_t c = 0; c < clusters.size(); c++) {
+      size_t start = clusters[c];
+      size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+      cache.reset();
+      size_t misses = 0;
+      for (size_t t = start; t < end; t++)
+        for (int k = 0; k < 3; k++) misses += !cache.access(indices[t * 3 + k]);
+      float clusterAcmr = (float) misses / (float) (end - start);
+
+      cache.reset();
+      misses = 0;
+      size_t partStart = start;
+      boundaries.push_back(start);
+      for (size_t t = start; t < end; t++) {
+        for (int k = 0; k < 3; k++) misses += !cache.access(indices[t * 3 + k]);
+        if (t + 1 < end && (float) misses / (float) (t + 1 - partStart) <= clusterAcmr * threshold) {
+          boundaries.push_back(t + 1);
+          partStart = t + 1;
+          misses = 0;
+          cache.reset();
+        }
+      }
+    }
+
+    auto position = [&positions](unsigned int v) {
+      return glm::vec3{positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]};
+    };
+
+    // Area weighted centroid and normal of every cluster
+    std::vector<glm::vec3> centroids(boundaries.size(), glm::vec3{0.0f});
+    std::vector<glm::vec3> normals(boundaries.size(), glm::vec3{0.0f});
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < boundaries.size(); c++) {
+      size_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : triangleCount;
+      float area = 0.0f;
+      for (size_t t = boundaries[c]; t < end; t++) {
+        auto a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), d = position(indices[t * 3 + 2]);
+        auto normal = glm::cross(b - a, d - a);
+        float triangleArea = glm::length(normal);
+        centroids[c] += (a + b + d) * (triangleArea / 3.0f);
+        normals[c] += normal;
+        area += triangleArea;
+      }
+      meshCentroid += centroids[c];
+      meshArea += area;
+      centroids[c] = area > 0.0f ? centroids[c] / area : position(indices[boundaries[c] * 3]);
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Draw clusters facing away from the mesh center first
+    std::vector<float> keys(boundaries.size());
+    for (size_t c = 0; c < boundaries.size(); c++) {
+      float length = glm::length(normals[c]);
+      keys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+    }
+    std::vector<size_t> order(boundaries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (auto c : order) {
+      size_t end = c + 1 < boundaries.size() ? boundaries[c + 1] : triangleCount;
+      result.insert(result.end(), indices.begin() + boundaries[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(result);
+  }
+
+  void optimizeVertexFetch(MeshShape &shape) {
+    size_t vertexCount = shape.positions.size() / 3;
+    bool hasTexcoords = shape.texcoords.size() == vertexCount * 2;
+    bool hasNormals = shape.normals.size() == vertexCount * 3;
+
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertexCount, unused);
+    unsigned int next = 0;
+    for (auto &index : shape.indices) {
+      if (remap[index] == unused) remap[index] = next++;
+      index = remap[index];
+    }
+
+    std::vector<float> positions(next * 3), texcoords(hasTexcoords ? next * 2 : 0), normals(hasNormals ? next * 3 : 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+      auto to = remap[v];
+      if (to == unused) continue;
+      std::copy_n(&shape.positions[v * 3], 3, &positions[to * 3]);
+      if (hasTexcoords) std::copy_n(&shape.texcoords[v * 2], 2, &texcoords[to * 2]);
+      if (hasNormals) std::copy_n(&shape.normals[v * 3], 3, &normals[to * 3]);
+    }
+    shape.positions.swap(positions);
+    shape.texcoords.swap(texcoords);
+    shape.normals.swap(normals);
+  }
+
+  void optimizeShape(MeshShape &shape) {
+    weldVertices(shape);
+
+    std::vector<size_t> clusters;
+    optimizeVertexCache(shape.indices, shape.positions.size() / 3, &clusters);
+    optimizeOverdraw(shape.indices, shape.positions, clusters);
+    optimizeVertexFetch(shape);
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include "mesh_data.h"
+
+namespace ppgso {
+
+  /*!
+   * Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache.
+   */
+  struct VertexCacheStats {
+    float acmr = 0.0f;  // Average cache miss ratio, transformed vertices per triangle (0.5 - 3)
+    float atvr = 0.0f;  // Average transformed vertex ratio, transformed vertices per referenced vertex (1 is optimal)
+  };
+
+  /*!
+   * Simulate a FIFO post-transform vertex cache over a triangle list.
+   *
+   * @param indices - Triangle list indices.
+   * @param vertexCount - Number of vertices referenced by the indices.
+   * @param cacheSize - Number of cache entries.
+   * @return - Cache statistics.
+   */
+  VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                      unsigned int cacheSize = 16);
+
+  /*!
+   * Map vertices with bit identical positions to a shared index, ignoring their other attributes.
+   *
+   * @param positions - Vertex positions, 3 floats per vertex.
+   * @param remap - Output, position index of every vertex, numbered in order of first occurrence.
+   * @return - Number of distinct positions.
+   */
+  size_t positionRemap(const std::vector<float> &positions, std::vector<unsigned int> &remap);
+
+  /*!
+   * Merge vertices with bit identical position, texture coordinate and normal.
+   * Exporters often write every face corner as a separate vertex, which defeats the vertex cache.
+   *
+   * @param shape - Shape to weld in place, indices are remapped and the vertex arrays compacted.
+   */
+  void weldVertices(MeshShape &shape);
+
+  /*!
+   * Reorder triangles for the post-transform vertex cache using Tipsify (Sander et al. 2007).
+   *
+   * @param indices - Triangle list indices, reordered in place.
+   * @param vertexCount - Number of vertices referenced by the indices.
+   * @param clusters - Optional output, first triangle of every cluster which starts with a cold cache.
+   * @param cacheSize - Number of cache entries to optimize for.
+   */
+  void optimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount,
+                           std::vector<size_t> *clusters = nullptr, unsigned int cacheSize = 16);
+
+  /*!
+   * Reorder clusters of triangles so that outward facing ones are drawn first and occlude the rest.
+   * Clusters are split further as long as the cache miss ratio of a part stays within the threshold.
+   *
+   * @param indices - Triangle list indices optimized by optimizeVertexCache, reordered in place.
+   * @param positions - Vertex positions, 3 floats per vertex.
+   * @param clusters - Clusters reported by optimizeVertexCache.
+   * @param threshold - Allowed cache miss ratio increase, 1.05 allows 5% worse ACMR.
+   * @param cacheSize - Number of cache entries used by optimizeVertexCache.
+   */
+  void optimizeOverdraw(std::vector<unsigned int> &indices, const std::vector<float> &positions,
+                        const std::vector<size_t> &clusters, float threshold = 1.05f, unsigned int cacheSize = 16);
+
+  /*!
+   * Renumber vertices in the order they are first referenced, so vertex fetches walk the buffers linearly.
+   * Unreferenced vertices are removed.
+   *
+   * @param shape - Shape to reorder in place.
+   */
+  void optimizeVertexFetch(MeshShape &shape);
+
+  /*!
+   * Run the welding, vertex cache, overdraw and vertex fetch optimizations on a shape.
+   *
+   * @param shape - Shape to optimize in place.
+   */
+  void optimizeShape(MeshShape &shape);
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "mesh_simplify.h"
+#include "mesh_optimize.h"
+
+namespace ppgso {
+
+  // Symmetric 4x4 error quadric, sum of squared distances to planes weighted by triangle area
+  struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0, w = 0;
+
+    void addPlane(const glm::dvec3 &n, double d, double weight) {
+      a2 += weight * n.x * n.x;
+      ab += weight * n.x * n.y;
+      ac += weight * n.x * n.z;
+      ad += weight * n.x * d;
+      b2 += weight * n.y * n.y;
+      bc += weight * n.y * n.z;
+      bd += weight * n.y * d;
+      c2 += weight * n.z * n.z;
+      cd += weight * n.z * d;
+      d2 += weight * d * d;
+      w += weight;
+    }
+
+    void add(const Quadric &q) {
+      a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+      bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2; w += q.w;
+    }
+
+    double evaluate(const glm::dvec3 &p) const {
+      double error = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                     + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                     + c2 * p.z * p.z + 2 * cd * p.z + d2;
+      return std::max(error, 0.0);
+    }
+  };
+
+  // Candidate move of a position onto a neighbouring one, stale once either side changed
+  struct Collapse {
+    double cost;
+    uint32_t from, to;
+    uint32_t fromVersion, toVersion;
+
+    bool operator>(const Collapse &other) const {
+      return cost > other.cost;
+    }
+  };
+
+  // Border edges are kept in place by a plane through the edge perpendicular to the triangle
+  static const double BORDER_WEIGHT = 10.0;
+
+  class Simplifier {
+  public:
+    Simplifier(const MeshShape &shape, size_t indexCount) : shape{shape} {
+      size_t vertexCount = shape.positions.size() / 3;
+      hasTexcoords = shape.texcoords.size() == vertexCount * 2;
+      hasNormals = shape.normals.size() == vertexCount * 3;
+      weldPositions(vertexCount);
+
+      // Triangles over positions, invisible ones with two corners at the same position are dropped
+      for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        uint32_t a = position[shape.indices[i]], b = position[shape.indices[i + 1]], c = position[shape.indices[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        for (int k = 0; k < 3; k++) {
+          corners.push_back(shape.indices[i + k]);
+          triangles.push_back(position[shape.indices[i + k]]);
+        }
+      }
+      size_t triangleCount = triangles.size() / 3;
+      alive.assign(triangleCount, true);
+      live = triangleCount;
+
+      adjacency.resize(points.size());
+      quadrics.resize(points.size());
+      collapsed.assign(points.size(), false);
+      version.assign(points.size(), 0);
+      for (uint32_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++) adjacency[triangles[t * 3 + k]].push_back(t);
+
+      buildQuadrics();
+      for (uint32_t p = 0; p < points.size(); p++) pushCollapses(p);
+    }
+
+    size_t triangleCount() const {
+      return live;
+    }
+
+    /*!
+     * Collapse edges until the triangle count drops to the target or no collapse within the error is left.
+     */
+    void run(size_t target, double maxError) {
+      while (live > target && !heap.empty()) {
+        auto collapse = heap.top();
+        heap.pop();
+        if (collapsed[collapse.from] || collapsed[collapse.to]) continue;
+        if (version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion) continue;
+
+        Quadric q = quadrics[collapse.from];
+        q.add(quadrics[collapse.to]);
+        double deviation = q.w > 0 ? std::sqrt(collapse.cost / q.w) : 0.0;
+        if (deviation > maxError || flips(collapse.from, collapse.to)) continue;
+
+        apply(collapse.from, collapse.to);
+        error = std::max(error, deviation);
+      }
+    }
+
+    std::vector<unsigned int> indices() const {
+      std::vector<unsigned int> result;
+      result.reserve(live * 3);
+      for (size_t t = 0; t < alive.size(); t++)
+        if (alive[t]) result.insert(result.end(), corners.begin() + t * 3, corners.begin() + t * 3 + 3);
+      return result;
+    }
+
+    double error = 0.0;
+
+  private:
+    void weldPositions(size_t vertexCount) {
+      std::vector<unsigned int> remap;
+      points.resize(positionRemap(shape.positions, remap));
+      position.assign(remap.begin(), remap.end());
+      for (size_t v = 0; v < vertexCount; v++)
+        points[position[v]] = {shape.positions[v * 3], shape.positions[v * 3 + 1], shape.positions[v * 3 + 2]};
+
+      // Vertices sharing a position, used to pick corner attributes after a collapse
+      wedgeStart.assign(points.size() + 1, 0);
+      for (auto p : position) wedgeStart[p + 1]++;
+      for (size_t p = 0; p < points.size(); p++) wedgeStart[p + 1] += wedgeStart[p];
+      wedges.resize(vertexCount);
+      std::vector<uint32_t> fill(wedgeStart.begin(), wedgeStart.end() - 1);
+      for (size_t v = 0; v < vertexCount; v++) wedges[fill[position[v]]++] = (uint32_t) v;
+    }
+
+    void buildQuadrics() {
+      std::unordered_map<uint64_t, uint32_t> edgeUse;
+      auto edgeKey = [](uint32_t a, uint32_t b) {
+        return a < b ? (uint64_t) a << 32 | b : (uint64_t) b << 32 | a;
+      };
+
+      for (size_t t = 0; t < alive.size(); t++) {
+        auto p0 = points[triangles[t * 3]], p1 = points[triangles[t * 3 + 1]], p2 = points[triangles[t * 3 + 2]];
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        double area = glm::length(normal);
+        if (area <= 0.0) continue;
+        normal /= area;
+        for (int k = 0; k < 3; k++) {
+          quadrics[triangles[t * 3 + k]].addPlane(normal, -glm::dot(normal, p0), area * 0.5);
+          edgeUse[edgeKey(triangles[t * 3 + k], triangles[t * 3 + (k + 1) % 3])]++;
+        }
+      }
+
+      for (size_t t = 0; t < alive.size(); t++) {
+        auto p0 = points[triangles[t * 3]], p1 = points[triangles[t * 3 + 1]], p2 = points[triangles[t * 3 + 2]];
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        for (int k = 0; k < 3; k++) {
+          uint32_t a = triangles[t * 3 + k], b = triangles[t * 3 + (k + 1) % 3];
+          if (edgeUse[edgeKey(a, b)] != 1) continue;
+          auto edge = points[b] - points[a];
+          auto side = glm::cross(edge, normal);
+          double length = glm::length(side);
+          if (length <= 0.0) continue;
+          side /= length;
+          double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+          quadrics[a].addPlane(side, -glm::dot(side, points[a]), weight);
+          quadrics[b].addPlane(side, -glm::dot(side, points[a]), weight);
+        }
+      }
+    }
+
+    void pushCollapses(uint32_t p) {
+      for (auto t : adjacency[p]) {
+        if (!alive[t]) continue;
+        for (int k = 0; k < 3; k++) {
+          uint32_t q = triangles[t * 3 + k];
+          if (q == p) continue;
+          push(p, q);
+          push(q, p);
+        }
+      }
+    }
+
+    void push(uint32_t from, uint32_t to) {
+      Quadric q = quadrics[from];
+      q.add(quadrics[to]);
+      heap.push({q.evaluate(points[to]), from, to, version[from], version[to]});
+    }
+
+    // Moving a position must not turn any remaining triangle around
+    bool flips(uint32_t from, uint32_t to) const {
+      for (auto t : adjacency[from]) {
+        if (!alive[t]) continue;
+        const uint32_t *tri = &triangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+        glm::dvec3 before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+          before[k] = points[tri[k]];
+          after[k] = tri[k] == from ? points[to] : points[tri[k]];
+        }
+        auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+        auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(n0, n1) <= 0.0) return true;
+      }
+      return false;
+    }
+
+    // Seam vertex of a position with attributes closest to a corner vertex
+    uint32_t wedgeFor(uint32_t point, uint32_t corner) const {
+      uint32_t best = wedges[wedgeStart[point]];
+      float bestDistance = -1.0f;
+      for (uint32_t i = wedgeStart[point]; i < wedgeStart[point + 1]; i++) {
+        uint32_t v = wedges[i];
+        float distance = 0.0f;
+        if (hasNormals)
+          for (int c = 0; c < 3; c++) {
+            float d = shape.normals[v * 3 + c] - shape.normals[corner * 3 + c];
+            distance += d * d;
+          }
+        if (hasTexcoords)
+          for (int c = 0; c < 2; c++) {
+            float d = shape.texcoords[v * 2 + c] - shape.texcoords[corner * 2 + c];
+            distance += d * d;
+          }
+        if (bestDistance < 0.0f || distance < bestDistance) {
+          best = v;
+          bestDistance = distance;
+        }
+      }
+      return best;
+    }
+
+    void apply(uint32_t from, uint32_t to) {
+      for (auto t : adjacency[from]) {
+        if (!alive[t]) continue;
+        uint32_t *tri = &triangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+          alive[t] = false;
+          live--;
+          continue;
+        }
+        for (int k = 0; k < 3; k++) {
+          if (tri[k] != from) continue;
+          tri[k] = to;
+          corners[t * 3 + k] = wedgeFor(to, corners[t * 3 + k]);
+        }
+        adjacency[to].push_back(t);
+      }
+      adjacency[from].clear();
+      collapsed[from] = true;
+      quadrics[to].add(quadrics[from]);
+      version[to]++;
+
+      auto &around = adjacency[to];
+      around.erase(std::remove_if(around.begin(), around.end(), [this](uint32_t t) { return !alive[t]; }), around.end());
+      pushCollapses(to);
+    }
+
+    const MeshShape &shape;
+    bool hasTexcoords, hasNormals;
+    std::vector<uint32_t> position;
+    std::vector<glm::dvec3> points;
+    std::vector<uint32_t> wedgeStart, wedges;
+    std::vector<uint32_t> triangles, corners;
+    std::vector<bool> alive;
+    size_t live = 0;
+    std::vector<std::vector<uint32_t>> adjacency;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> collapsed;
+    std::vector<uint32_t> version;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+  };
+
+  void simplifyShape(const MeshShape &shape, size_t indexCount, const std::vector<size_t> &targets, float maxError,
+                     std::vector<std::vector<unsigned int>> &levels, std::vector<float> &errors) {
+    levels.clear();
+    errors.clear();
+    if (targets.empty() || indexCount < 3) return;
+
+    Simplifier simplifier{shape, indexCount};
+    size_t previous = indexCount / 3;
+    for (auto target : targets) {
+      simplifier.run(target, maxError);
+
+      // Keep a level only when it saves a meaningful amount of triangles
+      size_t count = simplifier.triangleCount();
+      if (count == 0 || count > previous * 4 / 5) break;
+      levels.push_back(simplifier.indices());
+      errors.push_back((float) simplifier.error);
+      previous = count;
+      if (count > target) break;
+    }
+  }
+
+  void generateLods(MeshShape &shape, const LodSettings &settings) {
+    shape.lods.clear();
+    size_t triangles = shape.indices.size() / 3;
+    if (settings.levels < 2 || triangles < settings.minTriangles) return;
+
+    std::vector<size_t> targets;
+    double target = (double) triangles;
+    for (unsigned int i = 1; i < settings.levels; i++) {
+      target *= settings.ratio;
+      targets.push_back((size_t) target);
+    }
+
+    float radius = glm::length(shape.boundsMax - shape.boundsMin) * 0.5f;
+    std::vector<std::vector<unsigned int>> levels;
+    std::vector<float> errors;
+    simplifyShape(shape, shape.indices.size(), targets, settings.maxError * radius, levels, errors);
+    if (levels.empty()) return;
+
+    size_t vertexCount = shape.positions.size() / 3;
+    shape.lods.push_back({0, (uint32_t) shape.indices.size(), 0.0f});
+    for (size_t i = 0; i < levels.size(); i++) {
+      optimizeVertexCache(levels[i], vertexCount);
+      shape.lods.push_back({(uint32_t) shape.indices.size(), (uint32_t) levels[i].size(), errors[i]});
+      shape.indices.insert(shape.indices.end(), levels[i].begin(), levels[i].end());
+    }
+  }
+
+  int selectLod(const std::vector<float> &errors, float pixelsPerUnit, float threshold, int current,
+                float hysteresis) {
+    if (errors.empty()) return 0;
+    int count = (int) errors.size();
+    int lod = std::min(std::max(current, 0), count - 1);
+    while (lod > 0 && errors[lod] * pixelsPerUnit > threshold) lod--;
+    while (lod + 1 < count && errors[lod + 1] * pixelsPerUnit < threshold * (1.0f - hysteresis)) lod++;
+    return lod;
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+#include "mesh_data.h"
+
+namespace ppgso {
+
+  /*!
+   * Parameters of the LOD chain built by generateLods.
+   */
+  struct LodSettings {
+    unsigned int levels = 4;              // Including the full detail level
+    float ratio = 0.5f;                   // Triangle count of each level relative to the previous one
+    unsigned int minTriangles = 256;      // Shapes with fewer triangles keep only the full detail level
+    float maxError = 0.1f;                // Stop simplifying once the deviation exceeds this fraction of the radius
+  };
+
+  /*!
+   * Simplify a triangle list with quadric error edge collapses (Garland and Heckbert 1997).
+   *
+   * Collapses move a vertex onto one of its neighbours, so the simplified triangles reference the original vertices
+   * and every level can share one vertex buffer. Vertices sharing a position (normal or texture seams) collapse
+   * together, each face corner keeps the seam vertex of the target position with the closest attributes.
+   *
+   * @param shape - Shape providing vertices and the full detail triangles in its first indexCount indices.
+   * @param indexCount - Number of full detail indices.
+   * @param targets - Triangle counts to stop at, in decreasing order.
+   * @param maxError - Largest allowed deviation in mesh units.
+   * @param levels - Output, one triangle list per reached target.
+   * @param errors - Output, deviation of every level in mesh units.
+   */
+  void simplifyShape(const MeshShape &shape, size_t indexCount, const std::vector<size_t> &targets, float maxError,
+                     std::vector<std::vector<unsigned int>> &levels, std::vector<float> &errors);
+
+  /*!
+   * Append simplified levels of detail to the indices of a shape and fill its LOD table.
+   *
+   * @param shape - Shape to extend, its indices are the full detail level.
+   * @param settings - Number of levels and their reduction.
+   */
+  void generateLods(MeshShape &shape, const LodSettings &settings = {});
+
+  /*!
+   * Pick a level of detail so that its error projects below a pixel threshold.
+   * A coarser level is only taken once its error is a hysteresis fraction below the threshold, so objects
+   * near the switching distance do not pop back and forth.
+   *
+   * @param errors - Error of every level in mesh units, increasing.
+   * @param pixelsPerUnit - Projected size of one mesh unit in pixels at the mesh distance.
+   * @param threshold - Largest allowed projected error in pixels.
+   * @param current - Level used in the previous frame.
+   * @param hysteresis - Fraction of the threshold to keep between switching up and down.
+   * @return - Level to render.
+   */
+  int selectLod(const std::vector<float> &errors, float pixelsPerUnit, float threshold, int current,
+                float hysteresis = 0.25f);
+}
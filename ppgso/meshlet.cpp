@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "meshlet.h"
+#include "mesh_optimize.h"
+
+namespace ppgso {
+
+  // Unconnected triangles considered when a meshlet runs out of neighbours before reaching the minimum size
+  static const size_t FALLBACK_WINDOW = 256;
+
+  // Weight of the normal deviation against distance when growing, higher gives narrower normal cones
+  static const float NORMAL_WEIGHT = 4.0f;
+
+  // Once a meshlet has the minimum size it stops before taking a triangle further than ~25 degrees off its axis
+  static const float STOP_DOT = 0.9f;
+
+  // Meshlets whose triangles spread further than this from the average normal are never back-facing in practice
+  static const float MIN_CONE_DOT = 0.1f;
+
+  void buildMeshlets(MeshShape &shape, unsigned int minTriangles, unsigned int maxTriangles) {
+    shape.meshlets.clear();
+    size_t indexCount = shape.lods.empty() ? shape.indices.size() : shape.lods[0].indexCount;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+    maxTriangles = std::max(maxTriangles, 1u);
+
+    // Connectivity over positions, normal and texture seams would otherwise cut the mesh into islands
+    std::vector<unsigned int> remap;
+    size_t positionCount = positionRemap(shape.positions, remap);
+    std::vector<unsigned int> corners(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++) corners[i] = remap[shape.indices[i]];
+
+    std::vector<unsigned int> adjacencyStart(positionCount + 1, 0), adjacency(triangleCount * 3);
+    for (auto p : corners) adjacencyStart[p + 1]++;
+    for (size_t p = 0; p < positionCount; p++) adjacencyStart[p + 1] += adjacencyStart[p];
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < corners.size(); i++) adjacency[fill[corners[i]]++] = (unsigned int) (i / 3);
+
+    auto position = [&shape](unsigned int v) {
+      return glm::vec3{shape.positions[v * 3], shape.positions[v * 3 + 1], shape.positions[v * 3 + 2]};
+    };
+
+    // Centroid and unit normal of every triangle, degenerate triangles get a zero normal
+    std::vector<glm::vec3> centroids(triangleCount), normals(triangleCount);
+    glm::vec3 meshCentroid{0.0f};
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+      auto a = position(shape.indices[t * 3]), b = position(shape.indices[t * 3 + 1]), c = position(shape.indices[t * 3 + 2]);
+      auto normal = glm::cross(b - a, c - a);
+      float area = glm::length(normal);
+      centroids[t] = (a + b + c) / 3.0f;
+      normals[t] = area > 0.0f ? normal / area : glm::vec3{0.0f};
+      meshCentroid += centroids[t] * area;
+      meshArea += area;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    const unsigned int none = ~0u;
+    std::vector<bool> used(triangleCount, false);
+    std::vector<unsigned int> positionMeshlet(positionCount, none), frontierMeshlet(triangleCount, none);
+    std::vector<unsigned int> members, frontier;
+    std::vector<std::vector<unsigned int>> clusters;
+    size_t cursor = 0;
+
+    while (true) {
+      while (cursor < triangleCount && used[cursor]) cursor++;
+      if (cursor == triangleCount) break;
+
+      auto id = (unsigned int) clusters.size();
+      glm::vec3 boundsMin{0.0f}, boundsMax{0.0f}, normalSum{0.0f};
+      members.clear();
+      frontier.clear();
+
+      auto add = [&](unsigned int t) {
+        used[t] = true;
+        members.push_back(t);
+        normalSum += normals[t];
+        for (int k = 0; k < 3; k++) {
+          auto p = corners[t * 3 + k];
+          auto point = position(shape.indices[t * 3 + k]);
+          boundsMin = members.size() == 1 && k == 0 ? point : glm::min(boundsMin, point);
+          boundsMax = members.size() == 1 && k == 0 ? point : glm::max(boundsMax, point);
+          if (positionMeshlet[p] == id) continue;
+          positionMeshlet[p] = id;
+          for (auto i = adjacencyStart[p]; i < adjacencyStart[p + 1]; i++) {
+            auto neighbour = adjacency[i];
+            if (used[neighbour] || frontierMeshlet[neighbour] == id) continue;
+            frontierMeshlet[neighbour] = id;
+            frontier.push_back(neighbour);
+          }
+        }
+      };
+
+      add((unsigned int) cursor);
+      while (members.size() < maxTriangles) {
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = glm::length(boundsMax - boundsMin) * 0.5f + 1e-12f;
+        float axisLength = glm::length(normalSum);
+        glm::vec3 axis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3{0.0f};
+
+        // Prefer triangles sharing an edge, then close ones facing the same way
+        unsigned int best = none;
+        float bestCost = 0.0f;
+        size_t kept = 0;
+        for (auto t : frontier) {
+          if (used[t]) continue;
+          frontier[kept++] = t;
+          int shared = 0;
+          for (int k = 0; k < 3; k++) shared += positionMeshlet[corners[t * 3 + k]] == id;
+          float cost = (float) (3 - shared) + glm::length(centroids[t] - center) / radius
+                       + NORMAL_WEIGHT * (1.0f - glm::dot(normals[t], axis));
+          if (best == none || cost < bestCost) {
+            best = t;
+            bestCost = cost;
+          }
+        }
+        frontier.resize(kept);
+
+        // Disconnected pieces such as leaves or bolts are merged with the nearest ones in draw order
+        if (best == none) {
+          if (members.size() >= minTriangles) break;
+          size_t seen = 0;
+          for (size_t t = cursor; t < triangleCount && seen < FALLBACK_WINDOW; t++) {
+            if (used[t]) continue;
+            seen++;
+            float cost = glm::length(centroids[t] - center) / radius
+                         + NORMAL_WEIGHT * (1.0f - glm::dot(normals[t], axis));
+            if (best == none || cost < bestCost) {
+              best = (unsigned int) t;
+              bestCost = cost;
+            }
+          }
+          if (best == none) break;
+        }
+        if (members.size() >= minTriangles && glm::dot(normals[best], axis) < STOP_DOT) break;
+        add(best);
+      }
+
+      // Keep the vertex cache order of the triangles
+      std::sort(members.begin(), members.end());
+      clusters.push_back(members);
+    }
+
+    // Bounds and normal cone of every meshlet
+    std::vector<Meshlet> meshlets(clusters.size());
+    std::vector<float> keys(clusters.size());
+    for (size_t m = 0; m < clusters.size(); m++) {
+      auto &meshlet = meshlets[m];
+      glm::vec3 boundsMin = centroids[clusters[m][0]], boundsMax = boundsMin, normalSum{0.0f};
+      for (auto t : clusters[m]) {
+        for (int k = 0; k < 3; k++) {
+          auto point = position(shape.indices[t * 3 + k]);
+          boundsMin = glm::min(boundsMin, point);
+          boundsMax = glm::max(boundsMax, point);
+        }
+        normalSum += normals[t];
+      }
+      meshlet.center = (boundsMin + boundsMax) * 0.5f;
+      for (auto t : clusters[m])
+        for (int k = 0; k < 3; k++)
+          meshlet.radius = std::max(meshlet.radius, glm::length(position(shape.indices[t * 3 + k]) - meshlet.center));
+
+      float axisLength = glm::length(normalSum);
+      meshlet.coneCutoff = 1.0f;
+      if (axisLength > 0.0f) {
+        meshlet.coneAxis = normalSum / axisLength;
+        float minDot = 1.0f;
+        for (auto t : clusters[m])
+          if (normals[t] != glm::vec3{0.0f}) minDot = std::min(minDot, glm::dot(normals[t], meshlet.coneAxis));
+        if (minDot > MIN_CONE_DOT) meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+      }
+
+      // Same overdraw order as optimizeOverdraw, meshlets facing away from the mesh center first
+      keys[m] = glm::dot(meshlet.center - meshCentroid, meshlet.coneAxis);
+    }
+
+    std::vector<size_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> indices;
+    indices.reserve(shape.indices.size());
+    for (auto m : order) {
+      auto meshlet = meshlets[m];
+      meshlet.indexOffset = (uint32_t) indices.size();
+      for (auto t : clusters[m]) indices.insert(indices.end(), &shape.indices[t * 3], &shape.indices[t * 3] + 3);
+      meshlet.indexCount = (uint32_t) (indices.size() - meshlet.indexOffset);
+      shape.meshlets.push_back(meshlet);
+    }
+    std::copy(indices.begin(), indices.end(), shape.indices.begin());
+    optimizeVertexFetch(shape);
+  }
+
+  MeshletCuller::MeshletCuller(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model) {
+    // Frustum planes of the combined matrix are in mesh space (Gribb and Hartmann 2001)
+    glm::mat4 m = projection * view * model;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) row[i] = {m[0][i], m[1][i], m[2][i], m[3][i]};
+    planes[0] = row[3] + row[0];
+    planes[1] = row[3] - row[0];
+    planes[2] = row[3] + row[1];
+    planes[3] = row[3] - row[1];
+    planes[4] = row[3] + row[2];
+    planes[5] = row[3] - row[2];
+    for (auto &plane : planes) {
+      float length = glm::length(glm::vec3{plane});
+      if (length > 0.0f) plane /= length;
+    }
+
+    camera = glm::vec3{glm::inverse(view * model) * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f}};
+
+    // Mirroring model matrices flip the winding, cones would then point the wrong way
+    backFaces = glm::determinant(glm::mat3{model}) > 0.0f;
+  }
+
+  MeshletCuller::Result MeshletCuller::test(const Meshlet &meshlet) const {
+    for (auto &plane : planes)
+      if (glm::dot(glm::vec3{plane}, meshlet.center) + plane.w < -meshlet.radius) return Outside;
+
+    // Every normal within the cone points away from every point of the bounding sphere
+    if (backFaces && meshlet.coneCutoff < 1.0f) {
+      glm::vec3 direction = meshlet.center - camera;
+      if (glm::dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(direction) + meshlet.radius)
+        return BackFacing;
+    }
+    return Visible;
+  }
+}
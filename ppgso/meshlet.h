@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh_data.h"
+
+namespace ppgso {
+
+  /*!
+   * Split the full detail triangles of a shape into meshlets and reorder its indices so every meshlet is a
+   * contiguous range.
+   *
+   * Meshlets are grown from a seed over triangles sharing positions with it, preferring close triangles facing the
+   * same way and stopping early at sharp turns, which keeps the bounding spheres small and the normal cones narrow.
+   * Triangles keep their vertex cache order within a meshlet and meshlets facing away from the mesh center are drawn
+   * first to reduce overdraw.
+   * Vertices are renumbered in the new fetch order, call before generateLods.
+   *
+   * @param shape - Shape to partition in place, the first level of its LOD table if any is the full detail one.
+   * @param minTriangles - Smaller meshlets are merged with the nearest triangles even when not connected.
+   * @param maxTriangles - Largest meshlet.
+   */
+  void buildMeshlets(MeshShape &shape, unsigned int minTriangles = 64, unsigned int maxTriangles = 128);
+
+  /*!
+   * Reject meshlets outside the view frustum or facing away from the camera.
+   * Tests run in mesh space, so the camera and frustum are transformed once per draw instead of every meshlet.
+   */
+  class MeshletCuller {
+  public:
+    enum Result {
+      Visible,
+      Outside,      // Bounding sphere outside the view frustum
+      BackFacing    // Every triangle faces away from the camera
+    };
+
+    /*!
+     * Prepare the culler for one draw of a mesh.
+     *
+     * @param projection - Camera projection matrix.
+     * @param view - Camera view matrix.
+     * @param model - Model matrix of the mesh.
+     */
+    MeshletCuller(const glm::mat4 &projection, const glm::mat4 &view, const glm::mat4 &model);
+
+    /*!
+     * Test a single meshlet.
+     *
+     * @param meshlet - Meshlet bounds in mesh space.
+     * @return - Visible or the reason it can be skipped.
+     */
+    Result test(const Meshlet &meshlet) const;
+
+  private:
+    glm::vec4 planes[6];
+    glm::vec3 camera;
+    bool backFaces;
+  };
+}
@@ -0,0 +1,30 @@
+#include <algorithm>
+#include <new>
+
+#include "planar_image.h"
+
+static const std::align_val_t PLANE_ALIGNMENT{32};
+
+ppgso::PlanarImage::PlanarImage(int width, int height)
+        : width{width}, height{height}, stride{((size_t) std::max(width, 0) + 7) & ~(size_t) 7} {
+  size_t count = stride * std::max(height, 0) * 3;
+  if (!count) return;
+  planes.reset(static_cast<float *>(::operator new[](count * sizeof(float), PLANE_ALIGNMENT)));
+  std::fill(planes.get(), planes.get() + count, 0.0f);
+}
+
+void ppgso::PlanarImage::AlignedDelete::operator()(float *planes) const {
+  ::operator delete[](planes, PLANE_ALIGNMENT);
+}
+
+float *ppgso::PlanarImage::row(int channel, int y) {
+  return planes.get() + ((size_t) channel * height + y) * stride;
+}
+
+const float *ppgso::PlanarImage::row(int channel, int y) const {
+  return planes.get() + ((size_t) channel * height + y) * stride;
+}
+
+size_t ppgso::PlanarImage::getStride() const {
+  return stride;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+namespace ppgso {
+
+  /*!
+   * Floating point RGB image with every channel in its own plane, for processing steps which need more than 8 bits
+   * per channel or work on one channel at a time.
+   *
+   * Rows of every plane start 32 byte aligned and are padded to a multiple of 8 values, so SSE and AVX kernels load
+   * whole rows without a scalar tail. Values are usually in the range <0, 1>. Rows run from the top like in Image.
+   */
+  class PlanarImage {
+  public:
+    /*!
+     * Create new image with all values zero.
+     *
+     * @param width - Width in pixels.
+     * @param height - Height in pixels.
+     */
+    PlanarImage(int width, int height);
+
+    /*!
+     * Get a row of one channel.
+     *
+     * @param channel - 0 for red, 1 for green, 2 for blue.
+     * @param y - Row from the top.
+     * @return - Pointer to getStride() values, the first width of them are pixels.
+     */
+    float *row(int channel, int y);
+
+    /*!
+     * Get a row of one channel for reading.
+     *
+     * @param channel - 0 for red, 1 for green, 2 for blue.
+     * @param y - Row from the top.
+     * @return - Pointer to getStride() values, the first width of them are pixels.
+     */
+    const float *row(int channel, int y) const;
+
+    /*!
+     * Get distance between the starts of two rows.
+     *
+     * @return - Number of floats, a multiple of 8.
+     */
+    size_t getStride() const;
+
+    int width, height;
+  private:
+    struct AlignedDelete {
+      void operator()(float *planes) const;
+    };
+
+    size_t stride;
+    std::unique_ptr<float[], AlignedDelete> planes;
+  };
+}
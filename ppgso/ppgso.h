@@ -22,8 +22,27 @@ namespace ppgso {
 #include "image.h"
 #include "image_bmp.h"
 #include "image_raw.h"
+#include "compressed_image.h"
+#include "image_bc.h"
+#include "image_mips.h"
+#include "planar_image.h"
+#include "image_ops.h"
 #include "texture.h"
 #include "window.h"
+#include "thread_pool.h"
+#include "asset_streamer.h"
+#include "mesh_simplify.h"
+#include "meshlet.h"
+#include "geometry_arena.h"
+#include "asset_pack.h"
+#include "material_library.h"
+#include "residency.h"
+#include "memory_tracker.h"
+#include "texture_uploader.h"
+#include "texture_cache.h"
+#include "texture_array.h"
+#include "texture_packer.h"
+#include "uniform_buffer.h"
 
 namespace ppgso {
   /*!
@@ -0,0 +1,103 @@
+#include <iterator>
+#include <stdexcept>
+
+#include "range_allocator.h"
+
+namespace ppgso {
+
+  float RangeAllocator::Stats::fragmentation() const {
+    size_t free = capacity - used;
+    return free ? 1.0f - (float) largestFree / (float) free : 0.0f;
+  }
+
+  RangeAllocator::RangeAllocator(size_t capacity) {
+    grow(capacity);
+  }
+
+  size_t RangeAllocator::allocate(size_t size) {
+    if (size == 0) throw std::runtime_error("RangeAllocator: Zero sized allocation");
+
+    auto fit = freeBySize.lower_bound(size);
+    if (fit == freeBySize.end()) return invalid;
+
+    size_t offset = fit->second;
+    size_t blockSize = fit->first;
+    eraseFree(freeByOffset.find(offset));
+    if (blockSize > size) insertFree(offset + size, blockSize - size);
+
+    allocated[offset] = size;
+    used += size;
+    return offset;
+  }
+
+  void RangeAllocator::free(size_t offset) {
+    auto it = allocated.find(offset);
+    if (it == allocated.end()) throw std::runtime_error("RangeAllocator: Freeing unknown range");
+    size_t size = it->second;
+    allocated.erase(it);
+    used -= size;
+
+    // Merge with the free blocks right before and after
+    auto next = freeByOffset.lower_bound(offset);
+    if (next != freeByOffset.end() && next->first == offset + size) {
+      size += next->second;
+      eraseFree(next);
+    }
+    next = freeByOffset.lower_bound(offset);
+    if (next != freeByOffset.begin()) {
+      auto previous = std::prev(next);
+      if (previous->first + previous->second == offset) {
+        offset = previous->first;
+        size += previous->second;
+        eraseFree(previous);
+      }
+    }
+    insertFree(offset, size);
+  }
+
+  void RangeAllocator::grow(size_t capacity) {
+    if (capacity < total) throw std::runtime_error("RangeAllocator: Cannot shrink");
+    if (capacity == total) return;
+
+    size_t offset = total, size = capacity - total;
+    total = capacity;
+    if (!freeByOffset.empty()) {
+      auto last = std::prev(freeByOffset.end());
+      if (last->first + last->second == offset) {
+        offset = last->first;
+        size += last->second;
+        eraseFree(last);
+      }
+    }
+    insertFree(offset, size);
+  }
+
+  size_t RangeAllocator::capacity() const {
+    return total;
+  }
+
+  RangeAllocator::Stats RangeAllocator::getStats() const {
+    Stats stats;
+    stats.capacity = total;
+    stats.used = used;
+    stats.allocations = allocated.size();
+    stats.freeBlocks = freeByOffset.size();
+    stats.largestFree = freeBySize.empty() ? 0 : std::prev(freeBySize.end())->first;
+    return stats;
+  }
+
+  void RangeAllocator::insertFree(size_t offset, size_t size) {
+    freeByOffset[offset] = size;
+    freeBySize.emplace(size, offset);
+  }
+
+  void RangeAllocator::eraseFree(std::map<size_t, size_t>::iterator block) {
+    auto range = freeBySize.equal_range(block->second);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second != block->first) continue;
+      freeBySize.erase(it);
+      break;
+    }
+    freeByOffset.erase(block);
+  }
+}
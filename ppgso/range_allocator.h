@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+
+namespace ppgso {
+
+  /*!
+   * Best fit free list allocator handing out ranges of an abstract address space, for example a GPU buffer.
+   * Freed ranges are merged with free neighbours so the space does not fall apart into unusable slivers.
+   */
+  class RangeAllocator {
+  public:
+    static const size_t invalid = ~(size_t) 0;
+
+    /*!
+     * Free list counters, all sizes in allocator units.
+     */
+    struct Stats {
+      size_t capacity = 0;
+      size_t used = 0;
+      size_t allocations = 0;
+      size_t freeBlocks = 0;
+      size_t largestFree = 0;
+
+      /*!
+       * Get share of the free space which is not part of the largest free block.
+       *
+       * @return - 0 when all free space is contiguous, approaching 1 when it is scattered.
+       */
+      float fragmentation() const;
+    };
+
+    /*!
+     * Create allocator with a single free block.
+     *
+     * @param capacity - Size of the address space.
+     */
+    explicit RangeAllocator(size_t capacity = 0);
+
+    /*!
+     * Allocate the smallest free block which fits, splitting off the rest.
+     *
+     * @param size - Requested size, must be positive.
+     * @return - Offset of the range or invalid when no free block is large enough.
+     */
+    size_t allocate(size_t size);
+
+    /*!
+     * Return a range to the free list.
+     *
+     * @param offset - Offset returned by allocate().
+     */
+    void free(size_t offset);
+
+    /*!
+     * Extend the address space, the new space is appended as free.
+     *
+     * @param capacity - New size, must not be smaller than the current one.
+     */
+    void grow(size_t capacity);
+
+    /*!
+     * Get size of the address space.
+     *
+     * @return - Capacity in allocator units.
+     */
+    size_t capacity() const;
+
+    /*!
+     * Get free list counters.
+     *
+     * @return - Current statistics.
+     */
+    Stats getStats() const;
+
+  private:
+    void insertFree(size_t offset, size_t size);
+    void eraseFree(std::map<size_t, size_t>::iterator block);
+
+    size_t total = 0;
+    size_t used = 0;
+    std::map<size_t, size_t> freeByOffset;            // Offset to size
+    std::multimap<size_t, size_t> freeBySize;         // Size to offset
+    std::unordered_map<size_t, size_t> allocated;     // Offset to size
+  };
+}
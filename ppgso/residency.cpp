@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "residency.h"
+
+namespace ppgso {
+
+  ResidencyManager::ResidencyManager(size_t gpuBudget) : gpuBudget{gpuBudget} {}
+
+  bool ResidencyManager::add(uint64_t id, size_t gpuBytes, size_t cpuBytes, std::function<void()> evict) {
+    remove(id);
+    entries.push_front({id, gpuBytes, cpuBytes, frame, std::move(evict)});
+    index[id] = entries.begin();
+
+    stats.assets++;
+    stats.gpuBytes += gpuBytes;
+    stats.cpuBytes += cpuBytes;
+    stats.peakGpuBytes = std::max(stats.peakGpuBytes, stats.gpuBytes);
+
+    bool reload = evicted.erase(id) > 0;
+    if (reload) stats.reloads++;
+    return reload;
+  }
+
+  void ResidencyManager::remove(uint64_t id) {
+    auto found = index.find(id);
+    if (found == index.end()) return;
+    stats.assets--;
+    stats.gpuBytes -= found->second->gpuBytes;
+    stats.cpuBytes -= found->second->cpuBytes;
+    entries.erase(found->second);
+    index.erase(found);
+  }
+
+  void ResidencyManager::resize(uint64_t id, size_t gpuBytes) {
+    auto found = index.find(id);
+    if (found == index.end()) return;
+    stats.gpuBytes = stats.gpuBytes - found->second->gpuBytes + gpuBytes;
+    stats.peakGpuBytes = std::max(stats.peakGpuBytes, stats.gpuBytes);
+    found->second->gpuBytes = gpuBytes;
+  }
+
+  void ResidencyManager::touch(uint64_t id) {
+    auto found = index.find(id);
+    if (found == index.end()) return;
+    found->second->frame = frame;
+    entries.splice(entries.begin(), entries, found->second);
+  }
+
+  bool ResidencyManager::contains(uint64_t id) const {
+    return index.count(id) > 0;
+  }
+
+  size_t ResidencyManager::endFrame() {
+    size_t count = 0;
+    while (gpuBudget && stats.gpuBytes > gpuBudget && !entries.empty()) {
+      // Everything behind the first asset drawn this frame is older, the list is ordered by use
+      auto &oldest = entries.back();
+      if (oldest.frame == frame) {
+        stats.overBudgetFrames++;
+        break;
+      }
+
+      auto evict = std::move(oldest.evict);
+      stats.evictions++;
+      stats.evictedBytes += oldest.gpuBytes;
+      evicted.insert(oldest.id);
+      remove(oldest.id);
+      // The owner may add or remove other assets from the callback, the entry is gone by now
+      if (evict) evict();
+      count++;
+    }
+    frame++;
+    return count;
+  }
+
+  void ResidencyManager::clear() {
+    entries.clear();
+    index.clear();
+    evicted.clear();
+    stats = {};
+  }
+
+  ResidencyManager::Stats ResidencyManager::getStats() const {
+    return stats;
+  }
+
+  void ResidencyManager::printStats(std::ostream &out) const {
+    double mb = 1024.0 * 1024.0;
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1) << "Residency: " << stats.assets << " assets, "
+        << stats.gpuBytes / mb << " MB VRAM";
+    if (gpuBudget) out << " of " << gpuBudget / mb << " MB budget";
+    out << " (peak " << stats.peakGpuBytes / mb << " MB) and " << stats.cpuBytes / mb << " MB CPU, "
+        << stats.evictions << " evicted (" << stats.evictedBytes / mb << " MB), " << stats.reloads << " reloaded";
+    if (stats.overBudgetFrames) out << ", " << stats.overBudgetFrames << " frames over budget";
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ppgso {
+
+  /*!
+   * Keeps GPU assets within a memory budget by evicting the least recently drawn ones.
+   *
+   * Owners add every asset they upload with its size and a callback releasing it, then touch() it whenever it is
+   * drawn. endFrame() evicts assets not drawn in the current frame, oldest first, until the budget holds again.
+   * Owners reload evicted assets on demand and add them again, which is counted as a reload.
+   * Assets are identified by 64bit ids chosen by the owner, e.g. content hashes. All calls must come from the thread
+   * owning the OpenGL context, eviction callbacks run within endFrame().
+   */
+  class ResidencyManager {
+  public:
+    /*!
+     * Memory in use and eviction counters.
+     */
+    struct Stats {
+      size_t assets = 0;                // Currently resident
+      size_t gpuBytes = 0;
+      size_t cpuBytes = 0;              // CPU copies kept alongside the resident assets
+      size_t peakGpuBytes = 0;
+      size_t evictions = 0;
+      size_t evictedBytes = 0;
+      size_t reloads = 0;               // Assets added again after being evicted
+      size_t overBudgetFrames = 0;      // Frames whose drawn assets alone did not fit the budget
+    };
+
+    /*!
+     * Create manager with a budget.
+     *
+     * @param gpuBudget - Largest amount of GPU memory kept resident in bytes, 0 for unlimited.
+     */
+    explicit ResidencyManager(size_t gpuBudget = 0);
+
+    ResidencyManager(const ResidencyManager &) = delete;
+    ResidencyManager &operator=(const ResidencyManager &) = delete;
+
+    /*!
+     * Start tracking an uploaded asset as most recently used, replacing an entry with the same id.
+     *
+     * @param id - Unique id of the asset.
+     * @param gpuBytes - GPU memory held by the asset.
+     * @param cpuBytes - CPU memory kept for the asset.
+     * @param evict - Releases the asset, called at most once.
+     * @return - True when the asset was evicted before and this is a reload.
+     */
+    bool add(uint64_t id, size_t gpuBytes, size_t cpuBytes, std::function<void()> evict);
+
+    /*!
+     * Stop tracking an asset without evicting it, when its owner releases it.
+     *
+     * @param id - Id passed to add().
+     */
+    void remove(uint64_t id);
+
+    /*!
+     * Update the GPU memory of an asset whose size changed, e.g. when mipmap levels were loaded or released.
+     *
+     * @param id - Id passed to add().
+     * @param gpuBytes - GPU memory now held by the asset.
+     */
+    void resize(uint64_t id, size_t gpuBytes);
+
+    /*!
+     * Mark an asset as drawn in the current frame.
+     *
+     * @param id - Id passed to add().
+     */
+    void touch(uint64_t id);
+
+    /*!
+     * Check whether an asset is tracked.
+     *
+     * @param id - Id passed to add().
+     * @return - True when added and not evicted or removed since.
+     */
+    bool contains(uint64_t id) const;
+
+    /*!
+     * Evict least recently drawn assets until the budget holds, then start a new frame.
+     * Assets drawn in the ending frame are never evicted.
+     *
+     * @return - Number of assets evicted.
+     */
+    size_t endFrame();
+
+    /*!
+     * Stop tracking every asset and reset the counters, for owners dropping all their assets at once.
+     */
+    void clear();
+
+    /*!
+     * Get memory and eviction counters.
+     *
+     * @return - Copy of current statistics.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print resident memory against the budget and eviction counters.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+    size_t gpuBudget;
+
+  private:
+    struct Entry {
+      uint64_t id;
+      size_t gpuBytes;
+      size_t cpuBytes;
+      uint64_t frame;                   // Last frame the asset was drawn in
+      std::function<void()> evict;
+    };
+
+    std::list<Entry> entries;           // Most recently drawn first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    std::unordered_set<uint64_t> evicted;
+    uint64_t frame = 0;
+    Stats stats;
+  };
+}
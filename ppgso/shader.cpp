@@ -8,6 +8,61 @@
 #include "texture.h"
 #include "shader.h"
 
+GLuint ppgso::Shader::current = 0;
+ppgso::Shader::Stats ppgso::Shader::stats;
+
+// Uniform upload by type, count elements of an array starting at location
+static void upload(GLint location, const float *values, int count) {
+  glUniform1fv(location, count, values);
+}
+
+static void upload(GLint location, const int *values, int count) {
+  glUniform1iv(location, count, values);
+}
+
+static void upload(GLint location, const glm::vec2 *values, int count) {
+  glUniform2fv(location, count, glm::value_ptr(*values));
+}
+
+static void upload(GLint location, const glm::vec3 *values, int count) {
+  glUniform3fv(location, count, glm::value_ptr(*values));
+}
+
+static void upload(GLint location, const glm::vec4 *values, int count) {
+  glUniform4fv(location, count, glm::value_ptr(*values));
+}
+
+static void upload(GLint location, const glm::mat3 *values, int count) {
+  glUniformMatrix3fv(location, count, GL_FALSE, glm::value_ptr(*values));
+}
+
+static void upload(GLint location, const glm::mat4 *values, int count) {
+  glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(*values));
+}
+
+template<typename T>
+void ppgso::Uniform<T>::set(const T &value) const {
+  set(&value, 1);
+}
+
+template<typename T>
+void ppgso::Uniform<T>::set(const T *values, int count) const {
+  if (location < 0) return;
+  shader->use();
+  upload(location, values, count);
+  Shader::stats.uniformSets++;
+}
+
+namespace ppgso {
+  template class Uniform<float>;
+  template class Uniform<int>;
+  template class Uniform<glm::vec2>;
+  template class Uniform<glm::vec3>;
+  template class Uniform<glm::vec4>;
+  template class Uniform<glm::mat3>;
+  template class Uniform<glm::mat4>;
+}
+
 
 ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &fragment_shader_code) {
   // Create shaders
@@ -74,15 +129,75 @@ ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &
   glDeleteShader(fragment_shader_id);
 
   program = program_id;
+  reflectUniforms();
   use();
 }
 
 ppgso::Shader::~Shader() {
+  // A new program may get the same id
+  if (current == program) current = 0;
   glDeleteProgram( program );
 }
 
+void ppgso::Shader::reflectUniforms() {
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::string buffer((size_t) maxLength, '\0');
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type;
+    glGetActiveUniform(program, (GLuint) i, maxLength, &length, &size, &type, &buffer[0]);
+    std::string name = buffer.substr(0, (size_t) length);
+    // Members of uniform blocks have no location
+    GLint location = glGetUniformLocation(program, name.c_str());
+    if (location < 0) continue;
+    locations[name] = location;
+
+    // Arrays are reported by their first element, "name" and every "name[i]" are valid names too
+    if (name.size() < 3 || name.compare(name.size() - 3, 3, "[0]") != 0) continue;
+    auto array = name.substr(0, name.size() - 3);
+    locations[array] = location;
+    for (GLint element = 1; element < size; element++) {
+      auto elementName = array + "[" + std::to_string(element) + "]";
+      locations[elementName] = glGetUniformLocation(program, elementName.c_str());
+    }
+  }
+}
+
+GLint ppgso::Shader::findUniform(const std::string &name) const {
+  auto location = locations.find(name);
+  return location != locations.end() ? location->second : -1;
+}
+
+bool ppgso::Shader::setUniformBlock(const std::string &name, GLuint binding) const {
+  auto index = glGetUniformBlockIndex(program, name.c_str());
+  if (index == GL_INVALID_INDEX) return false;
+  glUniformBlockBinding(program, index, binding);
+  return true;
+}
+
 void ppgso::Shader::use() const {
+  if (current == program) {
+    stats.skippedBinds++;
+    return;
+  }
   glUseProgram(program);
+  current = program;
+  stats.programBinds++;
+}
+
+void ppgso::Shader::resetBinding() {
+  current = 0;
+}
+
+ppgso::Shader::Stats ppgso::Shader::getStats() {
+  return stats;
+}
+
+void ppgso::Shader::resetStats() {
+  stats = {};
 }
 
 GLuint ppgso::Shader::getAttribLocation(const std::string &name) const {
@@ -91,38 +206,43 @@ GLuint ppgso::Shader::getAttribLocation(const std::string &name) const {
 }
 
 GLuint ppgso::Shader::getUniformLocation(const std::string &name) const {
-  use();
-  return (GLuint) glGetUniformLocation(program, name.c_str());
+  stats.namedSets++;
+  return (GLuint) findUniform(name);
 }
 
 void ppgso::Shader::setUniform(const std::string &name, const Texture &texture, const int id) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform1i(uniform, id);
   texture.bind(id);
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::mat4 matrix) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniformMatrix4fv(uniform, 1, GL_FALSE, value_ptr(matrix));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::mat3 matrix) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniformMatrix3fv(uniform, 1, GL_FALSE, value_ptr(matrix));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, float value) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform1f(uniform, value);
 }
 
 void ppgso::Shader::setUniform(const std::string &name, int value) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform1i(uniform, value);
 }
 
@@ -132,18 +252,21 @@ GLuint ppgso::Shader::getProgram() const {
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec2 vector) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform2fv(uniform, 1, value_ptr(vector));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec3 vector) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform3fv(uniform, 1, value_ptr(vector));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec4 vector) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
+  stats.uniformSets++;
   glUniform4fv(uniform, 1, value_ptr(vector));
 }
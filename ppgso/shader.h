@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <unordered_map>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -9,8 +10,58 @@
 
 namespace ppgso {
 
+  class Shader;
+
+  /*!
+   * Uniform of a shader program resolved once by Shader::uniform(), set with no name lookup.
+   * Handles of uniforms the program does not use, e.g. optimized out by the compiler, ignore set().
+   * The handle must not outlive its shader.
+   */
+  template<typename T>
+  class Uniform {
+  public:
+    Uniform() = default;
+
+    /*!
+     * Set the value, binding the program first unless it is already in use.
+     *
+     * @param value - Value to set uniform to.
+     */
+    void set(const T &value) const;
+
+    /*!
+     * Set consecutive elements of an array uniform, starting with the element of this handle.
+     *
+     * @param values - Values to set elements to.
+     * @param count - Number of elements to set.
+     */
+    void set(const T *values, int count) const;
+
+    /*!
+     * Check whether the program uses the uniform.
+     *
+     * @return - True when set() changes anything.
+     */
+    bool isActive() const { return location >= 0; }
+
+  private:
+    friend class Shader;
+    Uniform(const Shader *shader, GLint location) : shader{shader}, location{location} {}
+    const Shader *shader = nullptr;
+    GLint location = -1;
+  };
+
   class Shader {
   public:
+    /*!
+     * OpenGL calls issued by all shaders.
+     */
+    struct Stats {
+      size_t programBinds = 0;          // glUseProgram calls
+      size_t skippedBinds = 0;          // use() of the program already in use
+      size_t uniformSets = 0;           // glUniform* calls
+      size_t namedSets = 0;             // Uniforms looked up by name, e.g. by setUniform()
+    };
 
     /*!
      * Compile and manage an GLSL program and its inputs.
@@ -23,10 +74,15 @@ namespace ppgso {
     ~Shader();
 
     /*!
-     * Set up the program for use in OpenGL state.
+     * Set up the program for use in OpenGL state, unless it is already in use.
      */
     void use() const;
 
+    /*!
+     * Forget which program is in use, call after glUseProgram outside of Shader.
+     */
+    static void resetBinding();
+
     /*!
      * Get OpenGL attribute location for for the input specified by "name"
      *
@@ -37,12 +93,46 @@ namespace ppgso {
 
     /*!
      * Get OpenGL uniform location for for the input specified by "name"
+     * Locations of all active uniforms are looked up once when the program is linked.
      *
      * @param name - Name of the shader program input variable.
-     * @return - OpenGL attribute location number.
+     * @return - OpenGL attribute location number, -1 cast to GLuint when the program does not use the uniform.
      */
     GLuint getUniformLocation(const std::string &name) const;
 
+    /*!
+     * Resolve a uniform into a handle setting it without looking up its name, e.g. once after compiling the shader.
+     * Elements of arrays are resolved by "name[i]", members of structures by "name.member".
+     *
+     * @param name - Name of the shader program uniform input variable.
+     * @return - Handle of the uniform, inactive when the program does not use it.
+     */
+    template<typename T>
+    Uniform<T> uniform(const std::string &name) const {
+      return {this, findUniform(name)};
+    }
+
+    /*!
+     * Connect a uniform block of the program to a binding point, e.g. of a UniformBuffer shared by several programs.
+     *
+     * @param name - Name of the uniform block.
+     * @param binding - Uniform buffer binding point.
+     * @return - False when the program has no active block of that name.
+     */
+    bool setUniformBlock(const std::string &name, GLuint binding) const;
+
+    /*!
+     * Get OpenGL calls issued by all shaders since the last reset.
+     *
+     * @return - Copy of the counters.
+     */
+    static Stats getStats();
+
+    /*!
+     * Reset the call counters, e.g. at the start of a frame.
+     */
+    static void resetStats();
+
     /*!
      * Get OpenGL program identifier number.
      *
@@ -117,7 +207,13 @@ namespace ppgso {
     void setUniform(const std::string &name, glm::mat3 matrix) const;
 
   private:
+    template<typename> friend class Uniform;
+    void reflectUniforms();
+    GLint findUniform(const std::string &name) const;
     GLuint program;
+    std::unordered_map<std::string, GLint> locations;
+    static GLuint current;
+    static Stats stats;
   };
 
 }
@@ -1,46 +1,182 @@
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 #include "texture.h"
+#include "image_mips.h"
+
+// Full RGB8 mipmap chain, built from the first level by update()
+static size_t rgbBytes(int width, int height) {
+  return ppgso::CompressedImage::byteSize(ppgso::CompressedImage::Format::RGB8, width, height,
+                                          ppgso::CompressedImage::fullChain(width, height));
+}
+
+// Levels from level on
+static size_t levelsFrom(const ppgso::CompressedImage &image, int level) {
+  return image.byteSize() - ppgso::CompressedImage::byteSize(image.format, image.width, image.height, level);
+}
 
 ppgso::Texture::Texture(int width, int height) : image{width, height} {
-  initGL();
+  initGL(width, height, GL_RGB8, CompressedImage::fullChain(width, height), rgbBytes(width, height));
   update();
 }
 
 ppgso::Texture::Texture(Image&& image) : image{std::move(image)} {
-  initGL();
+  int width = this->image.width, height = this->image.height;
+  initGL(width, height, GL_RGB8, CompressedImage::fullChain(width, height), rgbBytes(width, height));
   update();
 }
 
+ppgso::Texture::Texture(const CompressedImage &image) : image{0, 0} {
+  initGL(image.width, image.height, internalFormat(image.format), image.levels, image.byteSize());
+  uploadLevels(image, image.data());
+}
+
+ppgso::Texture::Texture(const CompressedImage &image, GLuint pixelBuffer) : image{0, 0} {
+  initGL(image.width, image.height, internalFormat(image.format), image.levels, image.byteSize());
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+  // With a bound unpack buffer the pointers are offsets into it
+  uploadLevels(image, nullptr);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+ppgso::Texture::Texture(const CompressedImage &image, int baseLevel, GLuint pixelBuffer) : image{0, 0} {
+  baseLevel = std::min(std::max(baseLevel, 0), image.levels - 1);
+  // Without immutable storage only the defined levels take memory
+  initGL(image.width, image.height, internalFormat(image.format), 0, levelsFrom(image, baseLevel));
+  defineLevels(image, baseLevel, image.levels, pixelBuffer);
+  this->baseLevel = loadedLevel = baseLevel;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+}
+
 ppgso::Texture::~Texture() {
   glDeleteTextures(1, &texture);
 }
 
-void ppgso::Texture::initGL() {
+GLenum ppgso::Texture::internalFormat(CompressedImage::Format format) {
+  switch (format) {
+    case CompressedImage::Format::BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case CompressedImage::Format::BC5:
+      // Normal maps keep only X and Y in two channels, no shader samples them or reconstructs Z yet
+      return GL_COMPRESSED_RG_RGTC2;
+    default:
+      return GL_RGB8;
+  }
+}
+
+void ppgso::Texture::initGL(int width, int height, GLenum format, int levels, size_t bytes) {
   // Create new texture object
   glGenTextures(1, &texture);
   glBindTexture(GL_TEXTURE_2D, texture);
 
   // Reserve texture storage
-  glTexStorage2D(GL_TEXTURE_2D, 3, GL_RGB8, image.width, image.height);
+  this->width = width;
+  this->height = height;
+  this->bytes = bytes;
+  if (levels > 0) glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+  gpuMemory = {MemoryTracker::Category::Texture, "Texture", bytes};
+  // Wrapped pixels belong to someone else, e.g. a mapped asset pack
+  size_t cpuBytes = image.isWrapped() ? 0 : (size_t) image.width * image.height * sizeof(Image::Pixel);
+  cpuMemory = {MemoryTracker::Category::Cpu, "Texture", cpuBytes};
 
   // Set up mipmapping
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-
-  // Update texture with data from image framebuffer
-  update();
 }
 
 void ppgso::Texture::update() {
+  if (!image.data()) return;
   bind();
-  // Upload texture to GPU
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGB, GL_UNSIGNED_BYTE, image.getFramebuffer().data());
+  // Mipmaps are filtered on the CPU like every other texture instead of glGenerateMipmap
+  auto chain = image::buildMipChain(image);
+  uploadLevels(chain, chain.data());
+}
+
+void ppgso::Texture::uploadLevels(const CompressedImage &image, const uint8_t *base) {
+  // Levels come with the image, so no mipmaps are generated
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  GLenum format = internalFormat(image.format);
+  for (int level = 0; level < image.levels; level++) {
+    int levelWidth = image.levelWidth(level), levelHeight = image.levelHeight(level);
+    auto offset = (size_t) (image.levelData(level) - image.data());
+    auto pixels = base ? (const void *) (base + offset) : reinterpret_cast<const void *>(offset);
+    if (CompressedImage::isBlockCompressed(image.format)) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth, levelHeight, format,
+                                (GLsizei) CompressedImage::levelBytes(image.format, levelWidth, levelHeight), pixels);
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelWidth, levelHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    }
+  }
+}
+
+void ppgso::Texture::defineLevels(const CompressedImage &image, int first, int last, GLuint pixelBuffer) {
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  // With a bound unpack buffer the pointers are offsets into it, the first level starts at 0
+  if (pixelBuffer) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+  for (int level = first; level < last; level++) {
+    int levelWidth = image.levelWidth(level), levelHeight = image.levelHeight(level);
+    auto offset = (size_t) (image.levelData(level) - image.levelData(first));
+    auto pixels = pixelBuffer ? reinterpret_cast<const void *>(offset) : (const void *) image.levelData(level);
+    if (CompressedImage::isBlockCompressed(image.format)) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat(image.format), levelWidth, levelHeight, 0,
+                             (GLsizei) CompressedImage::levelBytes(image.format, levelWidth, levelHeight), pixels);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, levelWidth, levelHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    }
+  }
+  if (pixelBuffer) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void ppgso::Texture::loadLevel(const CompressedImage &image, int level, GLuint pixelBuffer) {
+  if (level != loadedLevel - 1) throw std::runtime_error("Texture levels must be loaded one by one from coarse to fine");
+  glBindTexture(GL_TEXTURE_2D, texture);
+  defineLevels(image, level, level + 1, pixelBuffer);
+  loadedLevel = level;
+  bytes = levelsFrom(image, loadedLevel);
+  gpuMemory.resize(bytes);
+}
+
+void ppgso::Texture::setBaseLevel(const CompressedImage &image, int baseLevel) {
+  baseLevel = std::min(std::max(baseLevel, 0), image.levels - 1);
+  if (baseLevel == this->baseLevel && baseLevel == loadedLevel) return;
+  glBindTexture(GL_TEXTURE_2D, texture);
+  if (baseLevel < loadedLevel) {
+    defineLevels(image, baseLevel, loadedLevel, 0);
+    loadedLevel = baseLevel;
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+  // Clamped first, then the released levels are redefined as empty images to free their memory
+  for (int level = loadedLevel; level < baseLevel; level++)
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGB8, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  this->baseLevel = loadedLevel = baseLevel;
+  bytes = levelsFrom(image, loadedLevel);
+  gpuMemory.resize(bytes);
+}
+
+int ppgso::Texture::getBaseLevel() const {
+  return baseLevel;
+}
+
+int ppgso::Texture::getLoadedLevel() const {
+  return loadedLevel;
+}
+
+void ppgso::Texture::releaseImage() {
+  image = Image{0, 0};
+  cpuMemory.resize(0);
+}
+
+size_t ppgso::Texture::getBytes() const {
+  return bytes;
+}
 
-  // Re-generate mipmaps
-  glGenerateMipmap(GL_TEXTURE_2D);
+void ppgso::Texture::setOwner(const std::string &owner) {
+  gpuMemory.setOwner(owner);
+  cpuMemory.setOwner(owner);
 }
 
 void ppgso::Texture::bind(int id) const {
@@ -6,7 +6,9 @@
 
 #include <GL/glew.h>
 
+#include "compressed_image.h"
 #include "image.h"
+#include "memory_tracker.h"
 
 namespace ppgso {
 
@@ -22,19 +24,112 @@ namespace ppgso {
     Texture(int width, int height);
 
     /*!
-     * Load from image.
+     * Load from image. The image can be decoded on any thread (e.g. image::loadBMP on a worker),
+     * the upload itself must run on the thread owning the OpenGL context.
      *
      * @param image - Image to use
      */
     Texture(Image&& image);
 
+    /*!
+     * Load from image with all its mipmaps, e.g. mapped from a TextureCache or an asset pack.
+     * Levels are uploaded as they are, without generating mipmaps. The image of the texture stays empty,
+     * update() does nothing.
+     *
+     * @param image - Block compressed or RGB8 levels to upload.
+     */
+    Texture(const CompressedImage &image);
+
+    /*!
+     * Create texture from levels already copied into a pixel unpack buffer, e.g. by TextureUploader.
+     * The copy runs asynchronously on the GPU, a fence issued after this call tells when it finished.
+     * The image of the texture stays empty.
+     *
+     * @param image - Describes the levels, its data is not read.
+     * @param pixelBuffer - OpenGL buffer holding image.byteSize() bytes laid out like image.data().
+     */
+    Texture(const CompressedImage &image, GLuint pixelBuffer);
+
+    /*!
+     * Load only the coarse levels of an image, finer ones are loaded by loadLevel() or setBaseLevel() when they are
+     * needed. Levels are allocated one by one, so fine levels which are not loaded take no GPU memory.
+     *
+     * @param image - Block compressed or RGB8 levels, kept by the caller for later setBaseLevel() calls.
+     * @param baseLevel - Finest level to load now, all coarser ones are loaded too.
+     * @param pixelBuffer - OpenGL buffer holding the levels from baseLevel on laid out like image.data(), starting at
+     *                      offset 0, e.g. filled by TextureUploader. 0 to read the levels from image.
+     */
+    Texture(const CompressedImage &image, int baseLevel, GLuint pixelBuffer = 0);
+
     ~Texture();
 
     /*!
-     * Update the OpenGL texture in memory.
+     * Get the OpenGL internal format textures of a CompressedImage format are stored in.
+     *
+     * @param format - Format of the levels.
+     * @return - Internal format for glTexStorage2D/3D.
+     */
+    static GLenum internalFormat(CompressedImage::Format format);
+
+    /*!
+     * Update the OpenGL texture in memory, its mipmaps are built from image on the CPU by image::buildMipChain.
+     * Does nothing once the image was released.
      */
     void update();
 
+    /*!
+     * Free the CPU copy of the pixels kept in image, for textures which are never updated after the upload.
+     */
+    void releaseImage();
+
+    /*!
+     * Load the next finer level of a texture created with a base level without sampling it yet, e.g. from a buffer
+     * whose transfer is fenced. A later setBaseLevel() starts sampling it without uploading it again.
+     *
+     * @param image - Image the texture was created from.
+     * @param level - getLoadedLevel() - 1.
+     * @param pixelBuffer - OpenGL buffer holding the level at offset 0, 0 to read it from image.
+     */
+    void loadLevel(const CompressedImage &image, int level, GLuint pixelBuffer = 0);
+
+    /*!
+     * Load or release fine levels of a texture created with a base level, so that sampling is clamped to the finest
+     * loaded one by GL_TEXTURE_BASE_LEVEL. Levels which are not loaded yet are uploaded synchronously, levels finer
+     * than baseLevel are released.
+     *
+     * @param image - Image the texture was created from.
+     * @param baseLevel - New finest level.
+     */
+    void setBaseLevel(const CompressedImage &image, int baseLevel);
+
+    /*!
+     * Get finest level in GPU memory.
+     *
+     * @return - 0 unless the texture was created with a base level.
+     */
+    int getBaseLevel() const;
+
+    /*!
+     * Get finest level in GPU memory, finer than the base level while loadLevel() results are not sampled yet.
+     *
+     * @return - 0 unless the texture was created with a base level.
+     */
+    int getLoadedLevel() const;
+
+    /*!
+     * Get GPU memory used by the texture including its mipmaps.
+     *
+     * @return - Size in bytes.
+     */
+    size_t getBytes() const;
+
+    /*!
+     * Report the texture and its CPU copy under an owner other than "Texture" in MemoryTracker.
+     *
+     * @param owner - Name of the owner.
+     */
+    void setOwner(const std::string &owner);
+
     /*!
      * Get OpenGL texture identifier number.
      *
@@ -51,8 +146,15 @@ namespace ppgso {
 
     Image image;
   private:
-    void initGL();
+    void initGL(int width, int height, GLenum format, int levels, size_t bytes);
+    void uploadLevels(const CompressedImage &image, const uint8_t *base);
+    void defineLevels(const CompressedImage &image, int first, int last, GLuint pixelBuffer);
     GLuint texture;
+    int width, height;
+    int baseLevel = 0;
+    int loadedLevel = 0;
+    size_t bytes;
+    MemoryTracker::Allocation gpuMemory, cpuMemory;
   };
 }
 
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "texture.h"
+#include "texture_array.h"
+
+namespace ppgso {
+
+  // Texture units on which bind() left an array, 16 is the minimum every OpenGL 3.3 context offers
+  static const int TRACKED_UNITS = 16;
+  static GLuint boundArrays[TRACKED_UNITS] = {};
+  static size_t arrayBinds = 0;
+
+  TextureArray::TextureArray(CompressedImage::Format format, int width, int height, int levels, int layers)
+          : format{format}, width{width}, height{height}, levels{levels}, used((size_t) std::max(layers, 1), false) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, Texture::internalFormat(format), width, height,
+                   (GLsizei) used.size());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    // The array went to whatever unit is active
+    resetBinding();
+    memory = {MemoryTracker::Category::Texture, "TextureArray", used.size() * getLayerBytes()};
+  }
+
+  TextureArray::~TextureArray() {
+    for (auto &bound : boundArrays)
+      if (bound == texture) bound = 0;
+    glDeleteTextures(1, &texture);
+  }
+
+  bool TextureArray::accepts(const CompressedImage &image) const {
+    return image.format == format && image.width == width && image.height == height && image.levels == levels;
+  }
+
+  int TextureArray::add(const CompressedImage &image) {
+    auto free = std::find(used.begin(), used.end(), false);
+    if (free == used.end()) return -1;
+    int layer = (int) (free - used.begin());
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLenum internal = Texture::internalFormat(format);
+    for (int level = 0; level < levels; level++) {
+      int levelWidth = image.levelWidth(level), levelHeight = image.levelHeight(level);
+      if (CompressedImage::isBlockCompressed(format)) {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, internal,
+                                  (GLsizei) CompressedImage::levelBytes(format, levelWidth, levelHeight),
+                                  image.levelData(level));
+      } else {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, GL_RGB,
+                        GL_UNSIGNED_BYTE, image.levelData(level));
+      }
+    }
+    resetBinding();
+
+    *free = true;
+    usedLayers++;
+    return layer;
+  }
+
+  void TextureArray::remove(int layer) {
+    if (layer < 0 || layer >= (int) used.size() || !used[layer]) return;
+    used[layer] = false;
+    usedLayers--;
+  }
+
+  int TextureArray::getUsedLayers() const {
+    return usedLayers;
+  }
+
+  int TextureArray::getLayers() const {
+    return (int) used.size();
+  }
+
+  size_t TextureArray::getLayerBytes() const {
+    return CompressedImage::byteSize(format, width, height, levels);
+  }
+
+  void TextureArray::bind(int unit) const {
+    if (unit >= 0 && unit < TRACKED_UNITS && boundArrays[unit] == texture) return;
+    glActiveTexture((GLenum) (GL_TEXTURE0 + unit));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    if (unit >= 0 && unit < TRACKED_UNITS) boundArrays[unit] = texture;
+    arrayBinds++;
+  }
+
+  void TextureArray::resetBinding() {
+    std::fill(std::begin(boundArrays), std::end(boundArrays), 0);
+  }
+
+  size_t TextureArray::getBindCount() {
+    return arrayBinds;
+  }
+
+  void TextureArray::resetBindCount() {
+    arrayBinds = 0;
+  }
+
+  GLuint TextureArray::getTexture() const {
+    return texture;
+  }
+}
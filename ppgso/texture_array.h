@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "compressed_image.h"
+#include "memory_tracker.h"
+
+namespace ppgso {
+
+  /*!
+   * Layers of equally sized textures in a single GL_TEXTURE_2D_ARRAY.
+   *
+   * Objects drawn with different layers of one array share the texture binding and differ only in the layer index,
+   * so consecutive draws need no texture state changes. Unlike an atlas, every layer keeps its own mipmaps and repeat
+   * wrapping, which texture coordinates outside [0, 1] rely on. The storage for all layers is allocated up front.
+   */
+  class TextureArray {
+  public:
+    /*!
+     * Allocate storage for all layers, requires a current OpenGL context.
+     *
+     * @param format - Format of the levels of every layer.
+     * @param width - Width of the first level in pixels.
+     * @param height - Height of the first level in pixels.
+     * @param levels - Number of mipmap levels of every layer.
+     * @param layers - Number of layers.
+     */
+    TextureArray(CompressedImage::Format format, int width, int height, int levels, int layers);
+    TextureArray(const TextureArray &) = delete;
+    TextureArray &operator=(const TextureArray &) = delete;
+    ~TextureArray();
+
+    /*!
+     * Check whether an image has the format, size and levels of the layers.
+     *
+     * @param image - Image to check.
+     * @return - True when the image can be added.
+     */
+    bool accepts(const CompressedImage &image) const;
+
+    /*!
+     * Upload an image with all its levels into a free layer.
+     *
+     * @param image - Image for which accepts() is true.
+     * @return - Layer index or -1 when all layers are used.
+     */
+    int add(const CompressedImage &image);
+
+    /*!
+     * Release a layer for reuse, its contents stay until overwritten.
+     *
+     * @param layer - Index returned by add().
+     */
+    void remove(int layer);
+
+    /*!
+     * Get number of layers holding an image.
+     *
+     * @return - Used layer count.
+     */
+    int getUsedLayers() const;
+
+    /*!
+     * Get number of layers.
+     *
+     * @return - Layer count.
+     */
+    int getLayers() const;
+
+    /*!
+     * Get GPU memory of a single layer including its mipmaps.
+     *
+     * @return - Size in bytes.
+     */
+    size_t getLayerBytes() const;
+
+    /*!
+     * Bind the array to a texture unit unless it already is.
+     *
+     * @param unit - Texture unit the sampler2DArray reads from.
+     */
+    void bind(int unit) const;
+
+    /*!
+     * Forget which arrays are bound, call after binding other texture arrays.
+     */
+    static void resetBinding();
+
+    /*!
+     * Get number of array binds issued by bind() since the last reset.
+     *
+     * @return - Bind count.
+     */
+    static size_t getBindCount();
+
+    /*!
+     * Reset the bind counter, usually once per frame.
+     */
+    static void resetBindCount();
+
+    /*!
+     * Get OpenGL texture identifier number.
+     *
+     * @return - OpenGL texture identifier number.
+     */
+    GLuint getTexture() const;
+
+  private:
+    CompressedImage::Format format;
+    int width, height, levels;
+    GLuint texture = 0;
+    std::vector<bool> used;
+    int usedLayers = 0;
+    MemoryTracker::Allocation memory;
+  };
+}
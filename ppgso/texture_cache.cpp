@@ -0,0 +1,246 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+#include "hash.h"
+#include "mapped_file.h"
+#include "texture_cache.h"
+
+namespace fs = std::filesystem;
+
+namespace ppgso {
+
+  // On-disk layout: header, level table, then the levels 16 byte aligned from the largest one down
+  static const char CACHE_MAGIC[4] = {'P', 'P', 'G', 'T'};
+  static const uint32_t CACHE_VERSION = 1;
+  static const char *CACHE_EXTENSION = ".texcache";
+  static const uint32_t MAX_LEVELS = 16;
+
+  struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+  };
+  static_assert(sizeof(CacheHeader) == 48, "Unexpected texture cache header size");
+
+  struct CacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+  };
+  static_assert(sizeof(CacheLevel) == 24, "Unexpected texture cache level record size");
+
+  struct SourceSignature {
+    uint64_t size = 0;
+    int64_t time = 0;
+  };
+
+  static bool sourceSignature(const std::string &source, SourceSignature &signature) {
+    std::error_code ec;
+    auto size = fs::file_size(source, ec);
+    if (ec) return false;
+    auto time = fs::last_write_time(source, ec);
+    if (ec) return false;
+    signature.size = (uint64_t) size;
+    signature.time = (int64_t) time.time_since_epoch().count();
+    return true;
+  }
+
+  static uint64_t sourceHash(const std::string &source) {
+    MappedFile file{source};
+    return hash64(file.data(), file.size());
+  }
+
+  static uint64_t align16(uint64_t offset) {
+    return (offset + 15) & ~uint64_t{15};
+  }
+
+  static std::mutex statsMutex;
+  static TextureCache::Stats stats;
+
+  bool TextureCache::enabled = true;
+
+  std::string TextureCache::pathFor(const std::string &source) {
+    return source + CACHE_EXTENSION;
+  }
+
+  std::shared_ptr<const CompressedImage> TextureCache::open(const std::string &source) {
+    auto path = pathFor(source);
+    SourceSignature signature;
+    if (!fs::exists(path) || !sourceSignature(source, signature)) return nullptr;
+
+    std::shared_ptr<MappedFile> file;
+    try {
+      file = std::make_shared<MappedFile>(path);
+    } catch (std::exception &) {
+      return nullptr;
+    }
+
+    auto image = parse(file->data(), file->size(), file);
+    if (!image) return nullptr;
+
+    // Cheap checks first, hash the source only when size and time match
+    CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.sourceSize != signature.size || header.sourceTime != signature.time) return nullptr;
+    if (header.sourceHash != sourceHash(source)) return nullptr;
+    return image;
+  }
+
+  std::shared_ptr<const CompressedImage> TextureCache::parse(const uint8_t *data, size_t bytes,
+                                                             std::shared_ptr<const void> storage) {
+    auto size = (uint64_t) bytes;
+    if (!data || size < sizeof(CacheHeader)) return nullptr;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION) return nullptr;
+
+    auto format = (CompressedImage::Format) header.format;
+    if (format != CompressedImage::Format::BC1 && format != CompressedImage::Format::BC5 &&
+        format != CompressedImage::Format::RGB8)
+      return nullptr;
+    if (header.width == 0 || header.height == 0 || header.width > 65536 || header.height > 65536 ||
+        header.levelCount == 0 || header.levelCount > MAX_LEVELS)
+      return nullptr;
+
+    uint64_t tableEnd = sizeof(CacheHeader) + (uint64_t) header.levelCount * sizeof(CacheLevel);
+    if (tableEnd > size) return nullptr;
+
+    // CompressedImage keeps its levels back to back, which is what serialize() writes
+    CompressedImage expected{format, (int) header.width, (int) header.height, (int) header.levelCount, nullptr, {}};
+    uint64_t first = align16(tableEnd);
+    if (first + expected.byteSize() > size) return nullptr;
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+      CacheLevel record;
+      std::memcpy(&record, data + sizeof(CacheHeader) + level * sizeof(CacheLevel), sizeof(record));
+      int width = expected.levelWidth((int) level), height = expected.levelHeight((int) level);
+      if (record.width != (uint32_t) width || record.height != (uint32_t) height ||
+          record.size != CompressedImage::levelBytes(format, width, height) ||
+          record.offset != first + CompressedImage::byteSize(format, expected.width, expected.height, (int) level))
+        return nullptr;
+    }
+
+    return std::make_shared<CompressedImage>(format, expected.width, expected.height, expected.levels, data + first,
+                                             std::move(storage));
+  }
+
+  std::vector<uint8_t> TextureCache::serialize(const CompressedImage &image) {
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.format = (uint32_t) image.format;
+    header.width = (uint32_t) image.width;
+    header.height = (uint32_t) image.height;
+    header.levelCount = (uint32_t) image.levels;
+
+    uint64_t first = align16(sizeof(CacheHeader) + (uint64_t) image.levels * sizeof(CacheLevel));
+    std::vector<CacheLevel> records((size_t) image.levels);
+    for (int level = 0; level < image.levels; level++) {
+      auto &record = records[level];
+      record.width = (uint32_t) image.levelWidth(level);
+      record.height = (uint32_t) image.levelHeight(level);
+      record.offset = first + (uint64_t) (image.levelData(level) - image.data());
+      record.size = CompressedImage::levelBytes(image.format, image.levelWidth(level), image.levelHeight(level));
+    }
+
+    // The gap left by the alignment stays zero
+    std::vector<uint8_t> result(first + image.byteSize(), 0);
+    std::memcpy(result.data(), &header, sizeof(header));
+    std::memcpy(result.data() + sizeof(header), records.data(), records.size() * sizeof(CacheLevel));
+    std::memcpy(result.data() + first, image.data(), image.byteSize());
+    return result;
+  }
+
+  bool TextureCache::write(const std::string &source, const CompressedImage &image) {
+    SourceSignature signature;
+    if (!sourceSignature(source, signature)) return false;
+
+    auto container = serialize(image);
+    CacheHeader header;
+    std::memcpy(&header, container.data(), sizeof(header));
+    header.sourceSize = signature.size;
+    header.sourceTime = signature.time;
+    try {
+      header.sourceHash = sourceHash(source);
+    } catch (std::exception &) {
+      return false;
+    }
+    std::memcpy(container.data(), &header, sizeof(header));
+
+    // Write into a temporary file first so an interrupted write never leaves a valid looking cache behind
+    auto path = pathFor(source);
+    auto tmpPath = path + ".tmp";
+    {
+      std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+      if (!out.is_open()) return false;
+      out.write((const char *) container.data(), (std::streamsize) container.size());
+      if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+      fs::remove(tmpPath, ec);
+      return false;
+    }
+    return true;
+  }
+
+  std::shared_ptr<const CompressedImage> TextureCache::load(const std::string &source,
+                                                            const std::function<CompressedImage()> &build) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    if (enabled) {
+      auto image = open(source);
+      if (image) {
+        std::lock_guard<std::mutex> lock{statsMutex};
+        stats.hits++;
+        stats.hitSeconds += elapsed();
+        stats.hitBytes += image->byteSize();
+        return image;
+      }
+    }
+
+    auto image = std::make_shared<CompressedImage>(build());
+    if (enabled) write(source, *image);
+
+    std::lock_guard<std::mutex> lock{statsMutex};
+    stats.misses++;
+    stats.missSeconds += elapsed();
+    return image;
+  }
+
+  TextureCache::Stats TextureCache::getStats() {
+    std::lock_guard<std::mutex> lock{statsMutex};
+    return stats;
+  }
+
+  void TextureCache::printStats(std::ostream &out) {
+    auto s = getStats();
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1)
+        << "Texture cache: " << s.hits << " warm loads (" << s.hitBytes / (1024.0 * 1024.0) << " MB) in "
+        << s.hitSeconds * 1000.0 << " ms";
+    if (s.hits) out << " (" << s.hitSeconds * 1000.0 / s.hits << " ms/texture)";
+    out << ", " << s.misses << " cold loads in " << s.missSeconds * 1000.0 << " ms";
+    if (s.misses) out << " (" << s.missSeconds * 1000.0 / s.misses << " ms/texture)";
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
+
+#include "compressed_image.h"
+
+namespace ppgso {
+
+  /*!
+   * Versioned container of textures with all their mipmaps, used as sidecar cache of source images and for texture
+   * entries of asset packs.
+   *
+   * Like KTX the container describes every level by its size and offset, the levels follow one another 16 byte
+   * aligned in upload order, so a mapped container is handed to OpenGL level by level without decoding or mipmap
+   * generation. The first load of "brick.bmp" writes "brick.bmp.texcache", later loads map it. The cache is rebuilt
+   * when size, modification time or content hash of the source file changes.
+   */
+  class TextureCache {
+  public:
+    /*!
+     * Cache hit/miss counters and time spent loading textures.
+     */
+    struct Stats {
+      int hits = 0;
+      int misses = 0;
+      double hitSeconds = 0.0;
+      double missSeconds = 0.0;
+      size_t hitBytes = 0;
+    };
+
+    /*!
+     * Global switch, when false textures are always built from source.
+     */
+    static bool enabled;
+
+    /*!
+     * Get sidecar cache file path for a source file.
+     *
+     * @param source - Path to the source image file.
+     * @return - Path to the cache file.
+     */
+    static std::string pathFor(const std::string &source);
+
+    /*!
+     * Open the cache for a source file.
+     *
+     * @param source - Path to the source image file.
+     * @return - Texture wrapping the mapped cache or nullptr when missing, stale or corrupted.
+     */
+    static std::shared_ptr<const CompressedImage> open(const std::string &source);
+
+    /*!
+     * Write a texture built from a source file into its sidecar cache.
+     *
+     * @param source - Path to the source image file.
+     * @param image - Texture to store with all its levels.
+     * @return - True when the cache was written.
+     */
+    static bool write(const std::string &source, const CompressedImage &image);
+
+    /*!
+     * Serialize a texture into the container layout without a source signature, as used for texture entries in
+     * asset packs.
+     *
+     * @param image - Texture to store with all its levels.
+     * @return - Container image, levels are 16 byte aligned relative to its start.
+     */
+    static std::vector<uint8_t> serialize(const CompressedImage &image);
+
+    /*!
+     * Validate a container in memory and wrap its levels without copying. The source signature is not checked.
+     *
+     * @param data - Container image.
+     * @param size - Size of the image in bytes.
+     * @param storage - Keeps data alive for as long as the texture wraps it.
+     * @return - Texture or nullptr when the image is truncated, corrupted or of another version.
+     */
+    static std::shared_ptr<const CompressedImage> parse(const uint8_t *data, size_t size,
+                                                        std::shared_ptr<const void> storage);
+
+    /*!
+     * Load a texture using the cache when possible, otherwise build it and refresh the cache.
+     * Safe to call from worker threads.
+     *
+     * @param source - Path to the source image file.
+     * @param build - Called on cache miss, e.g. to load the image and build its mip chain.
+     * @return - Texture with all its levels.
+     */
+    static std::shared_ptr<const CompressedImage> load(const std::string &source,
+                                                       const std::function<CompressedImage()> &build);
+
+    /*!
+     * Get accumulated cache statistics.
+     *
+     * @return - Copy of current statistics.
+     */
+    static Stats getStats();
+
+    /*!
+     * Print accumulated cache statistics, comparing cold (built) and warm (mapped) load times.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printStats(std::ostream &out);
+  };
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "texture_packer.h"
+
+namespace ppgso {
+
+  TexturePacker::Layer::Layer(std::shared_ptr<TextureArray> array, int index) : array{std::move(array)}, index{index} {}
+
+  TexturePacker::Layer::~Layer() {
+    array->remove(index);
+  }
+
+  TextureArray &TexturePacker::Layer::getArray() const {
+    return *array;
+  }
+
+  int TexturePacker::Layer::getIndex() const {
+    return index;
+  }
+
+  size_t TexturePacker::Layer::getBytes() const {
+    return array->getLayerBytes();
+  }
+
+  TexturePacker::TexturePacker(size_t arrayBytes, int maxLayers) : arrayBytes{arrayBytes}, maxLayers{maxLayers} {}
+
+  bool TexturePacker::canPack(const CompressedImage &image) const {
+    // An array with a single layer would only add a binding of its own
+    auto layerBytes = image.byteSize();
+    return layerBytes > 0 && layerBytes <= arrayBytes / 2;
+  }
+
+  std::shared_ptr<TexturePacker::Layer> TexturePacker::add(const CompressedImage &image) {
+    if (!canPack(image)) return nullptr;
+    auto layerBytes = image.byteSize();
+
+    arrays.erase(std::remove_if(arrays.begin(), arrays.end(), [](const std::weak_ptr<TextureArray> &array) {
+      return array.expired();
+    }), arrays.end());
+
+    for (auto &weak : arrays) {
+      auto array = weak.lock();
+      if (!array || !array->accepts(image)) continue;
+      int index = array->add(image);
+      if (index >= 0) return std::make_shared<Layer>(array, index);
+    }
+
+    int layers = (int) std::min<size_t>(arrayBytes / layerBytes, (size_t) maxLayers);
+    auto array = std::make_shared<TextureArray>(image.format, image.width, image.height, image.levels, layers);
+    arrays.push_back(array);
+    return std::make_shared<Layer>(array, array->add(image));
+  }
+
+  TexturePacker::Stats TexturePacker::getStats() const {
+    Stats stats;
+    for (auto &weak : arrays) {
+      auto array = weak.lock();
+      if (!array || array->getUsedLayers() == 0) continue;
+      stats.arrays++;
+      stats.usedLayers += array->getUsedLayers();
+      stats.layers += array->getLayers();
+      stats.usedBytes += array->getUsedLayers() * array->getLayerBytes();
+      stats.bytes += array->getLayers() * array->getLayerBytes();
+    }
+    return stats;
+  }
+
+  void TexturePacker::printStats(std::ostream &out) const {
+    auto s = getStats();
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1)
+        << "Texture arrays: " << s.arrays << " arrays, " << s.usedLayers << "/" << s.layers << " layers used ("
+        << s.usedBytes / (1024.0 * 1024.0) << " of " << s.bytes / (1024.0 * 1024.0) << " MB)"
+        << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "compressed_image.h"
+#include "texture_array.h"
+
+namespace ppgso {
+
+  /*!
+   * Places textures into layers of texture arrays grouped by format, size and number of levels.
+   *
+   * Textures of the same shape end up in the same array, so objects using them can be drawn one after another with a
+   * single texture binding. Arrays are created on demand and released together with their last layer.
+   * Every array allocates all its layers up front, owners budgeting GPU memory should account whole arrays.
+   */
+  class TexturePacker {
+  public:
+    /*!
+     * Layer holding one texture, the layer is released for reuse when the last reference goes away.
+     */
+    class Layer {
+    public:
+      Layer(std::shared_ptr<TextureArray> array, int index);
+      Layer(const Layer &) = delete;
+      Layer &operator=(const Layer &) = delete;
+      ~Layer();
+
+      /*!
+       * Get the array holding the layer.
+       *
+       * @return - Texture array.
+       */
+      TextureArray &getArray() const;
+
+      /*!
+       * Get index of the layer in its array, as passed to the shader.
+       *
+       * @return - Layer index.
+       */
+      int getIndex() const;
+
+      /*!
+       * Get GPU memory of the layer.
+       *
+       * @return - Size in bytes.
+       */
+      size_t getBytes() const;
+
+    private:
+      std::shared_ptr<TextureArray> array;
+      int index;
+    };
+
+    /*!
+     * Arrays, layers and memory held by the packer.
+     */
+    struct Stats {
+      int arrays = 0;
+      int usedLayers = 0;
+      int layers = 0;
+      size_t usedBytes = 0;
+      size_t bytes = 0;
+    };
+
+    /*!
+     * Create an empty packer.
+     *
+     * @param arrayBytes - Target size of a single array, determines how many layers it gets.
+     * @param maxLayers - Upper bound of layers of a single array.
+     */
+    explicit TexturePacker(size_t arrayBytes = 32 * 1024 * 1024, int maxLayers = 256);
+
+    /*!
+     * Check whether add() would place a texture into an array.
+     *
+     * @param image - Texture with all its levels.
+     * @return - False when the texture is too large to be worth sharing an array.
+     */
+    bool canPack(const CompressedImage &image) const;
+
+    /*!
+     * Upload a texture into a layer of an array of its shape, requires a current OpenGL context.
+     *
+     * @param image - Texture with all its levels.
+     * @return - Layer holding the texture or nullptr when the texture is too large to be worth sharing an array.
+     */
+    std::shared_ptr<Layer> add(const CompressedImage &image);
+
+    /*!
+     * Get current statistics.
+     *
+     * @return - Arrays, layers and their memory.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print current statistics.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+  private:
+    size_t arrayBytes;
+    int maxLayers;
+    // Layers own their array, so it goes away with the last of them
+    std::vector<std::weak_ptr<TextureArray>> arrays;
+  };
+}
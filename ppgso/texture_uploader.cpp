@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+
+#include "texture_uploader.h"
+
+namespace ppgso {
+
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  TextureUploader::TextureUploader(ThreadPool &pool, int buffers, size_t bufferBytes)
+          : pool{pool}, bufferBytes{bufferBytes}, slots((size_t) std::max(buffers, 1)) {
+    for (auto &slot : slots) {
+      glGenBuffers(1, &slot.buffer);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) bufferBytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    memory = {MemoryTracker::Category::Buffer, "TextureUploader", slots.size() * bufferBytes};
+  }
+
+  TextureUploader::~TextureUploader() {
+    clear();
+    for (auto &slot : slots) glDeleteBuffers(1, &slot.buffer);
+  }
+
+  void TextureUploader::upload(std::shared_ptr<const CompressedImage> image,
+                               std::function<void(std::shared_ptr<Texture>)> ready) {
+    queue.push_back({std::move(image), std::move(ready), 0, nullptr});
+    stats.queued++;
+  }
+
+  void TextureUploader::upload(std::shared_ptr<const CompressedImage> image, int baseLevel,
+                               std::function<void(std::shared_ptr<Texture>)> ready) {
+    baseLevel = std::min(std::max(baseLevel, 0), image->levels - 1);
+    queue.push_back({std::move(image), std::move(ready), baseLevel, nullptr});
+    stats.queued++;
+  }
+
+  void TextureUploader::uploadLevel(std::shared_ptr<Texture> texture, std::shared_ptr<const CompressedImage> image,
+                                    int level, std::function<void(std::shared_ptr<Texture>)> ready) {
+    queue.push_back({std::move(image), std::move(ready), level, std::move(texture)});
+    stats.queued++;
+  }
+
+  const uint8_t *TextureUploader::Request::pixels() const {
+    return image->levelData(level);
+  }
+
+  size_t TextureUploader::Request::bytes() const {
+    // Levels follow each other from the finest, a single level ends where the next coarser one starts
+    auto end = target && level + 1 < image->levels ? image->levelData(level + 1) : image->data() + image->byteSize();
+    return (size_t) (end - pixels());
+  }
+
+  std::shared_ptr<Texture> TextureUploader::create(const Request &request, GLuint buffer) {
+    auto &image = *request.image;
+    if (request.target) {
+      request.target->loadLevel(image, request.level, buffer);
+      return request.target;
+    }
+    if (request.level > 0) return std::make_shared<Texture>(image, request.level, buffer);
+    return buffer ? std::make_shared<Texture>(image, buffer) : std::make_shared<Texture>(image);
+  }
+
+  void TextureUploader::release(Slot &slot) {
+    if (slot.state == Slot::State::Copying) {
+      slot.copy.wait();
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    if (slot.fence) glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.request = {};
+    slot.copy = {};
+    slot.texture.reset();
+    slot.state = Slot::State::Free;
+  }
+
+  size_t TextureUploader::pump() {
+    double start = now();
+    size_t handed = 0;
+
+    // Hand out textures whose transfer finished, the flush makes sure pending fences eventually signal
+    for (auto &slot : slots) {
+      if (slot.state != Slot::State::Transferring) continue;
+      auto status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (status == GL_TIMEOUT_EXPIRED) continue;
+      auto texture = std::move(slot.texture);
+      auto ready = std::move(slot.request.ready);
+      release(slot);
+      if (ready) ready(std::move(texture));
+      stats.uploaded++;
+      handed++;
+    }
+
+    // Start transfers of copied pixels, the texture is not handed out before its fence
+    for (auto &slot : slots) {
+      if (slot.state != Slot::State::Copying ||
+          slot.copy.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+      slot.copy.get();
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+      stats.bytes += slot.request.bytes();
+      // Buffer contents may be lost while mapped, e.g. on a display mode switch
+      slot.texture = create(slot.request, intact ? slot.buffer : 0);
+      slot.request.image.reset();
+      slot.request.target.reset();
+      slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      slot.state = Slot::State::Transferring;
+    }
+
+    // Copy queued images into free buffers on the pool
+    auto slot = slots.begin();
+    while (!queue.empty()) {
+      auto &request = queue.front();
+      size_t bytes = request.bytes();
+      if (bytes <= bufferBytes && bytes > 0) {
+        slot = std::find_if(slot, slots.end(), [](Slot &s) { return s.state == Slot::State::Free; });
+        if (slot == slots.end()) {
+          stats.busyFrames++;
+          break;
+        }
+
+        // The previous transfer from this buffer has finished, so nothing reads it while it is rewritten
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->buffer);
+        auto target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (target) {
+          slot->request = std::move(request);
+          queue.pop_front();
+          // The image stays in the request until the copy finished
+          auto pixels = slot->request.pixels();
+          slot->copy = pool.submit([pixels, target, bytes]() { std::memcpy(target, pixels, bytes); });
+          slot->state = Slot::State::Copying;
+          continue;
+        }
+      }
+
+      // Too large for a buffer or the buffer could not be mapped
+      auto texture = create(request, 0);
+      if (request.ready) request.ready(std::move(texture));
+      queue.pop_front();
+      stats.bytes += bytes;
+      stats.uploaded++;
+      stats.direct++;
+      handed++;
+    }
+
+    double seconds = now() - start;
+    stats.pumpSeconds += seconds;
+    stats.maxPumpSeconds = std::max(stats.maxPumpSeconds, seconds);
+    return handed;
+  }
+
+  void TextureUploader::clear() {
+    queue.clear();
+    for (auto &slot : slots) release(slot);
+  }
+
+  bool TextureUploader::idle() const {
+    return queue.empty() && std::all_of(slots.begin(), slots.end(), [](const Slot &slot) {
+      return slot.state == Slot::State::Free;
+    });
+  }
+
+  TextureUploader::Stats TextureUploader::getStats() const {
+    return stats;
+  }
+
+  void TextureUploader::printStats(std::ostream &out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2)
+        << "Texture uploads: " << stats.uploaded << "/" << stats.queued << " textures ("
+        << stats.bytes / (1024.0 * 1024.0) << " MB) through " << slots.size() << " x "
+        << bufferBytes / (1024.0 * 1024.0) << " MB buffers, " << stats.direct << " direct, " << stats.busyFrames
+        << " frames waiting for a buffer, " << stats.pumpSeconds * 1000.0 << " ms total, "
+        << stats.maxPumpSeconds * 1000.0 << " ms max per frame" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+  }
+}
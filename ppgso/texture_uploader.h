@@ -0,0 +1,157 @@
+#pragma once
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "compressed_image.h"
+#include "memory_tracker.h"
+#include "texture.h"
+#include "thread_pool.h"
+
+namespace ppgso {
+
+  /*!
+   * Uploads textures with all their mipmaps through a ring of pixel unpack buffers without stalling the render thread.
+   *
+   * pump() maps a free buffer of the ring for each queued image and copies its levels into it on a pool worker.
+   * Once copied, the buffer is unmapped and the texture is created from it level by level, which lets the driver
+   * transfer the pixels asynchronously. A fence marks the end of the transfer; only when it has signalled is the
+   * texture handed to its callback and the buffer reused, so textures are never bound half uploaded.
+   * Textures streamed by mip level go the same way, their coarse levels first and every finer level on its own.
+   * Images larger than a buffer are uploaded directly. All calls must come from the thread owning the OpenGL context.
+   */
+  class TextureUploader {
+  public:
+    /*!
+     * Upload counters.
+     */
+    struct Stats {
+      size_t queued = 0;
+      size_t uploaded = 0;
+      size_t direct = 0;                // Images larger than a buffer, uploaded synchronously
+      size_t bytes = 0;
+      size_t busyFrames = 0;            // Frames in which images waited for a free buffer
+      double pumpSeconds = 0.0;
+      double maxPumpSeconds = 0.0;      // Longest time spent in a single pump()
+    };
+
+    /*!
+     * Create the buffer ring, requires a current OpenGL context.
+     *
+     * @param pool - Worker pool copying pixels into the mapped buffers.
+     * @param buffers - Number of buffers in the ring, uploads in flight at once.
+     * @param bufferBytes - Size of each buffer, the largest image uploaded asynchronously.
+     */
+    explicit TextureUploader(ThreadPool &pool = ThreadPool::shared(), int buffers = 4,
+                             size_t bufferBytes = 4 * 1024 * 1024);
+
+    /*!
+     * Drop queued images, wait for running copies and delete the buffers.
+     */
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader &) = delete;
+    TextureUploader &operator=(const TextureUploader &) = delete;
+
+    /*!
+     * Queue an image for upload.
+     *
+     * @param image - Levels to upload, e.g. mapped from a TextureCache, kept until they are copied.
+     * @param ready - Called from pump() with the texture once it can be bound.
+     */
+    void upload(std::shared_ptr<const CompressedImage> image, std::function<void(std::shared_ptr<Texture>)> ready);
+
+    /*!
+     * Queue the coarse levels of an image for upload, finer ones follow with uploadLevel().
+     *
+     * @param image - Levels to upload, kept until they are copied.
+     * @param baseLevel - Finest level to upload, see Texture(const CompressedImage &, int, GLuint).
+     * @param ready - Called from pump() with the texture once it can be bound.
+     */
+    void upload(std::shared_ptr<const CompressedImage> image, int baseLevel,
+                std::function<void(std::shared_ptr<Texture>)> ready);
+
+    /*!
+     * Queue the next finer level of a texture created with a base level. The level is loaded by Texture::loadLevel()
+     * but not sampled, the callback starts sampling it with Texture::setBaseLevel() once the transfer finished.
+     * The texture must not load or release other levels until then.
+     *
+     * @param texture - Texture receiving the level.
+     * @param image - Image the texture was created from, kept until the level is copied.
+     * @param level - texture->getLoadedLevel() - 1.
+     * @param ready - Called from pump() with the texture once the level can be sampled.
+     */
+    void uploadLevel(std::shared_ptr<Texture> texture, std::shared_ptr<const CompressedImage> image, int level,
+                     std::function<void(std::shared_ptr<Texture>)> ready);
+
+    /*!
+     * Hand out finished textures, start transfers of copied images and copies of queued ones.
+     * Call once per frame on the context thread.
+     *
+     * @return - Number of textures handed out.
+     */
+    size_t pump();
+
+    /*!
+     * Drop queued images and transfers in flight without calling their callbacks. Waits for running copies.
+     */
+    void clear();
+
+    /*!
+     * Check whether every queued image was handed out.
+     *
+     * @return - True when nothing is queued, copying or transferring.
+     */
+    bool idle() const;
+
+    /*!
+     * Get upload counters.
+     *
+     * @return - Copy of current statistics.
+     */
+    Stats getStats() const;
+
+    /*!
+     * Print upload counters.
+     *
+     * @param out - Stream to print to.
+     */
+    void printStats(std::ostream &out) const;
+
+  private:
+    struct Request {
+      std::shared_ptr<const CompressedImage> image;
+      std::function<void(std::shared_ptr<Texture>)> ready;
+      int level = 0;                    // First level uploaded
+      std::shared_ptr<Texture> target;  // Receives the single level, a new texture is created when null
+
+      const uint8_t *pixels() const;
+      size_t bytes() const;
+    };
+
+    struct Slot {
+      enum class State { Free, Copying, Transferring } state = State::Free;
+      GLuint buffer = 0;
+      GLsync fence = nullptr;
+      Request request;
+      std::future<void> copy;
+      std::shared_ptr<Texture> texture;
+    };
+
+    void release(Slot &slot);
+    static std::shared_ptr<Texture> create(const Request &request, GLuint buffer);
+
+    ThreadPool &pool;
+    size_t bufferBytes;
+    std::vector<Slot> slots;
+    std::list<Request> queue;
+    MemoryTracker::Allocation memory;
+    Stats stats;
+  };
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+ppgso::ThreadPool::ThreadPool(unsigned int threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  workers.reserve(threads);
+  for (unsigned int i = 0; i < threads; i++)
+    workers.emplace_back(&ThreadPool::work, this);
+}
+
+ppgso::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+unsigned int ppgso::ThreadPool::size() const {
+  return (unsigned int) workers.size();
+}
+
+void ppgso::ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body) {
+  struct State {
+    std::atomic<size_t> next{0};
+    size_t done = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+  auto state = std::make_shared<State>();
+  // Indices are claimed one by one, helpers that start late find nothing left and return
+  auto run = [state, count, &body]() {
+    size_t ran = 0;
+    for (size_t i = state->next++; i < count; i = state->next++, ran++) body(i);
+    if (!ran) return;
+    std::lock_guard<std::mutex> lock{state->mutex};
+    state->done += ran;
+    if (state->done == count) state->finished.notify_all();
+  };
+
+  size_t helpers = std::min<size_t>(workers.size(), count > 0 ? count - 1 : 0);
+  for (size_t i = 0; i < helpers; i++) submit(run);
+  run();
+
+  // Only waits for indices already claimed by running helpers, never for queued ones
+  std::unique_lock<std::mutex> lock{state->mutex};
+  state->finished.wait(lock, [&]() { return state->done == count; });
+}
+
+ppgso::ThreadPool &ppgso::ThreadPool::shared() {
+  static ThreadPool instance;
+  return instance;
+}
+
+void ppgso::ThreadPool::work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+      // Drain the queue before stopping
+      if (queue.empty()) return;
+      job = std::move(queue.front());
+      queue.pop_front();
+    }
+    job();
+  }
+}
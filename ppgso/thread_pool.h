@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ppgso {
+
+  /*!
+   * Fixed size pool of worker threads executing queued jobs in FIFO order.
+   *
+   * Jobs must not touch OpenGL, the context is only current on the thread that created the window.
+   */
+  class ThreadPool {
+  public:
+    /*!
+     * Start worker threads.
+     *
+     * @param threads - Number of workers, 0 uses one worker per hardware thread.
+     */
+    explicit ThreadPool(unsigned int threads = 0);
+
+    /*!
+     * Finish all queued jobs and join the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /*!
+     * Queue a job for execution on a worker thread.
+     *
+     * @param job - Callable to execute, exceptions are forwarded to the returned future.
+     * @return - Future holding the result of the job.
+     */
+    template<typename F>
+    auto submit(F &&job) -> std::future<decltype(job())> {
+      using Result = decltype(job());
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+      auto result = task->get_future();
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        queue.emplace_back([task]() { (*task)(); });
+      }
+      wake.notify_one();
+      return result;
+    }
+
+    /*!
+     * Run a function for every index in [0, count) on the workers and the calling thread, returning once all are done.
+     * The calling thread takes part in the work, so it is safe to call from a job running on the same pool.
+     *
+     * @param count - Number of indices.
+     * @param body - Called once per index, possibly concurrently, must not throw.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+    /*!
+     * Get number of worker threads.
+     *
+     * @return - Number of workers.
+     */
+    unsigned int size() const;
+
+    /*!
+     * Get the pool shared by the ppgso library, created on first use with one worker per hardware thread.
+     *
+     * @return - Shared pool.
+     */
+    static ThreadPool &shared();
+
+  private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+  };
+}
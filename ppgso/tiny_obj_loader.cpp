@@ -33,20 +33,29 @@
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cctype>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 #include <fstream>
 #include <sstream>
 
 #include "tiny_obj_loader.h"
+#include "mapped_file.h"
 
 namespace tinyobj {
 
 #define TINYOBJ_SSCANF_BUFFER_SIZE (4096)
 
+// Files are split into chunks of at least this size for parallel parsing.
+#define TINYOBJ_MIN_CHUNK_SIZE (1024 * 1024)
+
 struct vertex_index {
   int v_idx, vt_idx, vn_idx;
   vertex_index(){};
@@ -54,16 +63,9 @@ struct vertex_index {
   vertex_index(int vidx, int vtidx, int vnidx)
       : v_idx(vidx), vt_idx(vtidx), vn_idx(vnidx){};
 };
-// for std::map
-static inline bool operator<(const vertex_index &a, const vertex_index &b) {
-  if (a.v_idx != b.v_idx)
-    return (a.v_idx < b.v_idx);
-  if (a.vn_idx != b.vn_idx)
-    return (a.vn_idx < b.vn_idx);
-  if (a.vt_idx != b.vt_idx)
-    return (a.vt_idx < b.vt_idx);
-
-  return false;
+// for vertex_table
+static inline bool operator==(const vertex_index &a, const vertex_index &b) {
+  return a.v_idx == b.v_idx && a.vt_idx == b.vt_idx && a.vn_idx == b.vn_idx;
 }
 
 struct obj_shape {
@@ -78,6 +80,28 @@ static inline bool isNewLine(const char c) {
   return (c == '\r') || (c == '\n') || (c == '\0');
 }
 
+// strspn(token, " \t")
+static inline const char *skipSpace(const char *token) {
+  while (isSpace(*token))
+    token++;
+  return token;
+}
+
+// strspn(token, " \t\r")
+static inline const char *skipSpaceCR(const char *token) {
+  while (isSpace(*token) || *token == '\r')
+    token++;
+  return token;
+}
+
+// strcspn(token, " \t\r"), also stopping at '\n' so lines can be parsed in
+// place inside a larger buffer
+static inline const char *skipToken(const char *token) {
+  while (!isSpace(*token) && !isNewLine(*token))
+    token++;
+  return token;
+}
+
 // Make index zero-base, and also support relative index.
 static inline int fixIndex(int idx, int n) {
   if (idx > 0)
@@ -103,6 +127,26 @@ static inline int parseInt(const char *&token) {
   return i;
 }
 
+static inline bool isDigit(const char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// Negative powers of ten for the decimal part. Filled with pow() itself so
+// the sum below is bit identical to calling pow() for every digit.
+struct negative_powers {
+  enum { SIZE = 32 };
+  double value[SIZE];
+  negative_powers() {
+    for (int i = 0; i < SIZE; i++)
+      value[i] = pow(10.0, -i);
+  }
+};
+
+static inline double negativePower(int read) {
+  static const negative_powers table;
+  return read < negative_powers::SIZE ? table.value[read] : pow(10.0, -read);
+}
+
 // Tries to parse a floating point number located at s.
 //
 // s_end should be a location in the string where reading should absolutely
@@ -147,14 +191,12 @@ static bool tryParseDouble(const char *s, const char *s_end, double *result) {
 
   // NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
   // TO JUMP OVER DEFINITIONS.
-  char sign = '+';
-  char exp_sign = '+';
+  bool negative = false;
+  bool exp_negative = false;
   char const *curr = s;
 
   // How many characters were read in a loop.
   int read = 0;
-  // Tells whether a loop terminated due to reaching s_end.
-  bool end_not_reached = false;
 
   /*
           BEGIN PARSING.
@@ -162,17 +204,15 @@ static bool tryParseDouble(const char *s, const char *s_end, double *result) {
 
   // Find out what sign we've got.
   if (*curr == '+' || *curr == '-') {
-    sign = *curr;
+    negative = *curr == '-';
     curr++;
-  } else if (isdigit(*curr)) { /* Pass through. */
-  } else {
+  } else if (!isDigit(*curr)) {
     goto fail;
   }
 
   // Read the integer part.
-  while ((end_not_reached = (curr != s_end)) && isdigit(*curr)) {
-    mantissa *= 10;
-    mantissa += *curr - 0x30;
+  while (curr != s_end && isDigit(*curr)) {
+    mantissa = mantissa * 10 + (*curr - '0');
     curr++;
     read++;
   }
@@ -181,70 +221,115 @@ static bool tryParseDouble(const char *s, const char *s_end, double *result) {
   if (read == 0)
     goto fail;
   // We allow numbers of form "#", "###" etc.
-  if (!end_not_reached)
+  if (curr == s_end)
     goto assemble;
 
   // Read the decimal part.
   if (*curr == '.') {
     curr++;
     read = 1;
-    while ((end_not_reached = (curr != s_end)) && isdigit(*curr)) {
+    while (curr != s_end && isDigit(*curr)) {
       // NOTE: Don't use powf here, it will absolutely murder precision.
-      mantissa += (*curr - 0x30) * pow(10.0, -read);
+      mantissa += (*curr - '0') * negativePower(read);
       read++;
       curr++;
     }
-  } else if (*curr == 'e' || *curr == 'E') {
-  } else {
-    goto assemble;
+    if (curr == s_end)
+      goto assemble;
   }
 
-  if (!end_not_reached)
-    goto assemble;
-
   // Read the exponent part.
   if (*curr == 'e' || *curr == 'E') {
     curr++;
     // Figure out if a sign is present and if it is.
-    if ((end_not_reached = (curr != s_end)) && (*curr == '+' || *curr == '-')) {
-      exp_sign = *curr;
+    if (curr != s_end && (*curr == '+' || *curr == '-')) {
+      exp_negative = *curr == '-';
       curr++;
-    } else if (isdigit(*curr)) { /* Pass through. */
-    } else {
+    } else if (!isDigit(*curr)) {
       // Empty E is not allowed.
       goto fail;
     }
 
     read = 0;
-    while ((end_not_reached = (curr != s_end)) && isdigit(*curr)) {
-      exponent *= 10;
-      exponent += *curr - 0x30;
+    while (curr != s_end && isDigit(*curr)) {
+      exponent = exponent * 10 + (*curr - '0');
       curr++;
       read++;
     }
-    exponent *= (exp_sign == '+' ? 1 : -1);
+    if (exp_negative)
+      exponent = -exponent;
     if (read == 0)
       goto fail;
   }
 
 assemble:
-  *result =
-      (sign == '+' ? 1 : -1) * ldexp(mantissa * pow(5.0, exponent), exponent);
+  // Scaling by 5^0 * 2^0 is exact, skip it for the common case
+  if (exponent != 0)
+    mantissa = ldexp(mantissa * pow(5.0, exponent), exponent);
+  *result = negative ? -mantissa : mantissa;
   return true;
 fail:
   return false;
 }
+
+// Fast path for the plain "[sign]digits[.digits]" numbers exporters write.
+//
+// Integer and fraction are gathered into one integer and divided by a power
+// of ten once, without the dependent multiply-add chain of tryParseDouble.
+// Both doubles are within 1e-15 relative of the decimal value, while a
+// decimal with at most 6 fraction digits is at least 3e-14 relative away from
+// any float rounding midpoint, or exactly on one only when it is >= 2^18. Within
+// those limits the float result is therefore identical to tryParseDouble,
+// anything else returns false and takes the slow path.
+//
+// The token is scanned only once, on success 'token' is left at its end.
+static inline bool tryParseFloatFast(const char *&token, float *result) {
+  static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+  const char *curr = token;
+
+  bool negative = *curr == '-';
+  if (*curr == '+' || *curr == '-')
+    curr++;
+
+  const char *digits = curr;
+  uint64_t integer = 0;
+  while (isDigit(*curr) && curr - digits < 7)
+    integer = integer * 10 + (*curr++ - '0');
+  if (curr == digits || integer >= (1u << 18))
+    return false;
+
+  int fraction = 0;
+  if (*curr == '.') {
+    curr++;
+    const char *start = curr;
+    while (isDigit(*curr) && curr - start < 7)
+      integer = integer * 10 + (*curr++ - '0');
+    fraction = static_cast<int>(curr - start);
+  }
+  // Must have consumed the whole token
+  if (fraction > 6 || !(isSpace(*curr) || isNewLine(*curr)))
+    return false;
+
+  double value = static_cast<double>(integer) / powers[fraction];
+  *result = static_cast<float>(negative ? -value : value);
+  token = curr;
+  return true;
+}
+
 static inline float parseFloat(const char *&token) {
-  token += strspn(token, " \t");
+  token = skipSpace(token);
 #ifdef TINY_OBJ_LOADER_OLD_FLOAT_PARSER
   float f = (float)atof(token);
   token += strcspn(token, " \t\r");
 #else
-  const char *end = token + strcspn(token, " \t\r");
-  double val = 0.0;
-  tryParseDouble(token, end, &val);
-  float f = static_cast<float>(val);
-  token = end;
+  float f;
+  if (!tryParseFloatFast(token, &f)) {
+    const char *end = skipToken(token);
+    double val = 0.0;
+    tryParseDouble(token, end, &val);
+    f = static_cast<float>(val);
+    token = end;
+  }
 #endif
   return f;
 }
@@ -261,13 +346,58 @@ static inline void parseFloat3(float &x, float &y, float &z,
   z = parseFloat(token);
 }
 
+// Make index zero-base and remember whether it was relative (negative) in
+// 'relative', chunked parsing needs to rebase those to the whole file.
+static inline int fixIndex(int idx, int n, unsigned char &relative,
+                           unsigned char bit) {
+  if (idx < 0)
+    relative |= bit;
+  return fixIndex(idx, n);
+}
+
+static const unsigned char RELATIVE_V = 1;
+static const unsigned char RELATIVE_VT = 2;
+static const unsigned char RELATIVE_VN = 4;
+
+// atoi() without the locale lookups, parses one index of a triple. Moves
+// 'token' past the digits unless atoi() had to skip leading space first,
+// skipIndex() then finds the same end either way.
+static inline int parseIndex(const char *&token) {
+  const char *curr = token;
+  while (*curr == ' ' || *curr == '\t' || *curr == '\r' || *curr == '\v' ||
+         *curr == '\f')
+    curr++;
+  bool advance = curr == token;
+  bool negative = false;
+  if (*curr == '+' || *curr == '-') {
+    negative = *curr == '-';
+    curr++;
+  }
+  int value = 0;
+  while (isDigit(*curr)) {
+    value = value * 10 + (*curr - '0');
+    curr++;
+  }
+  if (advance)
+    token = curr;
+  return negative ? -value : value;
+}
+
+// strcspn(token, "/ \t\r"), also stopping at '\n'
+static inline const char *skipIndex(const char *token) {
+  while (*token != '/' && !isSpace(*token) && !isNewLine(*token))
+    token++;
+  return token;
+}
+
 // Parse triples: i, i/j/k, i//k, i/j
 static vertex_index parseTriple(const char *&token, int vsize, int vnsize,
-                                int vtsize) {
+                                int vtsize, unsigned char &relative) {
   vertex_index vi(-1);
+  relative = 0;
 
-  vi.v_idx = fixIndex(atoi(token), vsize);
-  token += strcspn(token, "/ \t\r");
+  vi.v_idx = fixIndex(parseIndex(token), vsize, relative, RELATIVE_V);
+  token = skipIndex(token);
   if (token[0] != '/') {
     return vi;
   }
@@ -276,37 +406,99 @@ static vertex_index parseTriple(const char *&token, int vsize, int vnsize,
   // i//k
   if (token[0] == '/') {
     token++;
-    vi.vn_idx = fixIndex(atoi(token), vnsize);
-    token += strcspn(token, "/ \t\r");
+    vi.vn_idx = fixIndex(parseIndex(token), vnsize, relative, RELATIVE_VN);
+    token = skipIndex(token);
     return vi;
   }
 
   // i/j/k or i/j
-  vi.vt_idx = fixIndex(atoi(token), vtsize);
-  token += strcspn(token, "/ \t\r");
+  vi.vt_idx = fixIndex(parseIndex(token), vtsize, relative, RELATIVE_VT);
+  token = skipIndex(token);
   if (token[0] != '/') {
     return vi;
   }
 
   // i/j/k
   token++; // skip '/'
-  vi.vn_idx = fixIndex(atoi(token), vnsize);
-  token += strcspn(token, "/ \t\r");
+  vi.vn_idx = fixIndex(parseIndex(token), vnsize, relative, RELATIVE_VN);
+  token = skipIndex(token);
   return vi;
 }
 
+// Open addressing hash table welding identical face corners, replaces
+// std::map<vertex_index, unsigned int>. Output vertices are numbered in
+// insertion order, so slots only hold that number and the keys are kept
+// densely in the same order.
+class vertex_table {
+public:
+  explicit vertex_table(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2)
+      capacity *= 2;
+    slots.assign(capacity, EMPTY);
+    mask = capacity - 1;
+    keys.reserve(expected);
+  }
+
+  // Returns the slot holding 'key' or the empty slot where it belongs.
+  size_t find(const vertex_index &key) const {
+    size_t slot = hash(key) & mask;
+    while (slots[slot] != EMPTY && !(keys[slots[slot]] == key))
+      slot = (slot + 1) & mask;
+    return slot;
+  }
+
+  bool empty(size_t slot) const { return slots[slot] == EMPTY; }
+  unsigned int value(size_t slot) const { return slots[slot]; }
+
+  // Store 'key' in an empty slot returned by find(), returns its number.
+  unsigned int insert(size_t slot, const vertex_index &key) {
+    unsigned int value = static_cast<unsigned int>(keys.size());
+    keys.push_back(key);
+    slots[slot] = value;
+    // Keep the load factor at or below 1/2
+    if (keys.size() * 2 > slots.size())
+      grow();
+    return value;
+  }
+
+private:
+  static constexpr unsigned int EMPTY = ~0u;
+
+  // Exporters mostly reference positions in order, keep neighbouring
+  // positions in neighbouring slots for cache locality. The texcoord and
+  // normal only perturb the slot, corners sharing a position differ in them.
+  static size_t hash(const vertex_index &key) {
+    uint32_t perturb = static_cast<uint32_t>(key.vt_idx) * 0x9E3779B1u ^
+                       static_cast<uint32_t>(key.vn_idx) * 0x85EBCA77u;
+    return static_cast<size_t>(static_cast<uint32_t>(key.v_idx)) * 2 +
+           (perturb >> 29);
+  }
+
+  void grow() {
+    slots.assign(slots.size() * 2, EMPTY);
+    mask = slots.size() - 1;
+    for (size_t i = 0; i < keys.size(); i++)
+      slots[find(keys[i])] = static_cast<unsigned int>(i);
+  }
+
+  std::vector<unsigned int> slots;
+  std::vector<vertex_index> keys;
+  size_t mask;
+};
+
 static unsigned int
-updateVertex(std::map<vertex_index, unsigned int> &vertexCache,
+updateVertex(vertex_table &vertexCache,
              std::vector<float> &positions, std::vector<float> &normals,
              std::vector<float> &texcoords,
              const std::vector<float> &in_positions,
              const std::vector<float> &in_normals,
              const std::vector<float> &in_texcoords, const vertex_index &i) {
-  const std::map<vertex_index, unsigned int>::iterator it = vertexCache.find(i);
+  size_t slot = vertexCache.find(i);
 
-  if (it != vertexCache.end()) {
+  if (!vertexCache.empty(slot)) {
     // found cache
-    return it->second;
+    return vertexCache.value(slot);
   }
 
   assert(in_positions.size() > (unsigned int)(3 * i.v_idx + 2));
@@ -326,10 +518,7 @@ updateVertex(std::map<vertex_index, unsigned int> &vertexCache,
     texcoords.push_back(in_texcoords[2 * i.vt_idx + 1]);
   }
 
-  unsigned int idx = static_cast<unsigned int>(positions.size() / 3 - 1);
-  vertexCache[i] = idx;
-
-  return idx;
+  return vertexCache.insert(slot, i);
 }
 
 void InitMaterial(material_t &material) {
@@ -355,56 +544,443 @@ void InitMaterial(material_t &material) {
   material.unknown_parameter.clear();
 }
 
-static bool exportFaceGroupToShape(
-    shape_t &shape, std::map<vertex_index, unsigned int> vertexCache,
-    const std::vector<float> &in_positions,
-    const std::vector<float> &in_normals,
-    const std::vector<float> &in_texcoords,
-    const std::vector<std::vector<vertex_index>> &faceGroup,
-    const int material_id, const std::string &name, bool clearCache) {
-  if (faceGroup.empty()) {
-    return false;
+// Faces of an .obj file or of one chunk of it, face i spans
+// vertices[offsets[i]] .. vertices[offsets[i + 1]].
+struct face_list {
+  std::vector<vertex_index> vertices;
+  std::vector<unsigned char> relative; // RELATIVE_* flags per face vertex
+  std::vector<size_t> offsets = std::vector<size_t>(1, 0);
+
+  size_t size() const { return offsets.size() - 1; }
+};
+
+// Commands which split faces into shapes, kept in file order.
+enum command_type { COMMAND_USEMTL, COMMAND_MTLLIB, COMMAND_GROUP, COMMAND_OBJECT };
+
+struct obj_command {
+  command_type type;
+  size_t face; // number of faces of the chunk preceding the command
+  std::string name;
+};
+
+// Tokenized records of a contiguous range of lines.
+struct obj_chunk {
+  std::vector<float> v;
+  std::vector<float> vn;
+  std::vector<float> vt;
+  face_list faces;
+  std::vector<obj_command> commands;
+};
+
+// Faces of one output shape, possibly spread over several chunks.
+struct shape_job {
+  struct segment {
+    const obj_chunk *chunk;
+    size_t begin, end;
+  };
+  std::vector<segment> segments;
+  int material_id;
+  std::string name;
+};
+
+static std::string scanName(const char *token) {
+  char namebuf[TINYOBJ_SSCANF_BUFFER_SIZE];
+  namebuf[0] = '\0';
+#ifdef _MSC_VER
+  sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
+#else
+  sscanf(token, "%s", namebuf);
+#endif
+  return std::string(namebuf);
+}
+
+// Count v/vn/vt/f records of a memory range and reserve the chunk arrays,
+// much cheaper than letting them grow while parsing.
+static void reserveRecords(const char *line, const char *end,
+                           obj_chunk &chunk) {
+  size_t v = 0, vn = 0, vt = 0, f = 0;
+  while (line < end) {
+    while (line < end && isSpace(*line))
+      line++;
+    if (end - line > 2 && line[0] == 'v') {
+      if (isSpace(line[1]))
+        v++;
+      else if (line[1] == 'n' && isSpace(line[2]))
+        vn++;
+      else if (line[1] == 't' && isSpace(line[2]))
+        vt++;
+    } else if (end - line > 1 && line[0] == 'f' && isSpace(line[1])) {
+      f++;
+    }
+    const void *newline = memchr(line, '\n', end - line);
+    line = newline ? static_cast<const char *>(newline) + 1 : end;
   }
 
-  // Flatten vertices and indices
-  for (size_t i = 0; i < faceGroup.size(); i++) {
-    const std::vector<vertex_index> &face = faceGroup[i];
+  chunk.v.reserve(v * 3);
+  chunk.vn.reserve(vn * 3);
+  chunk.vt.reserve(vt * 2);
+  // Most faces are triangles or quads
+  chunk.faces.offsets.reserve(f + 1);
+  chunk.faces.vertices.reserve(f * 4);
+  chunk.faces.relative.reserve(f * 4);
+}
 
-    vertex_index i0 = face[0];
-    vertex_index i1(-1);
-    vertex_index i2 = face[1];
+// Find the terminating '\n' or NUL of a line.
+static inline const char *skipLine(const char *token) {
+  while (*token != '\n' && *token != '\0')
+    token++;
+  return token;
+}
 
-    size_t npolys = face.size();
+static void parseObjCommand(const char *token, obj_chunk &chunk);
+
+// Tokenize a single line ending with '\n' or NUL, vertex and face records are
+// parsed in place.
+static void parseObjLine(const char *token, obj_chunk &chunk) {
+  // Skip leading space.
+  token = skipSpace(token);
+
+  assert(token);
+  if (token[0] == '\0' || token[0] == '\n')
+    return; // empty line
+
+  if (token[0] == '#')
+    return; // comment line
+
+  // vertex
+  if (token[0] == 'v' && isSpace((token[1]))) {
+    token += 2;
+    float x, y, z;
+    parseFloat3(x, y, z, token);
+    chunk.v.push_back(x);
+    chunk.v.push_back(y);
+    chunk.v.push_back(z);
+    return;
+  }
 
-    // Polygon -> face fan conversion
-    for (size_t k = 2; k < npolys; k++) {
-      i1 = i2;
-      i2 = face[k];
+  // normal
+  if (token[0] == 'v' && token[1] == 'n' && isSpace((token[2]))) {
+    token += 3;
+    float x, y, z;
+    parseFloat3(x, y, z, token);
+    chunk.vn.push_back(x);
+    chunk.vn.push_back(y);
+    chunk.vn.push_back(z);
+    return;
+  }
+
+  // texcoord
+  if (token[0] == 'v' && token[1] == 't' && isSpace((token[2]))) {
+    token += 3;
+    float x, y;
+    parseFloat2(x, y, token);
+    chunk.vt.push_back(x);
+    chunk.vt.push_back(y);
+    return;
+  }
+
+  // face
+  if (token[0] == 'f' && isSpace((token[1]))) {
+    token += 2;
+    token = skipSpace(token);
+
+    face_list &faces = chunk.faces;
+    while (!isNewLine(token[0])) {
+      unsigned char relative;
+      vertex_index vi = parseTriple(token, static_cast<int>(chunk.v.size() / 3),
+                                    static_cast<int>(chunk.vn.size() / 3),
+                                    static_cast<int>(chunk.vt.size() / 2),
+                                    relative);
+      faces.vertices.push_back(vi);
+      faces.relative.push_back(relative);
+      token = skipSpaceCR(token);
+    }
+    faces.offsets.push_back(faces.vertices.size());
+    return;
+  }
+
+  // Commands are rare, give them a NUL terminated copy of the line
+  if (token[0] == 'u' || token[0] == 'm' || token[0] == 'g' ||
+      token[0] == 'o') {
+    std::string linebuf(token, skipLine(token));
+    if (!linebuf.empty() && linebuf[linebuf.size() - 1] == '\r')
+      linebuf.erase(linebuf.size() - 1);
+    parseObjCommand(linebuf.c_str(), chunk);
+  }
 
-      unsigned int v0 = updateVertex(
-          vertexCache, shape.mesh.positions, shape.mesh.normals,
-          shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i0);
-      unsigned int v1 = updateVertex(
-          vertexCache, shape.mesh.positions, shape.mesh.normals,
-          shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i1);
-      unsigned int v2 = updateVertex(
-          vertexCache, shape.mesh.positions, shape.mesh.normals,
-          shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i2);
+  // Ignore unknown command.
+}
+
+// Tokenize a NUL terminated usemtl, mtllib, g or o line.
+static void parseObjCommand(const char *token, obj_chunk &chunk) {
+  obj_command command;
+  command.face = chunk.faces.size();
+
+  // use mtl
+  if ((0 == strncmp(token, "usemtl", 6)) && isSpace((token[6]))) {
+    command.type = COMMAND_USEMTL;
+    command.name = scanName(token + 7);
+    chunk.commands.push_back(command);
+    return;
+  }
 
-      shape.mesh.indices.push_back(v0);
-      shape.mesh.indices.push_back(v1);
-      shape.mesh.indices.push_back(v2);
+  // load mtl
+  if ((0 == strncmp(token, "mtllib", 6)) && isSpace((token[6]))) {
+    command.type = COMMAND_MTLLIB;
+    command.name = scanName(token + 7);
+    chunk.commands.push_back(command);
+    return;
+  }
 
-      shape.mesh.material_ids.push_back(material_id);
+  // group name
+  if (token[0] == 'g' && isSpace((token[1]))) {
+    std::vector<std::string> names;
+    while (!isNewLine(token[0])) {
+      std::string str = parseString(token);
+      names.push_back(str);
+      token = skipSpaceCR(token); // skip tag
     }
+
+    assert(names.size() > 0);
+
+    // names[0] must be 'g', so skip the 0th element.
+    command.type = COMMAND_GROUP;
+    command.name = names.size() > 1 ? names[1] : "";
+    chunk.commands.push_back(command);
+    return;
   }
 
-  shape.name = name;
+  // object name
+  if (token[0] == 'o' && isSpace((token[1]))) {
+    // @todo { multiple object name? }
+    command.type = COMMAND_OBJECT;
+    command.name = scanName(token + 2);
+    chunk.commands.push_back(command);
+    return;
+  }
+}
 
-  if (clearCache)
-    vertexCache.clear();
+// Walk the commands of all chunks in file order and split faces into shapes
+// exactly like the original single pass loader did.
+static std::string buildShapeJobs(const std::vector<obj_chunk> &chunks,
+                                  std::vector<material_t> &materials,
+                                  MaterialReader &readMatFn,
+                                  std::vector<shape_job> &jobs) {
+  std::map<std::string, int> material_map;
+  int material = -1;
+  std::string name;
+  std::vector<shape_job::segment> faceGroup;
+
+  auto flush = [&]() {
+    if (!faceGroup.empty()) {
+      shape_job job;
+      job.segments.swap(faceGroup);
+      job.material_id = material;
+      job.name = name;
+      jobs.push_back(job);
+    }
+    faceGroup.clear();
+  };
+  auto addFaces = [&](const obj_chunk &chunk, size_t begin, size_t end) {
+    if (end > begin)
+      faceGroup.push_back({&chunk, begin, end});
+  };
+
+  for (const obj_chunk &chunk : chunks) {
+    size_t cursor = 0;
+    for (const obj_command &command : chunk.commands) {
+      addFaces(chunk, cursor, command.face);
+      cursor = command.face;
+
+      switch (command.type) {
+      case COMMAND_USEMTL:
+        // Create face group per material.
+        flush();
+        if (material_map.find(command.name) != material_map.end()) {
+          material = material_map[command.name];
+        } else {
+          // { error!! material not found }
+          material = -1;
+        }
+        break;
+      case COMMAND_MTLLIB: {
+        std::string err_mtl = readMatFn(command.name, materials, material_map);
+        if (!err_mtl.empty()) {
+          faceGroup.clear(); // for safety
+          return err_mtl;
+        }
+        break;
+      }
+      case COMMAND_GROUP:
+      case COMMAND_OBJECT:
+        // flush previous face group.
+        flush();
+        name = command.name;
+        break;
+      }
+    }
+    addFaces(chunk, cursor, chunk.faces.size());
+  }
+  flush();
 
-  return true;
+  return std::string();
+}
+
+static void exportShape(shape_t &shape, const shape_job &job,
+                        const std::vector<float> &in_positions,
+                        const std::vector<float> &in_normals,
+                        const std::vector<float> &in_texcoords) {
+  // Count corners and triangles to size the outputs up front, a shape can
+  // not have more distinct vertices than corners or positions in the file
+  size_t corners = 0, triangles = 0;
+  for (const shape_job::segment &segment : job.segments) {
+    const face_list &faces = segment.chunk->faces;
+    for (size_t f = segment.begin; f < segment.end; f++) {
+      size_t npolys = faces.offsets[f + 1] - faces.offsets[f];
+      if (npolys < 3)
+        continue;
+      corners += npolys;
+      triangles += npolys - 2;
+    }
+  }
+  size_t vertices = std::min(corners, in_positions.size() / 3);
+
+  vertex_table vertexCache(vertices);
+  shape.mesh.positions.reserve(vertices * 3);
+  if (!in_normals.empty())
+    shape.mesh.normals.reserve(vertices * 3);
+  if (!in_texcoords.empty())
+    shape.mesh.texcoords.reserve(vertices * 2);
+  shape.mesh.indices.reserve(triangles * 3);
+  shape.mesh.material_ids.reserve(triangles);
+
+  // Flatten vertices and indices
+  for (const shape_job::segment &segment : job.segments) {
+    const face_list &faces = segment.chunk->faces;
+    for (size_t f = segment.begin; f < segment.end; f++) {
+      const vertex_index *face = &faces.vertices[faces.offsets[f]];
+      size_t npolys = faces.offsets[f + 1] - faces.offsets[f];
+      if (npolys < 3)
+        continue;
+
+      vertex_index i0 = face[0];
+      vertex_index i1(-1);
+      vertex_index i2 = face[1];
+
+      // Polygon -> face fan conversion
+      for (size_t k = 2; k < npolys; k++) {
+        i1 = i2;
+        i2 = face[k];
+
+        unsigned int v0 = updateVertex(
+            vertexCache, shape.mesh.positions, shape.mesh.normals,
+            shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i0);
+        unsigned int v1 = updateVertex(
+            vertexCache, shape.mesh.positions, shape.mesh.normals,
+            shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i1);
+        unsigned int v2 = updateVertex(
+            vertexCache, shape.mesh.positions, shape.mesh.normals,
+            shape.mesh.texcoords, in_positions, in_normals, in_texcoords, i2);
+
+        shape.mesh.indices.push_back(v0);
+        shape.mesh.indices.push_back(v1);
+        shape.mesh.indices.push_back(v2);
+
+        shape.mesh.material_ids.push_back(job.material_id);
+      }
+    }
+  }
+
+  shape.name = job.name;
+}
+
+// Run fn(0) .. fn(count - 1) on up to 'threads' threads including the caller.
+template <typename F>
+static void parallelFor(size_t count, unsigned int threads, const F &fn) {
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t i = next++; i < count; i = next++)
+      fn(i);
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int t = 1; t < threads && t < count; t++)
+    workers.emplace_back(work);
+  work();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+// Merge tokenized chunks, build shapes and export them.
+static std::string buildShapes(std::vector<shape_t> &shapes,
+                               std::vector<material_t> &materials,
+                               std::vector<obj_chunk> &chunks,
+                               MaterialReader &readMatFn,
+                               unsigned int threads) {
+  std::vector<float> v;
+  std::vector<float> vn;
+  std::vector<float> vt;
+
+  if (chunks.size() == 1) {
+    v.swap(chunks[0].v);
+    vn.swap(chunks[0].vn);
+    vt.swap(chunks[0].vt);
+  } else {
+    // Rebase relative indices to the attribute counts preceding each chunk
+    std::vector<int> vBase(chunks.size()), vnBase(chunks.size()),
+        vtBase(chunks.size());
+    size_t vSize = 0, vnSize = 0, vtSize = 0;
+    for (size_t c = 0; c < chunks.size(); c++) {
+      vBase[c] = static_cast<int>(vSize / 3);
+      vnBase[c] = static_cast<int>(vnSize / 3);
+      vtBase[c] = static_cast<int>(vtSize / 2);
+      vSize += chunks[c].v.size();
+      vnSize += chunks[c].vn.size();
+      vtSize += chunks[c].vt.size();
+    }
+    v.reserve(vSize);
+    vn.reserve(vnSize);
+    vt.reserve(vtSize);
+    for (obj_chunk &chunk : chunks) {
+      v.insert(v.end(), chunk.v.begin(), chunk.v.end());
+      vn.insert(vn.end(), chunk.vn.begin(), chunk.vn.end());
+      vt.insert(vt.end(), chunk.vt.begin(), chunk.vt.end());
+      std::vector<float>().swap(chunk.v);
+      std::vector<float>().swap(chunk.vn);
+      std::vector<float>().swap(chunk.vt);
+    }
+
+    parallelFor(chunks.size(), threads, [&](size_t c) {
+      face_list &faces = chunks[c].faces;
+      for (size_t i = 0; i < faces.vertices.size(); i++) {
+        unsigned char relative = faces.relative[i];
+        if (!relative)
+          continue;
+        vertex_index &vi = faces.vertices[i];
+        if (relative & RELATIVE_V)
+          vi.v_idx += vBase[c];
+        if (relative & RELATIVE_VT)
+          vi.vt_idx += vtBase[c];
+        if (relative & RELATIVE_VN)
+          vi.vn_idx += vnBase[c];
+      }
+    });
+  }
+
+  std::vector<shape_job> jobs;
+  std::string err = buildShapeJobs(chunks, materials, readMatFn, jobs);
+
+  // Shapes are independent, export them in parallel keeping file order
+  std::vector<shape_t> exported(jobs.size());
+  parallelFor(jobs.size(), threads, [&](size_t i) {
+    exportShape(exported[i], jobs[i], v, vn, vt);
+  });
+  size_t first = shapes.size();
+  shapes.resize(first + exported.size());
+  for (size_t i = 0; i < exported.size(); i++)
+    std::swap(shapes[first + i], exported[i]);
+
+  return err;
 }
 
 std::string LoadMtl(std::map<std::string, int> &material_map,
@@ -687,20 +1263,7 @@ std::string LoadObj(std::vector<shape_t> &shapes,
 std::string LoadObj(std::vector<shape_t> &shapes,
                     std::vector<material_t> &materials, // [output]
                     std::istream &inStream, MaterialReader &readMatFn) {
-  std::stringstream err;
-
-  std::vector<float> v;
-  std::vector<float> vn;
-  std::vector<float> vt;
-  std::vector<std::vector<vertex_index>> faceGroup;
-  std::string name;
-
-  // material
-  std::map<std::string, int> material_map;
-  std::map<vertex_index, unsigned int> vertexCache;
-  int material = -1;
-
-  shape_t shape;
+  std::vector<obj_chunk> chunks(1);
 
   int maxchars = 8192;             // Alloc enough size.
   std::vector<char> buf((unsigned long) maxchars); // Alloc enough size.
@@ -724,189 +1287,78 @@ std::string LoadObj(std::vector<shape_t> &shapes,
       continue;
     }
 
-    // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
-
-    assert(token);
-    if (token[0] == '\0')
-      continue; // empty line
-
-    if (token[0] == '#')
-      continue; // comment line
-
-    // vertex
-    if (token[0] == 'v' && isSpace((token[1]))) {
-      token += 2;
-      float x, y, z;
-      parseFloat3(x, y, z, token);
-      v.push_back(x);
-      v.push_back(y);
-      v.push_back(z);
-      continue;
-    }
-
-    // normal
-    if (token[0] == 'v' && token[1] == 'n' && isSpace((token[2]))) {
-      token += 3;
-      float x, y, z;
-      parseFloat3(x, y, z, token);
-      vn.push_back(x);
-      vn.push_back(y);
-      vn.push_back(z);
-      continue;
-    }
-
-    // texcoord
-    if (token[0] == 'v' && token[1] == 't' && isSpace((token[2]))) {
-      token += 3;
-      float x, y;
-      parseFloat2(x, y, token);
-      vt.push_back(x);
-      vt.push_back(y);
-      continue;
-    }
-
-    // face
-    if (token[0] == 'f' && isSpace((token[1]))) {
-      token += 2;
-      token += strspn(token, " \t");
-
-      std::vector<vertex_index> face;
-      while (!isNewLine(token[0])) {
-        vertex_index vi = parseTriple(token, static_cast<int>(v.size() / 3),
-                                      static_cast<int>(vn.size() / 3),
-                                      static_cast<int>(vt.size() / 2));
-        face.push_back(vi);
-        size_t n = strspn(token, " \t\r");
-        token += n;
-      }
-
-      faceGroup.push_back(face);
-
-      continue;
-    }
-
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6)) && isSpace((token[6]))) {
-
-      char namebuf[TINYOBJ_SSCANF_BUFFER_SIZE];
-      token += 7;
-#ifdef _MSC_VER
-      sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
-#else
-      sscanf(token, "%s", namebuf);
-#endif
-
-      // Create face group per material.
-      bool ret = exportFaceGroupToShape(shape, vertexCache, v, vn, vt,
-                                        faceGroup, material, name, true);
-      if (ret) {
-        shapes.push_back(shape);
-      }
-      shape = shape_t();
-      faceGroup.clear();
-
-      if (material_map.find(namebuf) != material_map.end()) {
-        material = material_map[namebuf];
-      } else {
-        // { error!! material not found }
-        material = -1;
-      }
-
-      continue;
-    }
-
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && isSpace((token[6]))) {
-      char namebuf[TINYOBJ_SSCANF_BUFFER_SIZE];
-      token += 7;
-#ifdef _MSC_VER
-      sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
-#else
-      sscanf(token, "%s", namebuf);
-#endif
-
-      std::string err_mtl = readMatFn(namebuf, materials, material_map);
-      if (!err_mtl.empty()) {
-        faceGroup.clear(); // for safety
-        return err_mtl;
-      }
-
-      continue;
-    }
+    parseObjLine(linebuf.c_str(), chunks[0]);
+  }
 
-    // group name
-    if (token[0] == 'g' && isSpace((token[1]))) {
+  return buildShapes(shapes, materials, chunks, readMatFn, 1);
+}
 
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(shape, vertexCache, v, vn, vt,
-                                        faceGroup, material, name, true);
-      if (ret) {
-        shapes.push_back(shape);
-      }
+std::string LoadObjParallel(std::vector<shape_t> &shapes,
+                            std::vector<material_t> &materials, // [output]
+                            const char *filename, const char *mtl_basepath,
+                            unsigned int threads) {
+  shapes.clear();
 
-      shape = shape_t();
+  std::stringstream err;
 
-      // material = -1;
-      faceGroup.clear();
+  std::unique_ptr<ppgso::MappedFile> file;
+  try {
+    file.reset(new ppgso::MappedFile(filename));
+  } catch (std::exception &) {
+    err << "Cannot open file [" << filename << "]" << std::endl;
+    return err.str();
+  }
 
-      std::vector<std::string> names;
-      while (!isNewLine(token[0])) {
-        std::string str = parseString(token);
-        names.push_back(str);
-        token += strspn(token, " \t\r"); // skip tag
-      }
+  std::string basePath;
+  if (mtl_basepath) {
+    basePath = mtl_basepath;
+  }
+  MaterialFileReader matFileReader(basePath);
 
-      assert(names.size() > 0);
+  const char *data = reinterpret_cast<const char *>(file->data());
+  size_t size = file->size();
+
+  // Small files are not worth the thread start up
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t chunkCount = std::min<size_t>(threads, size / TINYOBJ_MIN_CHUNK_SIZE);
+  if (chunkCount == 0)
+    chunkCount = 1;
+
+  // Split at line boundaries
+  std::vector<size_t> bounds(chunkCount + 1, size);
+  bounds[0] = 0;
+  for (size_t c = 1; c < chunkCount; c++) {
+    size_t at = std::max(bounds[c - 1], size * c / chunkCount);
+    const void *newline = at < size ? memchr(data + at, '\n', size - at) : nullptr;
+    bounds[c] = newline ? static_cast<const char *>(newline) - data + 1 : size;
+  }
 
-      // names[0] must be 'g', so skip the 0th element.
-      if (names.size() > 1) {
-        name = names[1];
+  std::vector<obj_chunk> chunks(chunkCount);
+  parallelFor(chunkCount, threads, [&](size_t c) {
+    std::string linebuf;
+    const char *line = data + bounds[c];
+    const char *end = data + bounds[c + 1];
+    reserveRecords(line, end, chunks[c]);
+    while (line < end) {
+      const char *newline =
+          static_cast<const char *>(memchr(line, '\n', end - line));
+      const char *lineEnd = newline ? newline : end;
+
+      // Lines are parsed in place, only the last line of a file without a
+      // trailing newline needs a NUL terminated copy
+      if (newline) {
+        parseObjLine(line, chunks[c]);
       } else {
-        name = "";
+        linebuf.assign(line, lineEnd);
+        parseObjLine(linebuf.c_str(), chunks[c]);
       }
 
-      continue;
+      line = lineEnd + 1;
     }
+  });
 
-    // object name
-    if (token[0] == 'o' && isSpace((token[1]))) {
-
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(shape, vertexCache, v, vn, vt,
-                                        faceGroup, material, name, true);
-      if (ret) {
-        shapes.push_back(shape);
-      }
-
-      // material = -1;
-      faceGroup.clear();
-      shape = shape_t();
-
-      // @todo { multiple object name? }
-      char namebuf[TINYOBJ_SSCANF_BUFFER_SIZE];
-      token += 2;
-#ifdef _MSC_VER
-      sscanf_s(token, "%s", namebuf, (unsigned)_countof(namebuf));
-#else
-      sscanf(token, "%s", namebuf);
-#endif
-      name = std::string(namebuf);
-
-      continue;
-    }
-
-    // Ignore unknown command.
-  }
-
-  bool ret = exportFaceGroupToShape(shape, vertexCache, v, vn, vt, faceGroup,
-                                    material, name, true);
-  if (ret) {
-    shapes.push_back(shape);
-  }
-  faceGroup.clear(); // for safety
-
-  return err.str();
+  return buildShapes(shapes, materials, chunks, matFileReader,
+                     static_cast<unsigned int>(threads));
 }
 }
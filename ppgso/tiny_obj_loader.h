@@ -88,6 +88,17 @@ std::string LoadObj(std::vector<shape_t> &shapes,       // [output]
                     std::vector<material_t> &materials, // [output]
                     std::istream &inStream, MaterialReader &readMatFn);
 
+/// Loads .obj from a memory mapped file, splitting it at line boundaries
+/// into chunks tokenized on separate threads. Produces the same shapes and
+/// materials as LoadObj(filename).
+/// 'threads' is the maximum number of threads, 0 uses one per hardware
+/// thread. Files smaller than a chunk are parsed on the calling thread.
+std::string LoadObjParallel(std::vector<shape_t> &shapes,       // [output]
+                            std::vector<material_t> &materials, // [output]
+                            const char *filename,
+                            const char *mtl_basepath = nullptr,
+                            unsigned int threads = 0);
+
 /// Loads materials into std::map
 /// Returns an empty string if successful
 std::string LoadMtl(std::map<std::string, int> &material_map,
@@ -0,0 +1,35 @@
+#include <stdexcept>
+
+#include "uniform_buffer.h"
+
+namespace ppgso {
+
+  UniformBuffer::UniformBuffer(size_t bytes, GLuint binding) : binding{binding}, bytes{(bytes + 15) & ~(size_t) 15} {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) this->bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    memory = {MemoryTracker::Category::Buffer, "UniformBuffer", this->bytes};
+  }
+
+  UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &buffer);
+  }
+
+  void UniformBuffer::update(const void *data, size_t bytes) {
+    if (bytes > this->bytes) throw std::runtime_error("Uniform buffer data exceeds its capacity");
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr) this->bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr) bytes, data);
+    // Cheap to repeat, keeps the binding point ours even if other code attached a buffer in between
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+  }
+
+  GLuint UniformBuffer::getBinding() const {
+    return binding;
+  }
+
+  size_t UniformBuffer::getBytes() const {
+    return bytes;
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "memory_tracker.h"
+
+namespace ppgso {
+
+  /*!
+   * Uniform buffer object attached to a fixed binding point, for std140 uniform blocks shared by several programs.
+   *
+   * Data which changes once per frame, such as lights, is uploaded once with update() instead of once per draw
+   * into every program. Programs connect their block to the binding point with Shader::setUniformBlock().
+   * All calls must come from the thread owning the OpenGL context.
+   */
+  class UniformBuffer {
+  public:
+    /*!
+     * Allocate the buffer and attach it to a binding point.
+     *
+     * @param bytes - Capacity in bytes, rounded up to a multiple of 16 as std140 blocks are.
+     * @param binding - Uniform buffer binding point to attach to.
+     */
+    UniformBuffer(size_t bytes, GLuint binding);
+    UniformBuffer(const UniformBuffer &) = delete;
+    UniformBuffer &operator=(const UniformBuffer &) = delete;
+    ~UniformBuffer();
+
+    /*!
+     * Replace the start of the buffer, bytes past the data keep undefined values.
+     * The previous storage is orphaned, so draws still reading it do not stall the upload.
+     *
+     * @param data - std140 laid out data to upload.
+     * @param bytes - Size of the data, at most the capacity.
+     */
+    void update(const void *data, size_t bytes);
+
+    /*!
+     * Get binding point the buffer is attached to.
+     *
+     * @return - Binding point index.
+     */
+    GLuint getBinding() const;
+
+    /*!
+     * Get capacity of the buffer.
+     *
+     * @return - Size in bytes.
+     */
+    size_t getBytes() const;
+
+  private:
+    GLuint buffer;
+    GLuint binding;
+    size_t bytes;
+    MemoryTracker::Allocation memory;
+  };
+}
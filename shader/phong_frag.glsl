@@ -9,6 +9,9 @@ out vec4 FragColor;
 
 // Используем то же имя, что и в C++: shader->setUniform("Texture", *texture)
 uniform sampler2D Texture;
+// Текстуры одинакового размера лежат в слоях общего массива, TextureLayer < 0 - берём Texture
+uniform sampler2DArray TextureArray;
+uniform int TextureLayer;
 uniform sampler2D shadowMap0;
 uniform sampler2D shadowMap1;
 uniform sampler2D shadowMap2;
@@ -22,26 +25,24 @@ struct Material {
 };
 uniform Material material;
 
+// Поля упакованы по 16 байт для std140, порядок совпадает с LightData в scene.cpp
 struct Light {
-    int type; // 0 - directional, 1 - point, 2 - spot/reflector
     vec3 position;
+    int type; // 0 - directional, 1 - point, 2 - spot/reflector
     vec3 direction;
+    float cutOff;
     vec3 color;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    float outerCutOff;
     float constant;
     float linear;
     float quadratic;
     float maxDist;
-    float cutOff;
-    float outerCutOff;
 };
 
 const int LIGHT_DIRECTIONAL = 0;
 const int LIGHT_POINT       = 1;
 const int LIGHT_SPOT        = 2;
-const int MAX_LIGHTS        = 10;
+const int MAX_LIGHTS        = 255; // 16 KB блок Lights, минимальный GL_MAX_UNIFORM_BLOCK_SIZE
 const int MAX_SHADOW_MAPS   = 4;
 const int MAX_POINT_SHADOW_MAPS = 2;
 const float SPOT_EPSILON    = 0.0001;
@@ -66,15 +67,25 @@ const vec3 POINT_PCF_OFFSETS[POINT_PCF_SAMPLES] = vec3[](
 );
 
 uniform samplerCube pointShadowMaps[MAX_POINT_SHADOW_MAPS];
-uniform int numberOfLights;
-uniform int numShadowMaps;
-uniform int shadowCasterIndices[4]; // Maps shadow map index to light index
-uniform int numPointShadowMaps;
-uniform int pointShadowCasterIndices[2];
-uniform float pointShadowFarPlane[2];
-uniform Light lights[MAX_LIGHTS];
-
-uniform vec3 viewPos;
+// Источники света и камера, общий для всех phong-шейдеров std140 блок, Scene заливает его один раз за кадр
+layout(std140) uniform Lights {
+    vec3 viewPos;
+    int numberOfLights;
+    vec4 lightAmbient;  // Интенсивности общие для всех источников, w не используется
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    Light lights[MAX_LIGHTS];
+};
+// Общий для всех phong-шейдеров std140 блок, Scene заливает его один раз за кадр
+layout(std140) uniform Shadows {
+    mat4 lightSpaceMatrix[4];
+    ivec4 shadowCasterIndices;      // Maps shadow map index to light index
+    ivec4 pointShadowCasterIndices; // xy
+    vec4 pointShadowFarPlane;       // xy
+    int numShadowMaps;
+    int numPointShadowMaps;
+};
+
 uniform float Transparency;
 
 // ============ ФУНКЦИЯ ТЕНИ ============
@@ -176,16 +187,16 @@ vec3 applyLight(int lightIndex, in Light light, in vec3 norm, in vec3 viewDir, i
 
     float ndotl = dot(norm, lightDir);
     float facing = max(ndotl, 0.0);
-    vec3 diffuse = light.diffuse * facing * material.diffuse * texColor;
+    vec3 diffuse = lightDiffuse.rgb * facing * material.diffuse * texColor;
 
     vec3 halfwayDir = normalize(lightDir + viewDir);
     float specAngle = max(dot(norm, halfwayDir), 0.0);
     float spec = pow(specAngle, material.shininess);
     // Avoid specular highlights on back-facing fragments
     spec *= step(SPECULAR_EPSILON, facing);
-    vec3 specular = light.specular * spec * material.specular;
+    vec3 specular = lightSpecular.rgb * spec * material.specular;
 
-    vec3 ambient = light.ambient * material.ambient * texColor;
+    vec3 ambient = lightAmbient.rgb * material.ambient * texColor;
 
     if (light.type == LIGHT_SPOT) {
         vec3 spotDir = normalize(light.direction);
@@ -207,7 +218,7 @@ vec3 applyLight(int lightIndex, in Light light, in vec3 norm, in vec3 viewDir, i
 // ============ MAIN ============
 void main()
 {
-    vec4 texColor = texture(Texture, TexCoords);
+    vec4 texColor = TextureLayer >= 0 ? texture(TextureArray, vec3(TexCoords, TextureLayer)) : texture(Texture, TexCoords);
     if (texColor.a < 0.01)
         discard;
 
@@ -3,6 +3,10 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 2) in vec3 aNormal;
 layout(location = 1) in vec2 aTexCoord;
+// Dequantization of compact meshes, set per mesh by ppgso::MeshBase::render (identity for float meshes)
+layout(location = 3) in vec4 aPositionOffset;    // w = 1 when aNormal.xy is octahedral encoded
+layout(location = 4) in vec4 aPositionScale;
+layout(location = 5) in vec4 aTexCoordTransform;
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -12,17 +16,35 @@ out vec4 FragPosLightSpace[4];
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
-uniform mat4 lightSpaceMatrix[4];
-uniform int numShadowMaps;
+// Общий для всех phong-шейдеров std140 блок, Scene заливает его один раз за кадр
+layout(std140) uniform Shadows {
+    mat4 lightSpaceMatrix[4];
+    ivec4 shadowCasterIndices;      // Maps shadow map index to light index
+    ivec4 pointShadowCasterIndices; // xy
+    vec4 pointShadowFarPlane;       // xy
+    int numShadowMaps;
+    int numPointShadowMaps;
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec3 position = aPos * aPositionScale.xyz + aPositionOffset.xyz;
+    vec3 normal = aPositionOffset.w > 0.5 ? decodeOctahedral(aNormal.xy) : aNormal;
+    vec2 texCoord = aTexCoordTransform.xy + aTexCoord * aTexCoordTransform.zw;
+
+    vec4 worldPos = model * vec4(position, 1.0);
     FragPos = worldPos.xyz;
 
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(model))) * normal;
     // Инвертируем V-координату для корректного отображения текстуры (оставьте или уберите ниже по результатам теста)
-    TexCoords = vec2(aTexCoord.x, 1.0 - aTexCoord.y);
+    TexCoords = vec2(texCoord.x, 1.0 - texCoord.y);
 
     // Compute light space positions for all shadow-casting lights
     for (int i = 0; i < 4; ++i) {
@@ -1,5 +1,8 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+// Dequantization of compact meshes, set per mesh by ppgso::MeshBase::render (identity for float meshes)
+layout (location = 3) in vec4 aPositionOffset;
+layout (location = 4) in vec4 aPositionScale;
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 ModelMatrix;
@@ -7,7 +10,8 @@ out vec3 FragPos;
 
 void main()
 {
-    vec4 worldPos = ModelMatrix * vec4(aPos, 1.0);
+    vec3 position = aPos * aPositionScale.xyz + aPositionOffset.xyz;
+    vec4 worldPos = ModelMatrix * vec4(position, 1.0);
     FragPos = worldPos.xyz;
     gl_Position = lightSpaceMatrix * worldPos;
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+// Offline asset baker, converts the loose data directories into a single asset pack for the playground.
+//
+// Usage: ppgso_bake [--compress] [--bc] <data directory> <pack> [subdirectories...]
+//   Meshes (.obj) go through the full import pipeline, images (.bmp) become textures with their full mip chain,
+//   RGB8 or block compressed with --bc (BC5 for normal maps, BC1 otherwise), material libraries (.mtl) are stored as
+//   they are. Asset names are the paths relative to the data directory with forward slashes, e.g.
+//   "Collection/chairs/chair.obj".
+//   Subdirectories default to Collection, objects, tex and textures.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ppgso.h>
+#include <asset_pack.h>
+#include <image_bc.h>
+#include <image_mips.h>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string lowerExtension(const fs::path &path) {
+  auto extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+  return extension;
+}
+
+static void usage() {
+  std::cout << "Usage: ppgso_bake [--compress] [--bc] <data directory> <pack> [subdirectories...]" << std::endl
+            << "  --compress  LZ4 compress entries in chunks, smaller pack at the cost of load time" << std::endl
+            << "  --bc        Store textures as BC1/BC5 instead of RGB8, 3-6x less VRAM" << std::endl
+            << "  Subdirectories default to Collection, objects, tex and textures" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  bool compress = false, blockCompress = false;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--compress"))
+      compress = true;
+    else if (!strcmp(argv[i], "--bc"))
+      blockCompress = true;
+    else
+      args.emplace_back(argv[i]);
+  }
+  if (args.size() < 2) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  fs::path root = args[0];
+  std::string packPath = args[1];
+  std::vector<std::string> subdirectories(args.begin() + 2, args.end());
+  if (subdirectories.empty()) subdirectories = {"Collection", "objects", "tex", "textures"};
+
+  // Sorted so the pack layout does not depend on directory order
+  std::vector<fs::path> meshes, images, materials;
+  for (auto &subdirectory : subdirectories) {
+    if (!fs::is_directory(root / subdirectory)) {
+      std::cout << "Skipping missing directory " << (root / subdirectory).string() << std::endl;
+      continue;
+    }
+    for (auto &entry : fs::recursive_directory_iterator(root / subdirectory)) {
+      if (!entry.is_regular_file()) continue;
+      auto extension = lowerExtension(entry.path());
+      if (extension == ".obj") meshes.push_back(entry.path());
+      if (extension == ".bmp") images.push_back(entry.path());
+      if (extension == ".mtl") materials.push_back(entry.path());
+    }
+  }
+  std::sort(meshes.begin(), meshes.end());
+  std::sort(images.begin(), images.end());
+  std::sort(materials.begin(), materials.end());
+
+  auto start = Clock::now();
+  ppgso::AssetPackWriter writer{packPath, compress};
+  auto &pool = ppgso::ThreadPool::shared();
+
+  // Import and compression run on the workers, the writer serializes the appends
+  std::vector<std::pair<fs::path, std::future<void>>> jobs;
+  for (auto &path : meshes) {
+    auto name = fs::relative(path, root).generic_string();
+    jobs.emplace_back(path, pool.submit([&writer, path, name]() {
+      writer.addMesh(name, ppgso::Mesh::decode(path.string()));
+    }));
+  }
+  for (auto &path : images) {
+    auto name = fs::relative(path, root).generic_string();
+    jobs.emplace_back(path, pool.submit([&writer, path, name, blockCompress]() {
+      auto image = ppgso::image::loadBMP(path.string());
+      // Levels of a texture are filtered and encoded on the other workers as well, the files are uneven in size
+      if (blockCompress)
+        writer.addTexture(name, ppgso::image::compressBC(image, ppgso::image::blockFormatFor(name)));
+      else
+        writer.addTexture(name, ppgso::image::buildMipChain(image, ppgso::image::isColorTexture(name)));
+    }));
+  }
+  for (auto &path : materials) {
+    auto name = fs::relative(path, root).generic_string();
+    jobs.emplace_back(path, pool.submit([&writer, path, name]() {
+      std::ifstream file(path, std::ios::binary);
+      if (!file.is_open()) throw std::runtime_error("Could not open material library.");
+      std::stringstream source;
+      source << file.rdbuf();
+      writer.addMaterial(name, source.str());
+    }));
+  }
+
+  int failed = 0;
+  for (auto &[path, job] : jobs) {
+    try {
+      job.get();
+    } catch (std::exception &e) {
+      std::cout << "Skipping " << path.string() << ": " << e.what() << std::endl;
+      failed++;
+    }
+  }
+
+  try {
+    writer.finish();
+  } catch (std::exception &e) {
+    std::cout << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto stats = writer.getStats();
+  double mb = 1024.0 * 1024.0;
+  std::cout << std::fixed << std::setprecision(1) << "Baked " << stats.meshes << " meshes, " << stats.images
+            << " images, " << stats.textures << " textures and " << stats.materials << " materials into " << packPath << " on " << pool.size()
+            << " threads in " << secondsSince(start) << " s: " << stats.bytes / mb << " MB of assets stored in " << stats.storedBytes / mb << " MB";
+  if (stats.bytes) std::cout << " (" << 100.0 * stats.storedBytes / stats.bytes << "%)";
+  std::cout << std::endl;
+  // Unsupported files cannot be loaded loose either, the playground skips them the same way
+  if (failed) std::cout << failed << " files could not be baked and are missing from the pack" << std::endl;
+  return EXIT_SUCCESS;
+}
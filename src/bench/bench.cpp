@@ -0,0 +1,896 @@
+// Offline benchmarks for the ppgso asset pipeline, none of them needs a window.
+//
+// Usage: ppgso_bench <mode> [options] <files or directories...>
+//   obj [--threads N] - OBJ parse throughput, LoadObj vs LoadObjParallel
+//   vcache            - Vertex cache ACMR/ATVR before and after optimizeShape
+//   lod               - Triangles submitted at several camera distances with and without LODs
+//   meshlet           - Meshlet sizes and the share culled from viewpoints around every model
+//   arena             - Geometry arena fragmentation while meshes are streamed in and out
+//   pack <data> <pack> - Startup load of the loose data directories against a pack baked by ppgso_bake
+//   bmp               - BMP decode throughput of the mapped loader against reading row by row and plain memcpy
+//   bc [--threads N]  - BC1/BC5 encode throughput on one and N threads, quality (PSNR) and size against RGB8
+//   mips [--threads N] - Mip chain build throughput against a float reference, its error and texture cache loads
+//   ops [--threads N] - CPU image operations on one and N threads, convolution and planar round trip error
+
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+  #include <sys/resource.h>
+#endif
+
+#include <ppgso.h>
+#include <tiny_obj_loader.h>
+#include <mesh_optimize.h>
+#include <mesh_simplify.h>
+#include <meshlet.h>
+#include <range_allocator.h>
+#include <asset_pack.h>
+#include <image_bc.h>
+#include <image_mips.h>
+#include <image_ops.h>
+#include <texture_cache.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Expand directories into the files with the given extension, sorted for stable output
+static std::vector<std::string> collectFiles(const std::vector<std::string> &args, const std::string &extension) {
+  std::vector<std::string> files;
+  for (auto &arg : args) {
+    if (fs::is_directory(arg)) {
+      std::vector<std::string> found;
+      for (auto &entry : fs::directory_iterator(arg))
+        if (entry.is_regular_file() && entry.path().extension() == extension)
+          found.push_back(entry.path().string());
+      std::sort(found.begin(), found.end());
+      files.insert(files.end(), found.begin(), found.end());
+    } else {
+      files.push_back(arg);
+    }
+  }
+  return files;
+}
+
+// Best of a few runs so a cold page cache does not dominate small files
+static double bestOf(int runs, const std::function<void()> &fn) {
+  double best = 1e30;
+  for (int i = 0; i < runs; i++) {
+    auto start = Clock::now();
+    fn();
+    best = std::min(best, secondsSince(start));
+  }
+  return best;
+}
+
+static bool sameShapes(const std::vector<tinyobj::shape_t> &a, const std::vector<tinyobj::shape_t> &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    auto &ma = a[i].mesh, &mb = b[i].mesh;
+    if (a[i].name != b[i].name || ma.positions != mb.positions || ma.normals != mb.normals ||
+        ma.texcoords != mb.texcoords || ma.indices != mb.indices || ma.material_ids != mb.material_ids)
+      return false;
+  }
+  return true;
+}
+
+static int benchObj(const std::vector<std::string> &files, unsigned int threads) {
+  double totalBytes = 0, totalSerial = 0, totalParallel = 0;
+  int mismatches = 0;
+
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto &file : files) {
+    auto base = fs::path(file).parent_path().string() + "/";
+    std::vector<tinyobj::shape_t> serialShapes, parallelShapes;
+    std::vector<tinyobj::material_t> serialMaterials, parallelMaterials;
+    std::string serialErr, parallelErr;
+
+    auto serial = bestOf(3, [&]() {
+      serialMaterials.clear();
+      serialErr = tinyobj::LoadObj(serialShapes, serialMaterials, file.c_str(), base.c_str());
+    });
+    auto parallel = bestOf(3, [&]() {
+      parallelMaterials.clear();
+      parallelErr = tinyobj::LoadObjParallel(parallelShapes, parallelMaterials, file.c_str(), base.c_str(), threads);
+    });
+
+    bool same = serialErr == parallelErr && sameShapes(serialShapes, parallelShapes);
+    if (!same) mismatches++;
+
+    double bytes = (double) fs::file_size(file);
+    totalBytes += bytes;
+    totalSerial += serial;
+    totalParallel += parallel;
+
+    double mb = bytes / (1024.0 * 1024.0);
+    std::cout << fs::path(file).filename().string() << ": " << mb << " MB, "
+              << mb / serial << " MB/s serial, " << mb / parallel << " MB/s parallel"
+              << (same ? "" : " MISMATCH") << std::endl;
+  }
+
+  double mb = totalBytes / (1024.0 * 1024.0);
+  std::cout << "Total " << files.size() << " files, " << mb << " MB: "
+            << mb / totalSerial << " MB/s serial, " << mb / totalParallel << " MB/s parallel, speedup "
+            << std::setprecision(2) << totalSerial / totalParallel << "x" << std::endl;
+  if (mismatches) std::cout << mismatches << " files differ between loaders!" << std::endl;
+  return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int benchVertexCache(const std::vector<std::string> &files) {
+  size_t triangles = 0;
+  double missesBefore = 0, missesAfter = 0, verticesBefore = 0, verticesAfter = 0, seconds = 0;
+
+  std::cout << std::fixed << std::setprecision(3);
+  for (auto &file : files) {
+    auto base = fs::path(file).parent_path().string() + "/";
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    auto err = tinyobj::LoadObj(shapes, materials, file.c_str(), base.c_str());
+    if (!err.empty()) {
+      std::cout << fs::path(file).filename().string() << ": " << err << std::endl;
+      continue;
+    }
+
+    for (auto &obj : shapes) {
+      ppgso::MeshShape shape;
+      shape.positions = obj.mesh.positions;
+      shape.texcoords = obj.mesh.texcoords;
+      shape.normals = obj.mesh.normals;
+      shape.indices = obj.mesh.indices;
+      size_t count = shape.indices.size() / 3;
+      if (!count) continue;
+
+      auto before = ppgso::analyzeVertexCache(shape.indices, shape.positions.size() / 3);
+      auto start = Clock::now();
+      ppgso::optimizeShape(shape);
+      seconds += secondsSince(start);
+      auto after = ppgso::analyzeVertexCache(shape.indices, shape.positions.size() / 3);
+
+      triangles += count;
+      missesBefore += before.acmr * count;
+      missesAfter += after.acmr * count;
+      verticesBefore += before.acmr * count / before.atvr;
+      verticesAfter += after.acmr * count / after.atvr;
+      std::cout << fs::path(file).filename().string() << " [" << obj.name << "]: " << count << " triangles, ACMR "
+                << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    }
+  }
+
+  if (!triangles) return EXIT_FAILURE;
+  std::cout << "Total " << triangles << " triangles: ACMR " << missesBefore / triangles << " -> "
+            << missesAfter / triangles << ", ATVR " << missesBefore / verticesBefore << " -> "
+            << missesAfter / verticesAfter << ", vertices " << (size_t) verticesBefore << " -> "
+            << (size_t) verticesAfter << ", optimized in " << seconds * 1000.0 << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+static int benchLod(const std::vector<std::string> &files) {
+  // Same projection as the playground: 60 degree vertical field of view on a 720 pixel high viewport
+  const float pixelsPerDistance = 1.0f / std::tan(30.0f * 3.14159265f / 180.0f) * 720.0f * 0.5f;
+  const float threshold = 1.0f;
+  const std::vector<float> distances = {1.0f, 2.0f, 5.0f, 10.0f, 20.0f, 50.0f};
+
+  struct Model {
+    float radius;
+    std::vector<float> errors;
+    std::vector<size_t> triangles;
+  };
+  std::vector<Model> models;
+  std::vector<size_t> levelTriangles;
+  double seconds = 0;
+
+  for (auto &file : files) {
+    auto base = fs::path(file).parent_path().string() + "/";
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    auto err = tinyobj::LoadObj(shapes, materials, file.c_str(), base.c_str());
+    if (!err.empty()) {
+      std::cout << fs::path(file).filename().string() << ": " << err << std::endl;
+      continue;
+    }
+
+    // Per model level errors and triangle counts, combined over shapes like MeshBase does
+    Model model{0.0f, {0.0f}, {0}};
+    glm::vec3 min{std::numeric_limits<float>::max()}, max{-std::numeric_limits<float>::max()};
+    for (auto &obj : shapes) {
+      ppgso::MeshShape shape;
+      shape.positions = obj.mesh.positions;
+      shape.texcoords = obj.mesh.texcoords;
+      shape.normals = obj.mesh.normals;
+      shape.indices = obj.mesh.indices;
+      if (shape.indices.empty()) continue;
+      ppgso::optimizeShape(shape);
+      shape.computeBounds();
+      min = glm::min(min, shape.boundsMin);
+      max = glm::max(max, shape.boundsMax);
+
+      auto start = Clock::now();
+      ppgso::generateLods(shape);
+      seconds += secondsSince(start);
+
+      std::vector<ppgso::MeshLod> lods = shape.lods;
+      if (lods.empty()) lods.push_back({0, (uint32_t) shape.indices.size(), 0.0f});
+      size_t levels = std::max(lods.size(), model.triangles.size());
+      model.errors.resize(levels, model.errors.back());
+      model.triangles.resize(levels, model.triangles.back());
+      for (size_t l = 0; l < levels; l++) {
+        auto &lod = lods[std::min(l, lods.size() - 1)];
+        model.errors[l] = std::max(model.errors[l], lod.error);
+        model.triangles[l] += lod.indexCount / 3;
+      }
+      if (levelTriangles.size() < lods.size()) levelTriangles.resize(lods.size(), 0);
+      for (size_t l = 0; l < lods.size(); l++) levelTriangles[l] += lods[l].indexCount / 3;
+    }
+    if (model.triangles[0] == 0) continue;
+    model.radius = glm::length(max - min) * 0.5f;
+    models.push_back(std::move(model));
+  }
+
+  if (models.empty()) return EXIT_FAILURE;
+  std::cout << std::fixed << std::setprecision(2) << models.size() << " models, triangles per level:";
+  for (auto count : levelTriangles) std::cout << " " << count;
+  std::cout << ", generated in " << seconds * 1000.0 << " ms" << std::endl;
+
+  // Every model placed at the same distance, as if the camera walked away from the whole collection
+  for (float distance : distances) {
+    size_t full = 0, selected = 0;
+    for (auto &model : models) {
+      float pixelsPerUnit = pixelsPerDistance / std::max(distance - model.radius, 0.1f);
+      int lod = ppgso::selectLod(model.errors, pixelsPerUnit, threshold, 0);
+      full += model.triangles[0];
+      selected += model.triangles[std::min<size_t>(lod, model.triangles.size() - 1)];
+    }
+    std::cout << "Distance " << distance << ": " << full << " -> " << selected << " triangles ("
+              << 100.0 * selected / full << "%)" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int benchMeshlet(const std::vector<std::string> &files) {
+  size_t triangles = 0, meshletCount = 0, cones = 0;
+  double missesBefore = 0, missesAfter = 0, seconds = 0;
+
+  // Viewpoints on the axes and cube corners around every model, near enough that parts leave the frustum
+  std::vector<glm::vec3> directions;
+  for (int axis = 0; axis < 3; axis++)
+    for (float sign : {-1.0f, 1.0f}) {
+      glm::vec3 direction{0.0f};
+      direction[axis] = sign;
+      directions.push_back(direction);
+    }
+  for (int corner = 0; corner < 8; corner++)
+    directions.push_back(glm::normalize(glm::vec3{corner & 1 ? 1 : -1, corner & 2 ? 1 : -1, corner & 4 ? 1 : -1}));
+  const std::vector<float> distances = {0.75f, 1.5f, 3.0f};
+  std::vector<size_t> tested(distances.size(), 0), outside(distances.size(), 0), backFacing(distances.size(), 0);
+  std::vector<double> kept(distances.size(), 0.0), total(distances.size(), 0.0);
+
+  for (auto &file : files) {
+    auto base = fs::path(file).parent_path().string() + "/";
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    auto err = tinyobj::LoadObj(shapes, materials, file.c_str(), base.c_str());
+    if (!err.empty()) {
+      std::cout << fs::path(file).filename().string() << ": " << err << std::endl;
+      continue;
+    }
+
+    for (auto &obj : shapes) {
+      ppgso::MeshShape shape;
+      shape.positions = obj.mesh.positions;
+      shape.texcoords = obj.mesh.texcoords;
+      shape.normals = obj.mesh.normals;
+      shape.indices = obj.mesh.indices;
+      size_t count = shape.indices.size() / 3;
+      if (!count) continue;
+
+      ppgso::optimizeShape(shape);
+      auto before = ppgso::analyzeVertexCache(shape.indices, shape.positions.size() / 3);
+      auto start = Clock::now();
+      ppgso::buildMeshlets(shape);
+      seconds += secondsSince(start);
+      auto after = ppgso::analyzeVertexCache(shape.indices, shape.positions.size() / 3);
+      shape.computeBounds();
+
+      triangles += count;
+      missesBefore += before.acmr * count;
+      missesAfter += after.acmr * count;
+      meshletCount += shape.meshlets.size();
+      for (auto &meshlet : shape.meshlets) cones += meshlet.coneCutoff < 1.0f;
+
+      glm::vec3 center = (shape.boundsMin + shape.boundsMax) * 0.5f;
+      float radius = std::max(glm::length(shape.boundsMax - shape.boundsMin) * 0.5f, 1e-3f);
+      glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, radius * 0.01f, radius * 10.0f);
+      for (size_t d = 0; d < distances.size(); d++) {
+        for (auto &direction : directions) {
+          glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3{0, 0, 1} : glm::vec3{0, 1, 0};
+          glm::mat4 view = glm::lookAt(center + direction * radius * distances[d], center, up);
+          ppgso::MeshletCuller culler{projection, view, glm::mat4{1.0f}};
+          for (auto &meshlet : shape.meshlets) {
+            auto result = culler.test(meshlet);
+            tested[d]++;
+            outside[d] += result == ppgso::MeshletCuller::Outside;
+            backFacing[d] += result == ppgso::MeshletCuller::BackFacing;
+            if (result == ppgso::MeshletCuller::Visible) kept[d] += meshlet.indexCount / 3;
+          }
+          total[d] += count;
+        }
+      }
+    }
+  }
+
+  if (!triangles) return EXIT_FAILURE;
+  std::cout << std::fixed << std::setprecision(3) << triangles << " triangles in " << meshletCount << " meshlets ("
+            << (double) triangles / meshletCount << " triangles each, " << 100.0 * cones / meshletCount
+            << "% with a normal cone), ACMR " << missesBefore / triangles << " -> " << missesAfter / triangles
+            << ", built in " << seconds * 1000.0 << " ms" << std::endl;
+  for (size_t d = 0; d < distances.size(); d++)
+    std::cout << "Camera at " << distances[d] << " radii: " << tested[d] << " meshlets tested, "
+              << 100.0 * outside[d] / tested[d] << "% outside frustum, " << 100.0 * backFacing[d] / tested[d]
+              << "% back-facing, " << 100.0 * kept[d] / total[d] << "% of triangles drawn" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+static int benchArena(const std::vector<std::string> &files) {
+  // Compact vertex and index sizes of the shapes as parsed, one range of each per mesh like MeshBase
+  struct Sizes {
+    size_t vertices, indexBytes;
+  };
+  std::vector<Sizes> meshes;
+  for (auto &file : files) {
+    auto base = fs::path(file).parent_path().string() + "/";
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    if (!tinyobj::LoadObj(shapes, materials, file.c_str(), base.c_str()).empty()) continue;
+    Sizes sizes{0, 0};
+    for (auto &shape : shapes) {
+      size_t vertices = shape.mesh.positions.size() / 3;
+      sizes.vertices += vertices;
+      sizes.indexBytes += (shape.mesh.indices.size() * (vertices <= 65536 ? 2 : 4) + 3) & ~(size_t) 3;
+    }
+    if (sizes.vertices && sizes.indexBytes) meshes.push_back(sizes);
+  }
+  if (meshes.empty()) return EXIT_FAILURE;
+
+  // Same policy as GeometryArena: start at 1M vertices and 16 MB of indices, double when full
+  const size_t vertexSize = 16;
+  ppgso::RangeAllocator vertices{1024 * 1024}, indices{16 * 1024 * 1024};
+  size_t grows = 0;
+  auto allocate = [&grows](ppgso::RangeAllocator &allocator, size_t size) {
+    size_t offset = allocator.allocate(size);
+    if (offset != ppgso::RangeAllocator::invalid) return offset;
+    allocator.grow(std::max(allocator.capacity() * 2, allocator.capacity() + size));
+    grows++;
+    return allocator.allocate(size);
+  };
+
+  std::vector<std::pair<size_t, size_t>> ranges(meshes.size(), {ppgso::RangeAllocator::invalid, 0});
+  auto load = [&](size_t m) {
+    ranges[m] = {allocate(vertices, meshes[m].vertices), allocate(indices, meshes[m].indexBytes)};
+  };
+  auto unload = [&](size_t m) {
+    vertices.free(ranges[m].first);
+    indices.free(ranges[m].second);
+    ranges[m].first = ppgso::RangeAllocator::invalid;
+  };
+  auto report = [&](const std::string &phase) {
+    auto v = vertices.getStats(), i = indices.getStats();
+    std::cout << std::fixed << std::setprecision(2) << phase << ": vertices " << v.used * vertexSize / 1048576.0
+              << "/" << v.capacity * vertexSize / 1048576.0 << " MB, " << v.freeBlocks << " free blocks, fragmentation "
+              << v.fragmentation() * 100.0f << "%; indices " << i.used / 1048576.0 << "/" << i.capacity / 1048576.0
+              << " MB, " << i.freeBlocks << " free blocks, fragmentation " << i.fragmentation() * 100.0f << "%; "
+              << grows << " reallocations" << std::endl;
+  };
+
+  // Stream everything in, then keep swapping random halves of the collection like a camera moving around
+  std::mt19937 random{42};
+  std::vector<size_t> order(meshes.size());
+  for (size_t m = 0; m < order.size(); m++) order[m] = m;
+  std::shuffle(order.begin(), order.end(), random);
+  for (auto m : order) load(m);
+  report("Loaded " + std::to_string(meshes.size()) + " meshes");
+
+  for (int round = 1; round <= 20; round++) {
+    std::shuffle(order.begin(), order.end(), random);
+    for (size_t k = 0; k < order.size() / 2; k++)
+      if (ranges[order[k]].first != ppgso::RangeAllocator::invalid) unload(order[k]);
+    for (size_t k = order.size() / 4; k < order.size(); k++)
+      if (ranges[order[k]].first == ppgso::RangeAllocator::invalid) load(order[k]);
+    if (round % 5 == 0) report("Round " + std::to_string(round));
+  }
+
+  for (size_t m = 0; m < meshes.size(); m++)
+    if (ranges[m].first != ppgso::RangeAllocator::invalid) unload(m);
+  report("Unloaded");
+  return EXIT_SUCCESS;
+}
+
+// Read and write system calls and page faults of this process, zero where the kernel does not report them
+struct IoCounters {
+  uint64_t syscalls = 0;
+  uint64_t faults = 0;
+};
+
+static IoCounters ioCounters() {
+  IoCounters counters;
+#ifdef __linux__
+  std::ifstream io("/proc/self/io");
+  std::string key;
+  uint64_t value;
+  while (io >> key >> value)
+    if (key == "syscr:" || key == "syscw:") counters.syscalls += value;
+  rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+  counters.faults = (uint64_t) (usage.ru_minflt + usage.ru_majflt);
+#endif
+  return counters;
+}
+
+// Hash of the first level, equal to the hash of the source image for RGB8 textures
+static uint64_t textureHash(const ppgso::CompressedImage &texture) {
+  if (ppgso::CompressedImage::isBlockCompressed(texture.format)) return texture.contentHash();
+  return ppgso::Image{texture.width, texture.height, (const ppgso::Image::Pixel *) texture.levelData(0), nullptr}
+          .contentHash();
+}
+
+static int benchPack(const std::string &root, const std::string &packPath) {
+  const std::vector<std::string> directories = {"Collection", "objects", "tex", "textures"};
+  size_t meshes = 0, images = 0, blockCompressed = 0;
+  uint64_t checksum = 0;
+
+  // Like the playground: iterate the directories, decode meshes through the mesh cache and textures through the
+  // texture cache. Both sides hash the content so every byte is actually read, as the upload would.
+  auto loose = [&]() {
+    meshes = images = 0;
+    checksum = 0;
+    for (auto &directory : directories) {
+      if (!fs::is_directory(fs::path(root) / directory)) continue;
+      for (auto &entry : fs::recursive_directory_iterator(fs::path(root) / directory)) {
+        if (!entry.is_regular_file()) continue;
+        auto extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        try {
+          if (extension == ".obj") {
+            checksum ^= ppgso::Mesh::decode(entry.path().string()).contentHash();
+            meshes++;
+          } else if (extension == ".bmp") {
+            auto path = entry.path().string();
+            auto texture = ppgso::TextureCache::load(path, [&path]() {
+              return ppgso::image::buildMipChain(ppgso::image::loadBMP(path), ppgso::image::isColorTexture(path));
+            });
+            checksum ^= textureHash(*texture);
+            images++;
+          }
+        } catch (std::exception &) {
+          // Unsupported files are missing from the pack as well
+        }
+      }
+    }
+  };
+  auto packed = [&]() {
+    meshes = images = 0;
+    checksum = 0;
+    auto pack = ppgso::AssetPack::open(packPath);
+    for (auto &name : pack->list(ppgso::AssetPack::Type::Mesh)) {
+      checksum ^= pack->loadMesh(name).contentHash();
+      meshes++;
+    }
+    for (auto &name : pack->list(ppgso::AssetPack::Type::Image)) {
+      checksum ^= pack->loadImage(name).contentHash();
+      images++;
+    }
+    blockCompressed = 0;
+    for (auto &name : pack->list(ppgso::AssetPack::Type::Texture)) {
+      auto texture = pack->loadTexture(name);
+      if (ppgso::CompressedImage::isBlockCompressed(texture.format)) blockCompressed++;
+      checksum ^= textureHash(texture);
+      images++;
+    }
+  };
+
+  // The first run warms the page cache and the mesh cache sidecars, the counters come from the last one
+  std::cout << std::fixed << std::setprecision(1);
+  std::vector<uint64_t> checksums;
+  for (auto &[label, load] : std::vector<std::pair<std::string, std::function<void()>>>{{"Loose files", loose},
+                                                                                       {"Asset pack", packed}}) {
+    IoCounters counters;
+    double seconds = bestOf(3, [&]() {
+      auto before = ioCounters();
+      load();
+      auto after = ioCounters();
+      counters = {after.syscalls - before.syscalls, after.faults - before.faults};
+    });
+    checksums.push_back(checksum);
+    std::cout << label << ": " << meshes << " meshes and " << images << " textures in " << seconds * 1000.0 << " ms, "
+              << counters.syscalls << " read/write syscalls, " << counters.faults << " page faults" << std::endl;
+  }
+
+  // Block compressed textures are lossy, so only the meshes and RGB8 textures could match
+  if (blockCompressed) {
+    std::cout << blockCompressed << " textures are block compressed, content not compared" << std::endl;
+  } else if (checksums[0] != checksums[1]) {
+    std::cout << "Pack content differs from the loose files, rebake it!" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// The loader before the mapped one: ifstream, a vector per row and a swap per pixel
+static ppgso::Image loadBMPByRow(const std::string &bmp) {
+  std::ifstream input(bmp, std::ios::binary);
+  uint8_t header[54];
+  input.read((char *) header, sizeof(header));
+  uint32_t offset;
+  int32_t width, height;
+  std::memcpy(&offset, header + 10, 4);
+  std::memcpy(&width, header + 18, 4);
+  std::memcpy(&height, header + 22, 4);
+  bool flipped = height < 0;
+  height = std::abs(height);
+
+  ppgso::Image image{width, height};
+  auto &framebuffer = image.getFramebuffer();
+  input.seekg(offset, input.beg);
+  unsigned int rowPadded = (width * sizeof(ppgso::Image::Pixel) + 3) & (~3);
+  for (int j = 0; j < height; j++) {
+    auto row = std::vector<ppgso::Image::Pixel>(rowPadded);
+    input.read((char *) row.data(), rowPadded);
+    for (int i = 0; i < width; i++) {
+      auto pixel = row[i];
+      std::swap(pixel.r, pixel.b);
+      framebuffer[i + (flipped ? j : height - 1 - j) * width] = pixel;
+    }
+  }
+  return image;
+}
+
+static int benchBmp(const std::vector<std::string> &files) {
+  double totalBytes = 0, totalRows = 0, totalMapped = 0, totalCopy = 0;
+  int mismatches = 0;
+
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto &file : files) {
+    ppgso::Image rows{1, 1}, mapped{1, 1};
+    auto byRow = bestOf(5, [&]() { rows = loadBMPByRow(file); });
+    auto byMapping = bestOf(5, [&]() { mapped = ppgso::image::loadBMP(file); });
+
+    // Bandwidth reference: copying the pixels once into a new buffer, which pays the same page faults as a new image
+    size_t bytes = (size_t) mapped.width * mapped.height * sizeof(ppgso::Image::Pixel);
+    std::vector<uint8_t> source(bytes, 1);
+    auto copy = bestOf(5, [&]() {
+      std::unique_ptr<uint8_t[]> target{new uint8_t[bytes]};
+      std::memcpy(target.get(), source.data(), bytes);
+      if (target[bytes / 2] != 1) std::abort();
+    });
+
+    bool same = rows.width == mapped.width && rows.height == mapped.height &&
+                std::memcmp(rows.data(), mapped.data(), bytes) == 0;
+    if (!same) mismatches++;
+
+    totalBytes += (double) bytes;
+    totalRows += byRow;
+    totalMapped += byMapping;
+    totalCopy += copy;
+
+    double mb = bytes / (1024.0 * 1024.0);
+    std::cout << fs::path(file).filename().string() << ": " << mapped.width << "x" << mapped.height << ", "
+              << mb / byRow << " MB/s by row, " << mb / byMapping << " MB/s mapped, " << mb / copy << " MB/s memcpy"
+              << (same ? "" : " MISMATCH") << std::endl;
+  }
+
+  double mb = totalBytes / (1024.0 * 1024.0);
+  std::cout << "Total " << files.size() << " files, " << mb << " MB: " << mb / totalRows << " MB/s by row, "
+            << mb / totalMapped << " MB/s mapped (" << std::setprecision(2) << totalRows / totalMapped
+            << "x), memcpy " << std::setprecision(1) << mb / totalCopy << " MB/s" << std::endl;
+  if (mismatches) std::cout << mismatches << " files differ between loaders!" << std::endl;
+  return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// PSNR of the channels a format keeps, BC5 drops blue
+static double psnr(const ppgso::Image &a, const ppgso::Image &b, int channels) {
+  double error = 0.0;
+  auto pa = a.data(), pb = b.data();
+  for (size_t i = 0; i < (size_t) a.width * a.height; i++) {
+    int d[3] = {pa[i].r - pb[i].r, pa[i].g - pb[i].g, pa[i].b - pb[i].b};
+    for (int c = 0; c < channels; c++) error += d[c] * d[c];
+  }
+  double mse = error / ((double) a.width * a.height * channels);
+  return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static int benchBc(const std::vector<std::string> &files, unsigned int threads) {
+  ppgso::ThreadPool pool{threads};
+  double totalPixels = 0, totalSingle = 0, totalParallel = 0, totalPsnr = 0;
+  size_t rgbBytes = 0, bcBytes = 0;
+
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto &file : files) {
+    auto image = ppgso::image::loadBMP(file);
+    auto format = ppgso::image::blockFormatFor(file);
+    ppgso::CompressedImage compressed{format, 1, 1, 1};
+    auto oneThread = bestOf(3, [&]() { compressed = ppgso::image::compressBC(image, format, 0, nullptr); });
+    auto parallel = bestOf(3, [&]() { compressed = ppgso::image::compressBC(image, format, 0, &pool); });
+
+    bool bc5 = format == ppgso::CompressedImage::Format::BC5;
+    double quality = psnr(image, ppgso::image::decompressBC(compressed), bc5 ? 2 : 3);
+    size_t rgb = ppgso::CompressedImage::byteSize(ppgso::CompressedImage::Format::RGB8, image.width, image.height,
+                                                  compressed.levels);
+    totalPixels += (double) image.width * image.height;
+    totalSingle += oneThread;
+    totalParallel += parallel;
+    totalPsnr += quality;
+    rgbBytes += rgb;
+    bcBytes += compressed.byteSize();
+
+    double mp = image.width * image.height / 1e6;
+    std::cout << fs::path(file).filename().string() << ": " << image.width << "x" << image.height << " "
+              << (bc5 ? "BC5" : "BC1") << ", " << mp / oneThread << " MP/s on 1 thread, " << mp / parallel
+              << " MP/s on " << pool.size() + 1 << ", PSNR " << std::setprecision(2) << quality << " dB, "
+              << std::setprecision(1) << (double) rgb / compressed.byteSize() << "x smaller" << std::endl;
+  }
+  if (files.empty()) return EXIT_FAILURE;
+
+  double mp = totalPixels / 1e6, mb = 1024.0 * 1024.0;
+  std::cout << "Total " << files.size() << " textures, " << mp << " MP: " << mp / totalSingle << " MP/s on 1 thread, "
+            << mp / totalParallel << " MP/s on " << pool.size() + 1 << " (" << std::setprecision(2)
+            << totalSingle / totalParallel << "x), mean PSNR " << totalPsnr / files.size() << " dB, "
+            << std::setprecision(1) << rgbBytes / mb << " MB RGB8 -> " << bcBytes / mb << " MB with full mip chains ("
+            << (double) rgbBytes / bcBytes << "x)" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// Straightforward gamma-correct 2x2 box filter in double precision, the result buildMipChain approximates
+static double toLinear(int value, bool srgb) {
+  double c = value / 255.0;
+  return !srgb ? c : c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+static int fromLinear(double l, bool srgb) {
+  double c = !srgb ? l : l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+  return (int) std::lround(std::min(std::max(c, 0.0), 1.0) * 255.0);
+}
+
+static std::vector<uint8_t> referenceLevel(const uint8_t *source, int sourceWidth, int sourceHeight, bool srgb) {
+  int width = std::max(sourceWidth / 2, 1), height = std::max(sourceHeight / 2, 1);
+  std::vector<uint8_t> result((size_t) width * height * 3);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < 3; c++) {
+        double sum = 0.0;
+        for (int sy = 0; sy < 2; sy++)
+          for (int sx = 0; sx < 2; sx++) {
+            int px = std::min(x * 2 + sx, sourceWidth - 1), py = std::min(y * 2 + sy, sourceHeight - 1);
+            sum += toLinear(source[((size_t) py * sourceWidth + px) * 3 + c], srgb);
+          }
+        result[((size_t) y * width + x) * 3 + c] = (uint8_t) fromLinear(sum / 4.0, srgb);
+      }
+    }
+  }
+  return result;
+}
+
+static int benchMips(const std::vector<std::string> &files, unsigned int threads) {
+  ppgso::ThreadPool pool{threads};
+  double totalPixels = 0, totalSingle = 0, totalParallel = 0, totalReference = 0, totalCold = 0, totalWarm = 0;
+  int worstError = 0;
+
+  std::cout << std::fixed << std::setprecision(1);
+  size_t count = 0;
+  for (auto &file : files) {
+    ppgso::Image image{0, 0};
+    try {
+      image = ppgso::image::loadBMP(file);
+    } catch (std::exception &e) {
+      std::cout << "Skipping " << file << ": " << e.what() << std::endl;
+      continue;
+    }
+    bool srgb = ppgso::image::isColorTexture(file);
+    ppgso::CompressedImage chain{ppgso::CompressedImage::Format::RGB8, 1, 1, 1};
+    auto oneThread = bestOf(3, [&]() { chain = ppgso::image::buildMipChain(image, srgb, 0, nullptr); });
+    auto parallel = bestOf(3, [&]() { chain = ppgso::image::buildMipChain(image, srgb, 0, &pool); });
+
+    // Each reference level is filtered from the level above it in the chain, so errors do not accumulate
+    int error = 0;
+    auto reference = bestOf(1, [&]() {
+      for (int level = 1; level < chain.levels; level++) {
+        auto expected = referenceLevel(chain.levelData(level - 1), chain.levelWidth(level - 1),
+                                       chain.levelHeight(level - 1), srgb);
+        auto actual = chain.levelData(level);
+        for (size_t i = 0; i < expected.size(); i++) error = std::max(error, std::abs(expected[i] - actual[i]));
+      }
+    });
+
+    // Cold: filter and write the sidecar, warm: map it
+    std::error_code ec;
+    fs::remove(ppgso::TextureCache::pathFor(file), ec);
+    auto build = [&file, srgb]() { return ppgso::image::buildMipChain(ppgso::image::loadBMP(file), srgb); };
+    auto cold = bestOf(1, [&]() { ppgso::TextureCache::load(file, build); });
+    auto warm = bestOf(3, [&]() {
+      if (ppgso::TextureCache::load(file, build)->levels != chain.levels) std::abort();
+    });
+
+    totalPixels += (double) image.width * image.height;
+    totalSingle += oneThread;
+    totalParallel += parallel;
+    totalReference += reference;
+    totalCold += cold;
+    totalWarm += warm;
+    worstError = std::max(worstError, error);
+    count++;
+
+    double mp = image.width * image.height / 1e6;
+    std::cout << fs::path(file).filename().string() << ": " << image.width << "x" << image.height << ", "
+              << chain.levels << " levels " << (srgb ? "sRGB" : "linear") << ", " << mp / oneThread
+              << " MP/s on 1 thread, " << mp / parallel << " MP/s on " << pool.size() + 1 << ", reference "
+              << mp / reference << " MP/s, max error " << error << ", cache " << cold * 1000.0 << " ms cold "
+              << warm * 1000.0 << " ms warm" << std::endl;
+  }
+  if (!count) return EXIT_FAILURE;
+
+  double mp = totalPixels / 1e6;
+  std::cout << "Total " << count << " textures, " << mp << " MP: " << mp / totalSingle
+            << " MP/s on 1 thread, " << mp / totalParallel << " MP/s on " << pool.size() + 1 << ", reference "
+            << mp / totalReference << " MP/s (" << std::setprecision(1) << totalReference / totalSingle
+            << "x), max error " << worstError << ", cache " << totalCold * 1000.0 << " ms cold "
+            << totalWarm * 1000.0 << " ms warm" << std::endl;
+  ppgso::TextureCache::printStats(std::cout);
+  // The 14 bit linear values round differently from doubles by at most a step
+  return worstError <= 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Direct 5x5 convolution in double precision, edges repeat like in convolve5x5
+static int maxConvolutionError(const ppgso::Image &image, const ppgso::Image &actual, const float kernel[25],
+                               float factor) {
+  auto source = reinterpret_cast<const uint8_t *>(image.data());
+  auto result = reinterpret_cast<const uint8_t *>(actual.data());
+  int error = 0;
+  for (int y = 0; y < image.height; y++) {
+    for (int x = 0; x < image.width; x++) {
+      for (int c = 0; c < 3; c++) {
+        double sum = 0.0;
+        for (int i = 0; i < 5; i++)
+          for (int j = 0; j < 5; j++) {
+            int sx = std::min(std::max(x + j - 2, 0), image.width - 1);
+            int sy = std::min(std::max(y + i - 2, 0), image.height - 1);
+            sum += kernel[i * 5 + j] * source[((size_t) sy * image.width + sx) * 3 + c];
+          }
+        int expected = (int) std::lround(std::min(std::max(sum / factor, 0.0), 255.0));
+        error = std::max(error, std::abs(expected - result[((size_t) y * image.width + x) * 3 + c]));
+      }
+    }
+  }
+  return error;
+}
+
+static int benchOps(const std::vector<std::string> &files, unsigned int threads) {
+  ppgso::ThreadPool pool{threads};
+  // Binomial 5x5 blur, the example kernel of the convolution shader
+  const float kernel[25] = {1, 4, 6, 4, 1, 4, 16, 24, 16, 4, 6, 24, 36, 24, 6, 4, 16, 24, 16, 4, 1, 4, 6, 4, 1};
+  const char *names[] = {"resize", "blur", "convolve", "gamma", "planar"};
+  double single[5] = {}, parallel[5] = {}, totalPixels = 0;
+  int worstError = 0;
+
+  std::cout << std::fixed << std::setprecision(1);
+  size_t count = 0;
+  for (auto &file : files) {
+    ppgso::Image image{0, 0};
+    try {
+      image = ppgso::image::loadBMP(file);
+    } catch (std::exception &e) {
+      std::cout << "Skipping " << file << ": " << e.what() << std::endl;
+      continue;
+    }
+
+    ppgso::Image result{0, 0};
+    std::function<void(ppgso::ThreadPool *)> ops[5] = {
+            [&](ppgso::ThreadPool *p) {
+              result = ppgso::image::resize(image, image.width * 3 / 4, image.height * 3 / 4, p);
+            },
+            [&](ppgso::ThreadPool *p) { result = ppgso::image::gaussianBlur(image, 2.0f, p); },
+            [&](ppgso::ThreadPool *p) { result = ppgso::image::convolve5x5(image, kernel, 256.0f, 0.0f, p); },
+            [&](ppgso::ThreadPool *p) {
+              result = image;
+              ppgso::image::convertGamma(result, true, p);
+            },
+            [&](ppgso::ThreadPool *p) {
+              result = ppgso::image::fromPlanar(ppgso::image::toPlanar(image, true, p), true, p);
+            }};
+    double mp = image.width * image.height / 1e6;
+    std::cout << fs::path(file).filename().string() << ": " << image.width << "x" << image.height;
+    for (int op = 0; op < 5; op++) {
+      auto oneThread = bestOf(3, [&]() { ops[op](nullptr); });
+      auto threaded = bestOf(3, [&]() { ops[op](&pool); });
+      single[op] += oneThread;
+      parallel[op] += threaded;
+      std::cout << ", " << names[op] << " " << mp / oneThread << "/" << mp / threaded << " MP/s";
+    }
+
+    // The last run left the planar round trip, which has to give the image back
+    int error = 0;
+    auto source = reinterpret_cast<const uint8_t *>(image.data());
+    auto roundTrip = reinterpret_cast<const uint8_t *>(result.data());
+    for (size_t i = 0; i < (size_t) image.width * image.height * 3; i++)
+      error = std::max(error, std::abs(source[i] - roundTrip[i]));
+    error = std::max(error, maxConvolutionError(image, ppgso::image::convolve5x5(image, kernel, 256.0f), kernel,
+                                                256.0f));
+    std::cout << ", max error " << error << std::endl;
+
+    worstError = std::max(worstError, error);
+    totalPixels += (double) image.width * image.height;
+    count++;
+  }
+  if (!count) return EXIT_FAILURE;
+
+  double mp = totalPixels / 1e6;
+  std::cout << "Total " << count << " images, " << mp << " MP, MP/s on 1 and " << pool.size() + 1 << " threads:";
+  for (int op = 0; op < 5; op++)
+    std::cout << " " << names[op] << " " << mp / single[op] << "/" << mp / parallel[op];
+  std::cout << ", max error " << worstError << std::endl;
+  // Float sums round differently from doubles by at most a step
+  return worstError <= 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void usage() {
+  std::cout << "Usage: ppgso_bench <mode> [options] <files or directories...>" << std::endl
+            << "  obj [--threads N]  OBJ parse throughput, LoadObj vs LoadObjParallel" << std::endl
+            << "  vcache             Vertex cache ACMR/ATVR before and after optimizeShape" << std::endl
+            << "  lod                Triangles submitted at several camera distances with and without LODs" << std::endl
+            << "  meshlet            Meshlet sizes and the share culled from viewpoints around every model" << std::endl
+            << "  arena              Geometry arena fragmentation while meshes are streamed in and out" << std::endl
+            << "  pack <data> <pack> Startup load of the loose data directories against a baked asset pack" << std::endl
+            << "  bmp                BMP decode throughput, mapped loader vs row by row reads and memcpy" << std::endl
+            << "  bc [--threads N]   BC1/BC5 encode throughput, PSNR and size against RGB8" << std::endl
+            << "  mips [--threads N] Mip chain build throughput and error against a float reference, cache loads"
+            << std::endl
+            << "  ops [--threads N]  CPU image operations on 1 and N threads, convolution and round trip error"
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  std::string mode = argv[1];
+  unsigned int threads = 0;
+  std::vector<std::string> args;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      threads = (unsigned int) std::stoul(argv[++i]);
+    else
+      args.emplace_back(argv[i]);
+  }
+
+  if (mode == "obj") return benchObj(collectFiles(args, ".obj"), threads);
+  if (mode == "vcache") return benchVertexCache(collectFiles(args, ".obj"));
+  if (mode == "lod") return benchLod(collectFiles(args, ".obj"));
+  if (mode == "meshlet") return benchMeshlet(collectFiles(args, ".obj"));
+  if (mode == "arena") return benchArena(collectFiles(args, ".obj"));
+  if (mode == "pack" && args.size() == 2) return benchPack(args[0], args[1]);
+  if (mode == "bmp") return benchBmp(collectFiles(args, ".bmp"));
+  if (mode == "bc") return benchBc(collectFiles(args, ".bmp"), threads);
+  if (mode == "mips") return benchMips(collectFiles(args, ".bmp"), threads);
+  if (mode == "ops") return benchOps(collectFiles(args, ".bmp"), threads);
+
+  usage();
+  return EXIT_FAILURE;
+}
@@ -1,31 +1,572 @@
 #include "GenericModel.hpp"
+#include <unordered_set>
+#include <future>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
 #include <shader/phong_vert_glsl.h>
 #include <shader/phong_frag_glsl.h>
 #include <glm/gtc/type_ptr.hpp>
 
-std::unordered_map<std::string, std::shared_ptr<ppgso::Mesh>> GenericModel::meshCache;
-std::unordered_map<std::string, std::shared_ptr<ppgso::Texture>> GenericModel::texCache;
+std::unordered_map<std::string, GenericModel::CachedMesh> GenericModel::meshCache;
+std::unordered_map<std::string, GenericModel::CachedTexture> GenericModel::texCache;
 std::unique_ptr<ppgso::Shader> GenericModel::shader = nullptr;
+GenericModel::ShaderUniforms GenericModel::uniforms;
+std::mutex GenericModel::cacheMutex;
+std::unordered_set<std::string> GenericModel::streaming;
+std::unordered_set<std::string> GenericModel::failed;
+std::unordered_map<std::string, ppgso::Meshlet> GenericModel::meshBounds;
+std::unordered_map<std::string, float> GenericModel::uvDensity;
+std::unordered_map<std::string, std::shared_ptr<ppgso::Texture>> GenericModel::placeholders;
+std::unordered_map<uint64_t, std::vector<std::string>> GenericModel::uploading;
+std::unordered_map<uint64_t, GenericModel::SharedMesh> GenericModel::meshByContent;
+std::unordered_map<uint64_t, GenericModel::SharedTexture> GenericModel::texByContent;
+GenericModel::DedupStats GenericModel::dedupStats;
+GenericModel::MipStats GenericModel::mipStats;
+std::unordered_set<uint64_t> GenericModel::packedTextures;
+bool GenericModel::compactVertices = true;
+bool GenericModel::useLods = true;
+float GenericModel::lodThreshold = 1.0f;
+bool GenericModel::cullMeshlets = true;
+std::shared_ptr<ppgso::AssetPack> GenericModel::assetPack;
+ppgso::ResidencyManager GenericModel::residency;
+ppgso::AssetStreamer *GenericModel::reloadStreamer = nullptr;
+ppgso::TextureUploader *GenericModel::textureUploader = nullptr;
+ppgso::TexturePacker *GenericModel::texturePacker = nullptr;
+bool GenericModel::mipStreaming = true;
 
-GenericModel::GenericModel(Object* parent, const std::string &meshFile, const std::string &texFile) {
+// Текстуры крупнее этого грузятся с грубых уровней, мелкие целиком
+constexpr int MIP_STREAM_SIZE = 128;
+// wantedLevel текстуры, которую в этом кадре не рисовали
+constexpr int NOT_DRAWN = std::numeric_limits<int>::max();
+
+// Id массива текстур в residency, не пересекается с хешами содержимого на практике
+static uint64_t arrayId(const ppgso::TextureArray &array) {
+    return 0x5441525241590000ull | array.getTexture();
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Заглушка: первый уровень готовой цепочки mipmap'ов не больше 16x16, уже отфильтрованный
+static ppgso::Image preview(const ppgso::CompressedImage &texture) {
+    int level = 0;
+    while (level + 1 < texture.levels && std::max(texture.levelWidth(level), texture.levelHeight(level)) > 16) level++;
+    return ppgso::image::decompressBC(texture, level);
+}
+
+// Первый уровень не больше MIP_STREAM_SIZE, 0 у текстур, которые грузятся целиком
+static int coarseLevel(const ppgso::CompressedImage &texture) {
+    if (!GenericModel::mipStreaming) return 0;
+    int level = 0;
+    while (level + 1 < texture.levels &&
+           std::max(texture.levelWidth(level), texture.levelHeight(level)) > MIP_STREAM_SIZE) level++;
+    return level;
+}
+
+// Слои массивов заполняются сразу, отдельные текстуры и их грубые уровни идут через PBO загрузчика
+static bool packs(const ppgso::CompressedImage &texture) {
+    if (coarseLevel(texture) > 0) return false;
+    return GenericModel::texturePacker && GenericModel::texturePacker->canPack(texture);
+}
+
+std::string GenericModel::textureFor(const ppgso::Material &material) {
+    if (!material.texture.empty()) return material.texture;
+    return solidTextureFor(material);
+}
+
+std::string GenericModel::solidTextureFor(const ppgso::Material &material) {
+    // Одинаковые цвета делят одну текстуру
+    char key[8];
+    auto channel = [](float c) { return (int) std::lround(glm::clamp(c, 0.0f, 1.0f) * 255.0f); };
+    auto &color = material.diffuse;
+    std::snprintf(key, sizeof(key), "#%02x%02x%02x", channel(color.r), channel(color.g), channel(color.b));
+    return key;
+}
+
+GenericModel::GenericModel(Object* parent, const std::string &meshFile,
+                           std::shared_ptr<const ppgso::Material> material, bool loadNow)
+        : material{std::move(material)} {
     parentObject = parent;
     meshPath = meshFile;
-    texturePath = texFile;
+    texturePath = textureFor(*this->material);
     scale = {1,1,1};
     rotation = {0,0,0};
     position = {0,0,0};
-    ensureResources();
+    if (loadNow) {
+        ensureResources();
+    } else if (!shader) {
+        createShader();
+    }
+}
+
+void GenericModel::createShader() {
+    shader = std::make_unique<ppgso::Shader>(phong_vert_glsl, phong_frag_glsl);
+    uniforms.projection = shader->uniform<glm::mat4>("projection");
+    uniforms.view = shader->uniform<glm::mat4>("view");
+    uniforms.model = shader->uniform<glm::mat4>("model");
+    uniforms.texture = shader->uniform<int>("Texture");
+    uniforms.textureLayer = shader->uniform<int>("TextureLayer");
+    uniforms.transparency = shader->uniform<float>("Transparency");
+
+    // Юниты карт теней не меняются, выставляем их один раз (SceneWindow привязывает карты к юнитам 1-6)
+    shader->setUniform("shadowMap0", 1);
+    shader->setUniform("shadowMap1", 2);
+    shader->setUniform("shadowMap2", 3);
+    shader->setUniform("shadowMap3", 4);
+    shader->setUniform("pointShadowMaps[0]", 5);
+    shader->setUniform("pointShadowMaps[1]", 6);
 }
 
 void GenericModel::ensureResources() {
-    if (!shader) shader = std::make_unique<ppgso::Shader>(phong_vert_glsl, phong_frag_glsl);
+    if (!shader) createShader();
+
+    if (!meshCache.count(meshPath)) {
+        auto data = loadMesh(meshPath);
+        cacheMesh(meshPath, data.contentHash(), data);
+    }
+    if (!texturePath.empty() && !texCache.count(texturePath)) cacheTexture(texturePath, decodeTexture(texturePath));
+}
+
+ppgso::MeshData GenericModel::loadMesh(const std::string &path) {
+    if (assetPack && assetPack->contains(path, ppgso::AssetPack::Type::Mesh)) return assetPack->loadMesh(path);
+    return ppgso::Mesh::decode(path);
+}
+
+ppgso::Image GenericModel::loadImage(const std::string &path) {
+    if (!path.empty() && path[0] == '#') {
+        ppgso::Image image{1, 1};
+        auto rgb = std::stoul(path.substr(1), nullptr, 16);
+        image.clear({(uint8_t) (rgb >> 16), (uint8_t) (rgb >> 8), (uint8_t) rgb});
+        return image;
+    }
+    if (assetPack && assetPack->contains(path, ppgso::AssetPack::Type::Image)) return assetPack->loadImage(path);
+    return ppgso::image::loadBMP(path);
+}
+
+GenericModel::DecodedTexture GenericModel::decodeTexture(const std::string &path) {
+    DecodedTexture decoded;
+    bool color = ppgso::image::isColorTexture(path);
+    // Пакет хранит готовые уровни, BMP с диска один раз фильтруется в .texcache рядом с файлом
+    if (assetPack && assetPack->contains(path, ppgso::AssetPack::Type::Texture)) {
+        decoded.texture = std::make_shared<ppgso::CompressedImage>(assetPack->loadTexture(path));
+    } else if (path[0] == '#' || (assetPack && assetPack->contains(path, ppgso::AssetPack::Type::Image))) {
+        decoded.texture = std::make_shared<ppgso::CompressedImage>(ppgso::image::buildMipChain(loadImage(path), color));
+    } else {
+        decoded.texture = ppgso::TextureCache::load(path, [&path, color]() {
+            return ppgso::image::buildMipChain(ppgso::image::loadBMP(path), color);
+        });
+    }
+    decoded.preview = preview(*decoded.texture);
+    decoded.hash = decoded.texture->contentHash();
+    return decoded;
+}
+
+std::shared_ptr<ppgso::Mesh> GenericModel::shareMesh(uint64_t hash, const ppgso::MeshData &data) {
+    {
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        auto found = meshByContent.find(hash);
+        if (found != meshByContent.end()) {
+            dedupStats.meshDuplicates++;
+            dedupStats.meshBytesSaved += data.byteSize();
+            dedupStats.secondsSaved += found->second.uploadSeconds;
+            return found->second.mesh;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto format = compactVertices ? ppgso::Mesh::VertexFormat::Compact : ppgso::Mesh::VertexFormat::Float;
+    auto mesh = std::make_shared<ppgso::Mesh>(data, format);
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    meshByContent[hash] = {mesh, secondsSince(start)};
+    // Повторная загрузка вытесненного меша не новый уникальный меш
+    if (!residency.add(hash, mesh->getBytes(), 0, [hash]() { evictMesh(hash); })) dedupStats.meshes++;
+    return mesh;
+}
+
+GenericModel::CachedTexture GenericModel::shareTexture(DecodedTexture &&decoded) {
+    auto hash = decoded.hash;
+    {
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        auto found = texByContent.find(hash);
+        if (found != texByContent.end()) {
+            dedupStats.textureDuplicates++;
+            dedupStats.textureBytesSaved += found->second.texture.getBytes();
+            dedupStats.secondsSaved += found->second.uploadSeconds;
+            return found->second.texture;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CachedTexture texture{nullptr, nullptr, hash};
+    std::shared_ptr<const ppgso::CompressedImage> source;
+    int coarse = coarseLevel(*decoded.texture);
+    if (coarse > 0) {
+        // Крупная текстура: сначала грубые уровни, тонкие догружает streamMips()
+        texture.texture = std::make_shared<ppgso::Texture>(*decoded.texture, coarse);
+        source = decoded.texture;
+    } else if (texturePacker) {
+        texture.layer = texturePacker->add(*decoded.texture);
+    }
+    if (!texture.layer && !texture.texture) texture.texture = std::make_shared<ppgso::Texture>(*decoded.texture);
+    if (texture.texture) texture.texture->setOwner("GenericModel");
+    addTexture(texture, std::move(decoded.preview), secondsSince(start), std::move(source));
+    return texture;
+}
+
+void GenericModel::addTexture(const CachedTexture &texture, ppgso::Image &&preview, double uploadSeconds,
+                              std::shared_ptr<const ppgso::CompressedImage> source) {
+    auto hash = texture.hash;
+    size_t previewBytes = (size_t) preview.width * preview.height * 3;
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    texByContent.insert_or_assign(hash, SharedTexture{texture, uploadSeconds, std::move(preview),
+                                                      {ppgso::MemoryTracker::Category::Cpu, "GenericModel thumbnails",
+                                                       previewBytes}, std::move(source), NOT_DRAWN, false});
+    if (texture.layer) {
+        // В бюджете весь массив, а не слой: освобождённый слой VRAM не возвращает
+        auto &array = texture.layer->getArray();
+        auto id = arrayId(array);
+        if (!residency.contains(id))
+            residency.add(id, array.getLayers() * array.getLayerBytes(), 0, [id]() { evictArray(id); });
+        if (packedTextures.insert(hash).second) dedupStats.textures++;
+        return;
+    }
+    if (!residency.add(hash, texture.getBytes(), previewBytes, [hash]() { evictTexture(hash); })) dedupStats.textures++;
+}
+
+void GenericModel::queueTexture(const std::string &path, DecodedTexture &&decoded) {
+    auto hash = decoded.hash;
+    bool resident;
+    {
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        // Такое содержимое уже в VRAM или уже грузится для другого пути
+        resident = texByContent.count(hash) > 0;
+        if (!resident) {
+            auto &waiting = uploading[hash];
+            waiting.push_back(path);
+            if (waiting.size() > 1) return;
+        }
+    }
+    if (resident) {
+        cacheTexture(path, std::move(decoded));
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        streaming.erase(path);
+        return;
+    }
+
+    // Уровни уходят в буфер загрузки, заглушка ждёт готовую текстуру
+    auto preview = std::make_shared<ppgso::Image>(std::move(decoded.preview));
+    // Крупная текстура грузится с грубых уровней, тонкие догружает streamMips()
+    int coarse = coarseLevel(*decoded.texture);
+    auto source = coarse > 0 ? decoded.texture : nullptr;
+    textureUploader->upload(std::move(decoded.texture), coarse,
+                            [hash, preview, source](std::shared_ptr<ppgso::Texture> texture) {
+        texture->setOwner("GenericModel");
+        // Поток рендера тратит на асинхронную загрузку лишь постановку команд
+        addTexture({texture, nullptr, hash}, std::move(*preview), 0.0, source);
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        auto waiting = uploading.find(hash);
+        if (waiting == uploading.end()) return;
+        for (auto &path : waiting->second) {
+            texCache[path] = {texture, nullptr, hash};
+            placeholders.erase(path);
+            streaming.erase(path);
+        }
+        dedupStats.textureDuplicates += (int) waiting->second.size() - 1;
+        dedupStats.textureBytesSaved += (waiting->second.size() - 1) * texture->getBytes();
+        uploading.erase(waiting);
+    });
+}
+
+void GenericModel::cacheMesh(const std::string &path, uint64_t hash, const ppgso::MeshData &data) {
+    auto mesh = shareMesh(hash, data);
+    float density = data.uvDensity();
+    glm::vec3 min, max;
+    mesh->getBounds(min, max);
+    ppgso::Meshlet sphere;
+    sphere.center = (min + max) * 0.5f;
+    sphere.radius = glm::length(max - min) * 0.5f;
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    meshCache[path] = {std::move(mesh), hash};
+    meshBounds[path] = sphere;
+    uvDensity[path] = density;
+}
+
+void GenericModel::cacheTexture(const std::string &path, DecodedTexture &&decoded) {
+    auto texture = shareTexture(std::move(decoded));
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    texCache[path] = std::move(texture);
+    placeholders.erase(path);
+}
 
-    if (meshCache.find(meshPath) == meshCache.end()) {
-        meshCache[meshPath] = std::make_shared<ppgso::Mesh>(meshPath);
+void GenericModel::evictMesh(uint64_t hash) {
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    meshByContent.erase(hash);
+    for (auto it = meshCache.begin(); it != meshCache.end();)
+        it = it->second.hash == hash ? meshCache.erase(it) : std::next(it);
+}
+
+void GenericModel::evictTexture(uint64_t hash) {
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    auto found = texByContent.find(hash);
+    if (found == texByContent.end()) return;
+    // Одна заглушка на все пути с этим содержимым
+    auto placeholder = std::make_shared<ppgso::Texture>(std::move(found->second.thumbnail));
+    placeholder->releaseImage();
+    placeholder->setOwner("GenericModel placeholders");
+    texByContent.erase(found);
+    for (auto it = texCache.begin(); it != texCache.end();) {
+        if (it->second.hash != hash) {
+            ++it;
+            continue;
+        }
+        placeholders[it->first] = placeholder;
+        it = texCache.erase(it);
     }
-    if (!texturePath.empty() && texCache.find(texturePath) == texCache.end()) {
-        texCache[texturePath] = std::make_shared<ppgso::Texture>(ppgso::image::loadBMP(texturePath));
+}
+
+void GenericModel::evictArray(uint64_t id) {
+    std::vector<uint64_t> hashes;
+    {
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        for (auto &[hash, shared] : texByContent)
+            if (shared.texture.layer && arrayId(shared.texture.layer->getArray()) == id) hashes.push_back(hash);
     }
+    // С последним слоем уходит и сам массив
+    for (auto hash : hashes) evictTexture(hash);
+}
+
+void GenericModel::printDedupStats(std::ostream &out) {
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2)
+        << "Content dedup: " << dedupStats.meshes << " meshes (+" << dedupStats.meshDuplicates << " shared, "
+        << dedupStats.meshBytesSaved / (1024.0 * 1024.0) << " MB), " << dedupStats.textures << " textures (+"
+        << dedupStats.textureDuplicates << " shared, " << dedupStats.textureBytesSaved / (1024.0 * 1024.0)
+        << " MB), saved " << (dedupStats.meshBytesSaved + dedupStats.textureBytesSaved) / (1024.0 * 1024.0)
+        << " MB VRAM and " << dedupStats.secondsSaved * 1000.0 << " ms of uploads" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void GenericModel::streamMips(size_t uploadBudget) {
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    struct Change {
+        uint64_t hash;
+        SharedTexture *shared;
+        int wanted;
+        bool drawn;
+    };
+    std::vector<Change> finer, coarser;
+    for (auto &[hash, shared] : texByContent) {
+        if (!shared.source) continue;
+        // Грубые уровни остаются всегда, в том числе у текстур вне кадра
+        bool drawn = shared.wantedLevel != NOT_DRAWN;
+        int coarse = coarseLevel(*shared.source);
+        int wanted = std::min(drawn ? shared.wantedLevel : coarse, coarse);
+        int base = shared.texture.texture->getBaseLevel();
+        shared.wantedLevel = NOT_DRAWN;
+        // Пока уровень в пути, уровни текстуры не трогаем
+        if (shared.levelPending) continue;
+        if (wanted < base) finer.push_back({hash, &shared, wanted, drawn});
+        if (wanted > base) coarser.push_back({hash, &shared, wanted, drawn});
+    }
+
+    // Сверх бюджета сначала отдаём тонкие уровни текстур вне кадра, потом дальних, крупные вперёд
+    auto over = [&]() { return residency.gpuBudget && residency.getStats().gpuBytes > residency.gpuBudget; };
+    auto freed = [](const Change &change) {
+        auto &source = *change.shared->source;
+        return ppgso::CompressedImage::byteSize(source.format, source.width, source.height, change.wanted) -
+               ppgso::CompressedImage::byteSize(source.format, source.width, source.height,
+                                                change.shared->texture.texture->getBaseLevel());
+    };
+    std::sort(coarser.begin(), coarser.end(), [&freed](const Change &a, const Change &b) {
+        return a.drawn != b.drawn ? !a.drawn : freed(a) > freed(b);
+    });
+    for (auto &change : coarser) {
+        if (!over()) break;
+        auto &texture = *change.shared->texture.texture;
+        mipStats.levelsDropped += change.wanted - texture.getBaseLevel();
+        mipStats.bytesDropped += freed(change);
+        texture.setBaseLevel(*change.shared->source, change.wanted);
+        residency.resize(change.hash, texture.getBytes());
+    }
+
+    // По уровню за кадр, первыми текстуры, которым не хватает больше всего уровней
+    std::sort(finer.begin(), finer.end(), [](const Change &a, const Change &b) {
+        auto gap = [](const Change &change) { return change.shared->texture.texture->getBaseLevel() - change.wanted; };
+        return gap(a) > gap(b);
+    });
+    size_t uploaded = 0;
+    for (auto &change : finer) {
+        auto &texture = change.shared->texture.texture;
+        auto &source = change.shared->source;
+        int level = texture->getBaseLevel() - 1;
+        size_t bytes = ppgso::CompressedImage::levelBytes(source->format, source->levelWidth(level),
+                                                          source->levelHeight(level));
+        if (uploaded && uploaded + bytes > uploadBudget) break;
+        uploaded += bytes;
+        // Уровень мог перейти в текстуру до того, как cancelStreaming() сбросил загрузчик
+        if (!textureUploader || texture->getLoadedLevel() <= level) {
+            texture->setBaseLevel(*source, level);
+            levelLoaded(change.hash, *texture, bytes);
+            continue;
+        }
+        // Уровень идёт через PBO, семплировать его начинаем только после fence
+        change.shared->levelPending = true;
+        auto hash = change.hash;
+        textureUploader->uploadLevel(texture, source, level,
+                                     [hash, level, bytes](std::shared_ptr<ppgso::Texture> texture) {
+            std::lock_guard<std::mutex> lock{cacheMutex};
+            auto shared = texByContent.find(hash);
+            // Вытесненную за время загрузки текстуру не трогаем
+            if (shared == texByContent.end() || shared->second.texture.texture != texture) return;
+            shared->second.levelPending = false;
+            texture->setBaseLevel(*shared->second.source, level);
+            levelLoaded(hash, *texture, bytes);
+        });
+    }
+}
+
+void GenericModel::levelLoaded(uint64_t hash, const ppgso::Texture &texture, size_t bytes) {
+    residency.resize(hash, texture.getBytes());
+    mipStats.levelsLoaded++;
+    mipStats.bytesLoaded += bytes;
+}
+
+void GenericModel::printMipStats(std::ostream &out) {
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    int textures = 0;
+    size_t resident = 0, full = 0;
+    for (auto &[hash, shared] : texByContent) {
+        if (!shared.source) continue;
+        textures++;
+        resident += shared.texture.texture->getBytes();
+        full += shared.source->byteSize();
+    }
+    double mb = 1024.0 * 1024.0;
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(1) << "Texture mips: " << textures << " streamed textures, "
+        << resident / mb << " of " << full / mb << " MB resident, " << mipStats.levelsLoaded << " levels loaded ("
+        << mipStats.bytesLoaded / mb << " MB), " << mipStats.levelsDropped << " released ("
+        << mipStats.bytesDropped / mb << " MB)" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void GenericModel::preload(const std::vector<std::pair<std::string, std::string>> &assets, ppgso::ThreadPool &pool) {
+    // Хеш содержимого считаем на воркере вместе с декодированием
+    std::vector<std::pair<std::string, std::future<std::pair<uint64_t, ppgso::MeshData>>>> meshJobs;
+    std::vector<std::pair<std::string, std::future<DecodedTexture>>> texJobs;
+
+    // Ставим в очередь только то, чего ещё нет в кэше, каждый файл один раз
+    {
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        std::unordered_set<std::string> queued;
+        for (auto &[mesh, tex] : assets) {
+            if (!meshCache.count(mesh) && queued.insert(mesh).second)
+                meshJobs.emplace_back(mesh, pool.submit([mesh]() {
+                    auto data = loadMesh(mesh);
+                    return std::make_pair(data.contentHash(), std::move(data));
+                }));
+            if (!tex.empty() && !texCache.count(tex) && queued.insert(tex).second)
+                texJobs.emplace_back(tex, pool.submit([tex]() { return decodeTexture(tex); }));
+        }
+    }
+
+    // Загрузка в GPU на потоке контекста, пока воркеры декодируют остальное
+    for (auto &[path, job] : meshJobs) {
+        auto [hash, data] = job.get();
+        cacheMesh(path, hash, data);
+    }
+    for (auto &[path, job] : texJobs) cacheTexture(path, job.get());
+}
+
+void GenericModel::stream(ppgso::AssetStreamer &streamer, const Scene &scene) {
+    // Расстояние от камеры до точки в локальных координатах модели
+    auto distance = [this, &scene](glm::vec3 local) {
+        auto world = glm::vec3(modelMatrix * glm::vec4(local, 1.0f));
+        return glm::distance(scene.camera->position, world);
+    };
+
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    // Вместо текстуры, которую не удалось загрузить, рисуем однотонную цвета Kd
+    if (failed.count(texturePath)) texturePath = solidTextureFor(*material);
+    // Путь не должен навсегда остаться "в полёте", иначе модель молча не появится
+    auto fail = [](const std::string &path) {
+        return [path]() {
+            std::lock_guard<std::mutex> lock{cacheMutex};
+            streaming.erase(path);
+            failed.insert(path);
+        };
+    };
+    if (!meshCache.count(meshPath) && !failed.count(meshPath) && streaming.insert(meshPath).second) {
+        auto path = meshPath;
+        streamer.request([path, distance]() {
+            auto data = std::make_shared<ppgso::MeshData>(loadMesh(path));
+            auto hash = data->contentHash();
+            glm::vec3 min, max;
+            data->bounds(min, max);
+            auto center = (min + max) * 0.5f;
+
+            ppgso::AssetStreamer::Upload upload;
+            upload.bytes = data->byteSize();
+            upload.commit = [path, data, hash]() {
+                cacheMesh(path, hash, *data);
+                std::lock_guard<std::mutex> lock{cacheMutex};
+                streaming.erase(path);
+            };
+            // Геометрия уже в мировых координатах, точнее считать от центра bounding box
+            upload.priority = [distance, center]() { return distance(center); };
+            return upload;
+        }, [distance]() { return distance({0, 0, 0}); }, fail(path));
+    }
+
+    if (!texturePath.empty() && !texCache.count(texturePath) && streaming.insert(texturePath).second) {
+        auto path = texturePath;
+        auto mesh = meshPath;
+        auto priority = [distance, mesh]() {
+            std::lock_guard<std::mutex> lock{cacheMutex};
+            auto bounds = meshBounds.find(mesh);
+            return distance(bounds != meshBounds.end() ? bounds->second.center : glm::vec3{0, 0, 0});
+        };
+        streamer.request([path]() {
+            auto texture = std::make_shared<DecodedTexture>(decodeTexture(path));
+
+            ppgso::AssetStreamer::Upload upload;
+            upload.bytes = texture->texture->byteSize();
+            upload.commit = [path, texture]() {
+                if (textureUploader && !packs(*texture->texture)) {
+                    queueTexture(path, std::move(*texture));
+                    return;
+                }
+                cacheTexture(path, std::move(*texture));
+                std::lock_guard<std::mutex> lock{cacheMutex};
+                streaming.erase(path);
+            };
+            return upload;
+        }, priority, fail(path));
+    }
+}
+
+void GenericModel::cancelStreaming(ppgso::AssetStreamer &streamer) {
+    streamer.clear();
+    if (textureUploader) textureUploader->clear();
+    std::lock_guard<std::mutex> lock{cacheMutex};
+    streaming.clear();
+    uploading.clear();
+    // Сброшенные загрузчиком уровни не вызовут свой callback, streamMips() запросит их заново
+    for (auto &[hash, shared] : texByContent) shared.levelPending = false;
+}
+
+bool GenericModel::resident() const {
+    return meshCache.count(meshPath) && (texturePath.empty() || texCache.count(texturePath));
 }
 
 bool GenericModel::update(Scene &scene, float dt, glm::mat4 parentModelMatrix, glm::vec3 parentRotation) {
@@ -33,51 +574,116 @@ bool GenericModel::update(Scene &scene, float dt, glm::mat4 parentModelMatrix, g
     return true;
 }
 
+float GenericModel::pixelsPerUnit(const Scene &scene, const ppgso::Mesh &mesh) const {
+    // Сфера вокруг bounding box меша в мировых координатах
+    glm::vec3 min, max;
+    mesh.getBounds(min, max);
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((min + max) * 0.5f, 1.0f));
+    float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                            glm::length(glm::vec3(modelMatrix[2]))});
+    float radius = glm::length(max - min) * 0.5f * scale;
+
+    // Ближайшая точка сферы определяет, во сколько пикселей проецируется единица меша
+    glm::vec3 eye = glm::vec3(glm::inverse(scene.camera->viewMatrix)[3]);
+    float distance = std::max(glm::length(eye - center) - radius, 0.1f);
+    return scale * scene.camera->projectionMatrix[1][1] * scene.viewportHeight * 0.5f / distance;
+}
+
+int GenericModel::selectLod(const ppgso::Mesh &mesh, float pixelsPerUnit) {
+    if (!useLods) return 0;
+    return ppgso::selectLod(mesh.getLodErrors(), pixelsPerUnit, lodThreshold, lod);
+}
+
 void GenericModel::render(Scene &scene, GLuint depthMap) {
-    // Активируем шейдер и устанавливаем общие матрицы/текстуры
-    shader->use();
-    shader->setUniform("projection", scene.camera->projectionMatrix);
-    shader->setUniform("view", scene.camera->viewMatrix);
-    shader->setUniform("model", modelMatrix);
+    // Модели вне кадра не рисуем и не отмечаем в residency, их ресурсы первыми уходят из VRAM
+    ppgso::MeshletCuller culler{scene.camera->projectionMatrix, scene.camera->viewMatrix, modelMatrix};
+    auto bounds = meshBounds.find(meshPath);
+    if (bounds != meshBounds.end() && culler.test(bounds->second) == ppgso::MeshletCuller::Outside) return;
 
-    // Set multiple light space matrices
-    shader->setUniform("numShadowMaps", scene.numShadowMaps);
-    for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "lightSpaceMatrix[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, scene.lightSpaceMatrices[i]);
+    // Вытесненное загружаем заново; без меша модель не рисуем, вместо текстуры рисуем заглушку
+    if (!resident()) {
+        if (reloadStreamer)
+            stream(*reloadStreamer, scene);
+        else
+            ensureResources();
     }
-
-    if (!texturePath.empty() && texCache.count(texturePath)) {
-        shader->setUniform("Texture", *texCache[texturePath]);
+    auto cachedMesh = meshCache.find(meshPath);
+    if (cachedMesh == meshCache.end()) return;
+    ppgso::Texture *texture = nullptr;
+    const ppgso::TexturePacker::Layer *layer = nullptr;
+    uint64_t streamedHash = 0;
+    if (!texturePath.empty()) {
+        auto cachedTexture = texCache.find(texturePath);
+        if (cachedTexture != texCache.end()) {
+            texture = cachedTexture->second.texture.get();
+            layer = cachedTexture->second.layer.get();
+            residency.touch(layer ? arrayId(layer->getArray()) : cachedTexture->second.hash);
+            if (texture && mipStreaming) streamedHash = cachedTexture->second.hash;
+        } else {
+            auto placeholder = placeholders.find(texturePath);
+            if (placeholder == placeholders.end()) return;
+            texture = placeholder->second.get();
+        }
     }
+    residency.touch(cachedMesh->second.hash);
 
-    // Shadow maps are already bound by SceneWindow to texture units 1-4
-    shader->setUniform("shadowMap0", 1);
-    shader->setUniform("shadowMap1", 2);
-    shader->setUniform("shadowMap2", 3);
-    shader->setUniform("shadowMap3", 4);
-    shader->setUniform("pointShadowMaps[0]", 5);
-    shader->setUniform("pointShadowMaps[1]", 6);
+    // Активируем шейдер и устанавливаем общие матрицы/текстуры, матрицы теней лежат в блоке Shadows сцены
+    shader->use();
+    uniforms.projection.set(scene.camera->projectionMatrix);
+    uniforms.view.set(scene.camera->viewMatrix);
+    uniforms.model.set(modelMatrix);
+
+    if (texture) {
+        uniforms.texture.set(0);
+        texture->bind(0);
+    }
 
     // scene.renderLight перезаписывает много uniform'ов (включая Transparency),
     // поэтому устанавливаем Transparency после него
     scene.renderLight(shader, true);
 
-    // Устанавливаем прозрачность ПОСЛЕ renderLight
-    float transp = transparent ? 0.25f : 1.0f;
-    shader->setUniform("Transparency", transp);
+    // Устанавливаем прозрачность ПОСЛЕ renderLight: d из MTL, но не прозрачнее 0.25 (как раньше у стекла)
+    float transp = transparent ? (material->opacity < 1.0f ? std::max(material->opacity, 0.25f) : 0.25f) : 1.0f;
+    uniforms.transparency.set(transp);
+    // Соседние модели с тем же массивом не перепривязывают текстуру, меняется только номер слоя
+    if (layer) {
+        layer->getArray().bind(TEXTURE_ARRAY_UNIT);
+        uniforms.textureLayer.set(layer->getIndex());
+    }
 
-    if (meshCache.count(meshPath)) meshCache[meshPath]->render();
+    auto &mesh = *cachedMesh->second.mesh;
+    float pixels = pixelsPerUnit(scene, mesh);
+    lod = selectLod(mesh, pixels);
+    if (streamedHash) {
+        // Самый грубый уровень, у которого на пиксель экрана ещё приходится не меньше тексела
+        std::lock_guard<std::mutex> lock{cacheMutex};
+        auto shared = texByContent.find(streamedHash);
+        auto density = uvDensity.find(meshPath);
+        if (shared != texByContent.end() && shared->second.source) {
+            auto &source = *shared->second.source;
+            float texels = density != uvDensity.end() ? density->second * std::max(source.width, source.height) : 0.0f;
+            int level = source.levels - 1;
+            if (texels > 0.0f) level = texels > pixels ? (int) std::floor(std::log2(texels / pixels)) : 0;
+            shared->second.wantedLevel = std::min(shared->second.wantedLevel, std::min(level, source.levels - 1));
+        }
+    }
+    if (cullMeshlets)
+        mesh.render(lod, culler);
+    else
+        mesh.render(lod);
+}
+
+GLuint GenericModel::renderKey() const {
+    auto cachedTexture = texCache.find(texturePath);
+    if (cachedTexture == texCache.end() || !cachedTexture->second.layer) return 0;
+    return cachedTexture->second.layer->getArray().getTexture();
 }
 
 void GenericModel::renderForShadow(Scene &scene) {
-    GLint currentProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    GLint locModel = glGetUniformLocation(static_cast<GLuint>(currentProgram), "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
-    if (meshCache.count(meshPath)) meshCache[meshPath]->render();
+    scene.shadowModelMatrix.set(modelMatrix);
+    // Тени не отмечают меш в residency: иначе отбрасывающие тень модели вне кадра никогда бы не вытеснялись
+    auto cachedMesh = meshCache.find(meshPath);
+    if (cachedMesh != meshCache.end()) cachedMesh->second.mesh->render(lod);
 }
 
 void GenericModel::renderForShadow(Scene &scene, GLuint) {
@@ -3,8 +3,11 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <mutex>
 #include <filesystem>
+#include <ostream>
 #include <ppgso/ppgso.h>
 #include "object.h"
 #include "scene.h"
@@ -24,7 +27,12 @@ public:
 
 class GenericModel : public Object {
 public:
-    GenericModel(Object* parent, const std::string &meshFile, const std::string &texFile);
+    /*!
+     * @param material - Resolved material, untextured ones are drawn with a solid texture of their diffuse color.
+     * @param loadNow - Load mesh and texture right away, when false they have to be streamed in with stream().
+     */
+    GenericModel(Object* parent, const std::string &meshFile, std::shared_ptr<const ppgso::Material> material,
+                 bool loadNow = true);
 
     bool update(Scene &scene, float dt, glm::mat4 parentModelMatrix, glm::vec3 parentRotation) override;
     void render(Scene &scene, GLuint depthMap) override;
@@ -33,14 +41,237 @@ public:
 
     // Добавлено: реализация чисто-виртуального метода базового класса
     void checkCollisions(Scene &scene, float dt) override;
+
+    /*!
+     * Decode meshes and textures of many models in parallel and fill the shared caches.
+     * Parsing and image decoding run on the pool workers, GL buffers and textures are created
+     * on the calling thread, which must own the OpenGL context.
+     *
+     * @param assets - Pairs of mesh and texture paths (texture may be empty).
+     * @param pool - Worker pool used for decoding.
+     */
+    static void preload(const std::vector<std::pair<std::string, std::string>> &assets, ppgso::ThreadPool &pool);
+
+    /*!
+     * Queue mesh and texture of this model for progressive loading, nearest to the camera first.
+     * The model is skipped during rendering until both are resident. A texture which fails to load is replaced by
+     * the solid diffuse color of the material, a model whose mesh fails is skipped without loading it again.
+     *
+     * @param streamer - Streamer pumped once per frame by the render loop.
+     * @param scene - Scene whose camera decides the loading order.
+     */
+    void stream(ppgso::AssetStreamer &streamer, const Scene &scene);
+
+    /*!
+     * Drop everything queued by stream() and mip levels queued by streamMips(), call before destroying models which
+     * are still streaming.
+     *
+     * @param streamer - Streamer used with stream().
+     */
+    static void cancelStreaming(ppgso::AssetStreamer &streamer);
+
+    /*!
+     * Check whether the mesh and texture are loaded.
+     */
+    bool resident() const;
+
+    /*!
+     * Get the texture a material is drawn with, the key of a solid diffuse color texture when it is untextured.
+     *
+     * @param material - Resolved material.
+     */
+    static std::string textureFor(const ppgso::Material &material);
+
+    /*!
+     * Print how many meshes and textures were shared by content and the VRAM and upload time this saved.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printDedupStats(std::ostream &out);
+
+    /*!
+     * Upload meshes with quantized vertices and 16bit attributes, decoded by the phong and shadow shaders.
+     */
+    static bool compactVertices;
+
+    /*!
+     * Render simplified mesh levels once their error projects below lodThreshold pixels.
+     */
+    static bool useLods;
+
+    /*!
+     * Largest allowed screen space error of a simplified level in pixels.
+     */
+    static float lodThreshold;
+
+    /*!
+     * Skip meshlets outside the view frustum or facing away from the camera in the main pass.
+     */
+    static bool cullMeshlets;
+
+    /*!
+     * Baked asset pack resolving mesh and texture paths by name, loose files are used when null or for missing names.
+     */
+    static std::shared_ptr<ppgso::AssetPack> assetPack;
+
+    /*!
+     * Meshes and textures by content hash, touched when a model inside the view frustum is drawn.
+     * Call residency.endFrame() after the frame is drawn to evict what does not fit its budget.
+     */
+    static ppgso::ResidencyManager residency;
+
+    /*!
+     * Streamer reloading evicted meshes and textures of visible models, they are loaded synchronously when null.
+     */
+    static ppgso::AssetStreamer *reloadStreamer;
+
+    /*!
+     * Uploader of streamed textures, models keep their placeholder until the upload finished.
+     * Streamed textures are created synchronously in the streamer commit when null.
+     */
+    static ppgso::TextureUploader *textureUploader;
+
+    /*!
+     * Packer placing textures of the same shape into layers of shared texture arrays, opaque models using one array
+     * are drawn one after another. Packed textures bypass textureUploader. Every texture gets its own when null.
+     * Residency accounts and evicts each array as a whole, with the full capacity it allocates.
+     */
+    static ppgso::TexturePacker *texturePacker;
+
+    /*!
+     * Load textures larger than 128 pixels with their coarse levels only, finer levels follow once models draw them
+     * large enough on screen. Such textures are not packed, their levels go through textureUploader when it is set.
+     */
+    static bool mipStreaming;
+
+    /*!
+     * Load finer levels of textures whose models need more texels than are resident, call once per frame after the
+     * scene is drawn and before residency.endFrame(). Levels are queued on textureUploader one at a time per texture
+     * and sampled once their transfer finished, without it they are uploaded synchronously. While residency is over
+     * its budget, levels finer than needed are released first from textures not drawn in the frame.
+     *
+     * @param uploadBudget - Bytes of levels queued per frame, at least one level is queued when any is needed.
+     */
+    static void streamMips(size_t uploadBudget);
+
+    /*!
+     * Print GPU memory of streamed textures against their full mip chains and the levels loaded and released.
+     *
+     * @param out - Stream to print to.
+     */
+    static void printMipStats(std::ostream &out);
+
+    /*!
+     * Models with textures in the same array share the key, 0 when the texture has its own binding.
+     */
+    GLuint renderKey() const override;
 private:
     std::string meshPath;
-    std::string texturePath;
+    std::string texturePath;   // Путь/имя текстуры или "#rrggbb" для однотонного материала
+    std::shared_ptr<const ppgso::Material> material;
+    int lod = 0; // Уровень детализации прошлого кадра, тот же рисуется и в тени
+
+    // Кэш мешей/текстур/шейдера, хеш содержимого — id ресурса в residency
+    struct CachedMesh {
+        std::shared_ptr<ppgso::Mesh> mesh;
+        uint64_t hash;
+    };
+    // Текстура либо своя, либо слой общего массива из texturePacker
+    struct CachedTexture {
+        std::shared_ptr<ppgso::Texture> texture;
+        std::shared_ptr<ppgso::TexturePacker::Layer> layer;
+        uint64_t hash;
 
-    // Кэш мешей/текстур/шейдера
-    static std::unordered_map<std::string, std::shared_ptr<ppgso::Mesh>> meshCache;
-    static std::unordered_map<std::string, std::shared_ptr<ppgso::Texture>> texCache;
+        size_t getBytes() const { return layer ? layer->getBytes() : texture->getBytes(); }
+    };
+    static std::unordered_map<std::string, CachedMesh> meshCache;
+    static std::unordered_map<std::string, CachedTexture> texCache;
     static std::unique_ptr<ppgso::Shader> shader;
+    // Uniform'ы шейдера, найденные один раз при его создании
+    struct ShaderUniforms {
+        ppgso::Uniform<glm::mat4> projection, view, model;
+        ppgso::Uniform<int> texture, textureLayer;
+        ppgso::Uniform<float> transparency;
+    };
+    static ShaderUniforms uniforms;
+    static void createShader();
+    static std::mutex cacheMutex;
+    // Ресурсы, поставленные в очередь стриминга, и ограничивающие сферы загруженных мешей (остаются после вытеснения)
+    static std::unordered_set<std::string> streaming;
+    // Пути, которые не удалось загрузить стримером, больше не запрашиваются
+    static std::unordered_set<std::string> failed;
+    static std::unordered_map<std::string, ppgso::Meshlet> meshBounds;
+    // Плотность текстурных координат мешей, по ней выбирается нужный мип-уровень
+    static std::unordered_map<std::string, float> uvDensity;
+    // Уменьшенные копии вытесненных текстур, рисуются, пока текстура грузится заново
+    static std::unordered_map<std::string, std::shared_ptr<ppgso::Texture>> placeholders;
+    // Пути, ждущие текстуру с этим хешем из textureUploader
+    static std::unordered_map<uint64_t, std::vector<std::string>> uploading;
+
+    // GPU-ресурсы по хешу декодированного содержимого: одинаковые файлы делят один буфер/текстуру
+    struct SharedMesh {
+        std::shared_ptr<ppgso::Mesh> mesh;
+        double uploadSeconds;
+    };
+    struct SharedTexture {
+        CachedTexture texture;
+        double uploadSeconds;
+        ppgso::Image thumbnail;     // Заглушка на время повторной загрузки, пиксели самой текстуры на CPU не храним
+        ppgso::MemoryTracker::Allocation thumbnailMemory;
+        // Все уровни текстуры с мип-стримингом, у остальных пусто
+        std::shared_ptr<const ppgso::CompressedImage> source;
+        int wantedLevel;            // Самый тонкий уровень, нужный моделям в текущем кадре
+        bool levelPending;          // Следующий уровень ещё в textureUploader
+    };
+    struct DedupStats {
+        int meshes = 0, meshDuplicates = 0;
+        int textures = 0, textureDuplicates = 0;
+        size_t meshBytesSaved = 0, textureBytesSaved = 0;
+        double secondsSaved = 0.0;
+    };
+    static std::unordered_map<uint64_t, SharedMesh> meshByContent;
+    static std::unordered_map<uint64_t, SharedTexture> texByContent;
+    static DedupStats dedupStats;
+    struct MipStats {
+        int levelsLoaded = 0, levelsDropped = 0;
+        size_t bytesLoaded = 0, bytesDropped = 0;
+    };
+    static MipStats mipStats;
+    // Под cacheMutex, когда уровень начали семплировать
+    static void levelLoaded(uint64_t hash, const ppgso::Texture &texture, size_t bytes);
+    // Хеши текстур, уже хоть раз упакованных в массив, чтобы повторная загрузка не считалась новой текстурой
+    static std::unordered_set<uint64_t> packedTextures;
+
+    // Текстура со всеми уровнями mipmap (RGB8 или BC) и заглушкой из её мелкого уровня
+    struct DecodedTexture {
+        std::shared_ptr<const ppgso::CompressedImage> texture;
+        ppgso::Image preview{0, 0};
+        uint64_t hash = 0;
+    };
+
+    // Только на потоке OpenGL контекста, hash считается заранее на воркере
+    static std::shared_ptr<ppgso::Mesh> shareMesh(uint64_t hash, const ppgso::MeshData &data);
+    static CachedTexture shareTexture(DecodedTexture &&decoded);
+    static void addTexture(const CachedTexture &texture, ppgso::Image &&preview, double uploadSeconds,
+                           std::shared_ptr<const ppgso::CompressedImage> source = nullptr);
+    // Через textureUploader, путь попадает в texCache, когда текстуру можно привязать
+    static void queueTexture(const std::string &path, DecodedTexture &&decoded);
+    static void cacheMesh(const std::string &path, uint64_t hash, const ppgso::MeshData &data);
+    static void cacheTexture(const std::string &path, DecodedTexture &&decoded);
+    // Вызываются residency из endFrame(), убирают ресурс из всех кэшей
+    static void evictMesh(uint64_t hash);
+    static void evictTexture(uint64_t hash);
+    // Упакованные текстуры вытесняются всем массивом: его память занята целиком, пока жив хоть один слой
+    static void evictArray(uint64_t id);
+    // Из пакета, если он открыт и содержит имя, иначе с диска; безопасно на воркерах
+    static ppgso::MeshData loadMesh(const std::string &path);
+    static ppgso::Image loadImage(const std::string &path);
+    static DecodedTexture decodeTexture(const std::string &path);
+    // Ключ "#rrggbb" однотонной текстуры цвета Kd
+    static std::string solidTextureFor(const ppgso::Material &material);
 
     void ensureResources();
+    // Пиксели экрана на единицу меша в ближайшей к камере точке ограничивающей сферы
+    float pixelsPerUnit(const Scene &scene, const ppgso::Mesh &mesh) const;
+    int selectLod(const ppgso::Mesh &mesh, float pixelsPerUnit);
 };
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <vector>
 #include <array>
+#include <chrono>
 #include <ppgso/shader.h>
 #include <ppgso/ppgso.h>
 #include <filesystem>
@@ -40,6 +41,28 @@ private:
     float ratio = 1.0f;
     float loadTime = -1.f;
 
+    // Прогрессивная загрузка: земля и skybox видны сразу, модели подгружаются по мере декодирования
+    bool streamScene = true;
+    bool streamReported = false;
+    ppgso::AssetStreamer streamer{ppgso::ThreadPool::shared(), {8 * 1024 * 1024, 0.002}};
+    // Текстуры идут в GPU через кольцо из 4 PBO по 4 MB (самые большие текстуры сцены 1024x1024), без ожидания в кадре
+    ppgso::TextureUploader uploader{ppgso::ThreadPool::shared(), 4, 4 * 1024 * 1024};
+    // Текстуры одного размера делят массив до 32 MB, соседние модели рисуются без перепривязки текстуры
+    ppgso::TexturePacker packer{32 * 1024 * 1024};
+    // Бюджет VRAM мешей и текстур моделей: не видимое в кадре вытесняется и подгружается заново стримером
+    size_t vramBudget = 64 * 1024 * 1024;
+    std::unique_ptr<ppgso::MaterialLibrary> materials;
+
+    // Сколько треугольников уходит в GPU, печатается каждые 5 секунд (L переключает LOD, C отсечение meshlet'ов)
+    size_t trianglesShadow = 0, trianglesMain = 0;
+    ppgso::MeshBase::CullStats meshletsCulled;
+    size_t vertexArrayBinds = 0;
+    size_t textureArrayBinds = 0;
+    // Время CPU на основной проход, вызовы GL шейдеров считает ppgso::Shader
+    double mainPassSeconds = 0.0;
+    int triangleFrames = 0;
+    float triangleReportTime = 0.f;
+
     int size_x, size_y;
 
     // Shadow mapping - support for multiple shadow maps
@@ -51,6 +74,8 @@ private:
     GLuint pointShadowMapFBOs[NUM_POINT_SHADOW_MAPS] = {0};
     GLuint pointShadowMaps[NUM_POINT_SHADOW_MAPS] = {0};
     const int POINT_SHADOW_SIZE = SHADOW_SIZE;
+    // GL_DEPTH_COMPONENT без размера, драйверы обычно хранят 4 байта на тексель
+    ppgso::MemoryTracker::Allocation shadowMemory, pointShadowMemory;
     // Общий шейдер для рендера теней (depth)
     std::unique_ptr<ppgso::Shader> shadowShader;
 
@@ -137,6 +162,8 @@ private:
 
         glBindTexture(GL_TEXTURE_2D, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        shadowMemory = {ppgso::MemoryTracker::Category::RenderTarget, "Shadow maps",
+                        (size_t) NUM_SHADOW_MAPS * SHADOW_SIZE * SHADOW_SIZE * 4};
     }
 
     void createPointShadowResources() {
@@ -163,11 +190,20 @@ private:
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        pointShadowMemory = {ppgso::MemoryTracker::Category::RenderTarget, "Point shadow cubemaps",
+                             (size_t) NUM_POINT_SHADOW_MAPS * 6 * POINT_SHADOW_SIZE * POINT_SHADOW_SIZE * 4};
     }
 
     // === Add table with random chairs and glasses ===
 
     void initScene() {
+        // Модели, которые ещё стримятся, сейчас будут удалены
+        GenericModel::cancelStreaming(streamer);
+        streamReported = false;
+        GenericModel::residency.gpuBudget = vramBudget;
+        GenericModel::reloadStreamer = &streamer;
+        GenericModel::textureUploader = &uploader;
+        GenericModel::texturePacker = &packer;
         scene.rootObjects.clear();
 
         // === Main light ===
@@ -249,128 +285,132 @@ private:
         fs::path collectionDir = "D:/ppgso-public/data/Collection"; // or adjust to "D:/ppgso-public/data/Collection"
         fs::path texDir = "D:/ppgso-public/data/tex";
 
-        // helpers
-
-// Заменить существующий lambda findTextureFor на этот в `src/playground/SceneWindow.hpp`
-auto findTextureFor = [&](const std::string &baseName)->std::pair<std::string,bool> {
-    auto toLower = [](const std::string &s){
-        std::string out = s;
-        std::transform(out.begin(), out.end(), out.begin(), ::tolower);
-        return out;
-    };
-
-    std::string baseLower = toLower(baseName);
-    bool transparent = baseLower.find("glass") != std::string::npos;
-
-    if (!fs::exists(texDir)) return {std::string(), transparent};
-
-    // Разбиваем имя на токены по любым не-алфанумерным символам
-    std::vector<std::string> tokens;
-    std::string cur;
-    for (char ch : baseLower) {
-        if (std::isalnum((unsigned char)ch)) cur.push_back(ch);
-        else {
-            if (!cur.empty()) { tokens.push_back(cur); cur.clear(); }
-        }
-    }
-    if (!cur.empty()) tokens.push_back(cur);
-
-    // дополнительно добавить полное имя как токен
-    if (!baseLower.empty()) tokens.insert(tokens.begin(), baseLower);
-
-    int bestScore = 0;
-    fs::path bestPath;
-
-    for (auto &p : fs::directory_iterator(texDir)) {
-        if (!p.is_regular_file()) continue;
-        std::string stem = toLower(p.path().stem().string());      // имя без расширения
-        std::string fname = toLower(p.path().filename().string()); // полное имя файла
-
-        for (const auto &t : tokens) {
-            if (stem == t
-                || stem == t + "_base"
-                || stem == t + "_basecolor"
-                || stem == t + "basecolor"
-                || stem == t + "_albedo"
-                || stem == t + "albedo") {
-                bestPath = p.path();
-                bestScore = 100;
-                break;
-            }
-            if (stem.find(t + "_base") != std::string::npos
-                || stem.find(t + "base") != std::string::npos
-                || stem.find(t + "_albedo") != std::string::npos) {
-                if (bestScore < 90) { bestScore = 90; bestPath = p.path(); }
-            }
-            else if (stem.find(t) != std::string::npos) {
-                if (bestScore < 50) { bestScore = 50; bestPath = p.path(); }
+        // Пакет от ppgso_bake рядом с папками: один mmap и оглавление вместо обхода директорий и тысяч open()
+        fs::path packPath = collectionDir.parent_path() / "assets.pack";
+        if (!GenericModel::assetPack && fs::exists(packPath)) {
+            try {
+                GenericModel::assetPack = ppgso::AssetPack::open(packPath.string());
+                std::cout << "Asset pack " << packPath.string() << ": "
+                          << GenericModel::assetPack->size() / (1024.0 * 1024.0) << " MB mapped" << std::endl;
+            } catch (std::exception &e) {
+                std::cout << e.what() << ", loading loose files" << std::endl;
             }
-            else if (fname.find(t) != std::string::npos) {
-                if (bestScore < 10) { bestScore = 10; bestPath = p.path(); }
+        }
+        auto &pack = GenericModel::assetPack;
+        using AssetType = ppgso::AssetPack::Type;
+
+        // Материалы из MTL рядом с OBJ: каждый файл парсится один раз, текстура ищется по индексу имён,
+        // который строится один раз из имён пакета ("tex/...") или одного обхода texDir
+        if (!materials) {
+            std::vector<std::string> textureFiles;
+            if (pack) {
+                // Текстуры с готовыми mipmap'ами или, в старых пакетах, просто пиксели
+                for (auto type : {AssetType::Texture, AssetType::Image})
+                    for (auto &name : pack->list(type, "tex/"))
+                        if (name.find('/', 4) == std::string::npos) textureFiles.push_back(name);
+            } else if (fs::exists(texDir)) {
+                for (auto &p : fs::directory_iterator(texDir))
+                    if (p.is_regular_file()) textureFiles.push_back(p.path().string());
             }
+            std::sort(textureFiles.begin(), textureFiles.end());
+            textureFiles.erase(std::unique(textureFiles.begin(), textureFiles.end()), textureFiles.end());
+            materials = std::make_unique<ppgso::MaterialLibrary>(pack);
+            materials->indexTextures(textureFiles);
         }
-        if (bestScore == 100) break;
-    }
-
-    if (bestScore > 0) return { bestPath.string(), transparent };
-
-    // FALLBACK: если ничего не найдено, использовать глобальную текстуру
-    fs::path fallback = texDir / "default_baseColor.bmp"; // <- поместите здесь запасную текстуру
-    if (fs::exists(fallback)) return { fallback.string(), transparent };
-
-    return { std::string(), transparent };
-};
-
 
         // карта групп по пути (относительный к collectionDir)
         std::unordered_map<std::string, Group*> groupMap;
         // Помещаем корневую группу
         groupMap["."] = nullptr;
 
-        if (fs::exists(collectionDir)) {
-            // Сначала создаём группы для всех директорий
-            for (auto &entry : fs::recursive_directory_iterator(collectionDir)) {
-                if (entry.is_directory()) {
-                    std::string rel = std::filesystem::relative(entry.path(), collectionDir).string();
-                    Group* parentG = nullptr;
-                    auto parentPath = entry.path().parent_path();
-                    if (parentPath != collectionDir && fs::exists(parentPath)) {
-                        std::string relParent = std::filesystem::relative(parentPath, collectionDir).string();
-                        if (groupMap.count(relParent)) parentG = groupMap[relParent];
-                    }
-                    // создаём группу и добавляем в сцену/родителя
-                    auto gptr = std::make_unique<Group>(parentG);
-                    // позиционируем по глубине для наглядности
-                    int depth = std::distance(collectionDir.begin(), entry.path().begin()) - std::distance(collectionDir.begin(), collectionDir.begin());
-                    gptr->position = glm::vec3(0.f, 0.0f, 0.0f);
-                    Group* raw = gptr.get();
-                    if (parentG) {
-                        // добавляем как дочерний объект (через rootObjects — объект будет иметь parent pointer)
-                        scene.rootObjects.push_back(std::move(gptr)); // если нужна полная иерархия должна использоваться специализированная система; упрощённо держим в root
-                    } else {
-                        scene.rootObjects.push_back(std::move(gptr));
-                    }
-                    groupMap[rel] = raw;
+        // Папки и модели относительно collectionDir: из оглавления пакета или одним обходом диска
+        std::vector<fs::path> folders, models;
+        if (pack) {
+            std::unordered_set<std::string> seen;
+            auto names = pack->list(AssetType::Mesh, "Collection/");
+            std::sort(names.begin(), names.end());
+            for (auto &name : names) {
+                fs::path rel = fs::path(name).lexically_relative("Collection");
+                // Родительские папки модели, сначала верхние
+                fs::path folder;
+                for (auto it = rel.begin(); std::next(it) != rel.end(); ++it) {
+                    folder /= *it;
+                    if (seen.insert(folder.string()).second) folders.push_back(folder);
                 }
+                models.push_back(rel);
             }
-
-            // Теперь перебираем файлы .obj и создаём GenericModel
-            std::unordered_map<std::string,int> folderIndex;
+        } else if (fs::exists(collectionDir)) {
             for (auto &entry : fs::recursive_directory_iterator(collectionDir)) {
-                if (!entry.is_regular_file()) continue;
-                if (entry.path().extension() != ".obj" && entry.path().extension() != ".OBJ") continue;
+                if (entry.is_directory()) folders.push_back(entry.path().lexically_relative(collectionDir));
+                else if (entry.is_regular_file() && (entry.path().extension() == ".obj" || entry.path().extension() == ".OBJ"))
+                    models.push_back(entry.path().lexically_relative(collectionDir));
+            }
+        }
 
-                auto parent = entry.path().parent_path();
-                std::string relParent = ".";
-                if (parent != collectionDir) relParent = std::filesystem::relative(parent, collectionDir).string();
+        if (!models.empty()) {
+            // Сначала создаём группы для всех директорий
+            for (auto &folder : folders) {
+                Group* parentG = nullptr;
+                std::string relParent = folder.parent_path().string();
+                if (!relParent.empty() && groupMap.count(relParent)) parentG = groupMap[relParent];
+                // создаём группу и добавляем в сцену (объект хранит parent pointer, иерархия упрощённо в root)
+                auto gptr = std::make_unique<Group>(parentG);
+                gptr->position = glm::vec3(0.f, 0.0f, 0.0f);
+                groupMap[folder.string()] = gptr.get();
+                scene.rootObjects.push_back(std::move(gptr));
+            }
+
+            // Теперь перебираем файлы .obj и собираем список моделей
+            struct PendingModel {
+                std::string mesh;
+                std::shared_ptr<const ppgso::Material> material;
+                std::string texture;
+                bool transparent;
+                std::string relParent;
+                Group* parentGroup;
+            };
+            std::vector<PendingModel> pending;
+            for (auto &rel : models) {
+                std::string relParent = rel.parent_path().empty() ? "." : rel.parent_path().string();
 
                 Group* parentGroup = nullptr;
                 if (groupMap.count(relParent)) parentGroup = groupMap[relParent];
 
-                std::string base = entry.path().stem().string();
-                auto [tex, transparent] = findTextureFor(base);
+                fs::path mtl = rel;
+                mtl.replace_extension(".mtl");
+                auto material = materials->resolve(pack ? "Collection/" + mtl.generic_string() : (collectionDir / mtl).string());
 
-                auto modelPtr = std::make_unique<GenericModel>(parentGroup, entry.path().string(), tex);
+                // Полупрозрачный по d из MTL или стекло по имени модели/материала, как раньше
+                auto isGlass = [](std::string name) {
+                    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                    return name.find("glass") != std::string::npos;
+                };
+                bool transparent = material->opacity < 1.0f || isGlass(rel.stem().string()) || isGlass(material->name);
+
+                std::string mesh = pack ? "Collection/" + rel.generic_string() : (collectionDir / rel).string();
+                pending.push_back({mesh, material, GenericModel::textureFor(*material), transparent, relParent, parentGroup});
+            }
+            materials->printStats(std::cout);
+
+            // Парсинг OBJ и декодирование BMP параллельно на всех ядрах, в GPU грузим на этом потоке
+            if (!streamScene) {
+                std::vector<std::pair<std::string, std::string>> assets;
+                assets.reserve(pending.size());
+                for (auto &p : pending) assets.emplace_back(p.mesh, p.texture);
+
+                auto &pool = ppgso::ThreadPool::shared();
+                double preloadStart = glfwGetTime();
+                GenericModel::preload(assets, pool);
+                std::cout << "Preloaded " << assets.size() << " models on " << pool.size() << " threads in "
+                          << (glfwGetTime() - preloadStart) * 1000.0 << " ms" << std::endl;
+            }
+
+            // Создаём GenericModel, ресурсы уже в кэше или будут подгружены стримером
+            std::unordered_map<std::string,int> folderIndex;
+            for (auto &p : pending) {
+                const std::string &relParent = p.relParent;
+                bool transparent = p.transparent;
+                auto modelPtr = std::make_unique<GenericModel>(p.parentGroup, p.mesh, p.material, !streamScene);
                 // Размещаем объекты в сетке внутри папки
                 int idx = folderIndex[relParent]++;
                 int perRow = 6;
@@ -380,6 +420,7 @@ auto findTextureFor = [&](const std::string &baseName)->std::pair<std::string,bo
                 }
                 modelPtr->position = glm::vec3(0.0f, 0.0f, 0.f);
                 modelPtr->scale = {1.0f, 1.0f, 1.0f};
+                if (streamScene) modelPtr->stream(streamer, scene);
                 // Если есть parentGroup — всё равно добавляем в rootObjects, parentObject уже установлен
                 scene.rootObjects.push_back(std::move(modelPtr));
             }
@@ -441,6 +482,7 @@ auto findTextureFor = [&](const std::string &baseName)->std::pair<std::string,bo
         ratio = static_cast<float>(width) / static_cast<float>(height);
 
         glViewport(0, 0, width, height);
+        scene.viewportHeight = static_cast<float>(height);
 
         if (scene.camera) {
             float fovRad = (ppgso::PI / 180.0f) * fow;
@@ -472,8 +514,19 @@ public:
         createPointShadowResources();
         // Компилируем общий shadow-шейдер один раз
         shadowShader = std::make_unique<ppgso::Shader>(shadow_vert_glsl, shadow_frag_glsl);
+        scene.shadowModelMatrix = shadowShader->uniform<glm::mat4>("ModelMatrix");
 
+        // Startup time is dominated by mesh loading, compare cold (parsed) and warm (cached) runs
+        double sceneLoadStart = glfwGetTime();
         initScene();
+        std::cout << "Scene loaded in " << (glfwGetTime() - sceneLoadStart) * 1000.0 << " ms" << std::endl;
+        ppgso::MeshCache::printStats(std::cout);
+        ppgso::TextureCache::printStats(std::cout);
+        packer.printStats(std::cout);
+        if (!streamScene) {
+            ppgso::MeshBase::printStats(std::cout);
+            GenericModel::printDedupStats(std::cout);
+        }
 
         glfwSetWindowUserPointer(window, this);
 
@@ -513,6 +566,42 @@ public:
         onResize(SIZE_X, SIZE_Y);
     }
 
+    ~SceneWindow() override {
+        // Что осталось занято к выходу, по категориям и владельцам
+        ppgso::MemoryTracker::printStats(std::cout);
+    }
+
+    void reportTriangles(float time) {
+        triangleFrames++;
+        if (time - triangleReportTime < 5.f) return;
+        std::cout << "Triangles per frame: " << trianglesMain / triangleFrames << " main, "
+                  << trianglesShadow / triangleFrames << " shadow (LOD "
+                  << (GenericModel::useLods ? "on" : "off") << ")" << std::endl;
+        std::cout << "Vertex array binds per frame: " << vertexArrayBinds / triangleFrames << ", texture array binds: "
+                  << textureArrayBinds / triangleFrames << std::endl;
+        auto shaderCalls = ppgso::Shader::getStats();
+        std::cout << "Main pass CPU: " << mainPassSeconds * 1000.0 / triangleFrames << " ms per frame, shader calls: "
+                  << shaderCalls.programBinds / triangleFrames << " glUseProgram ("
+                  << shaderCalls.skippedBinds / triangleFrames << " skipped), "
+                  << shaderCalls.uniformSets / triangleFrames << " glUniform, "
+                  << shaderCalls.namedSets / triangleFrames << " looked up by name" << std::endl;
+        if (GenericModel::cullMeshlets)
+            std::cout << "Meshlets per frame: " << meshletsCulled.tested / triangleFrames << " tested, "
+                      << meshletsCulled.outside / triangleFrames << " outside frustum, "
+                      << meshletsCulled.backFacing / triangleFrames << " back-facing, "
+                      << meshletsCulled.ranges / triangleFrames << " ranges drawn" << std::endl;
+        GenericModel::residency.printStats(std::cout);
+        GenericModel::printMipStats(std::cout);
+        ppgso::MemoryTracker::printTotals(std::cout);
+        trianglesShadow = trianglesMain = 0;
+        vertexArrayBinds = textureArrayBinds = 0;
+        mainPassSeconds = 0.0;
+        ppgso::Shader::resetStats();
+        meshletsCulled = {};
+        triangleFrames = 0;
+        triangleReportTime = time;
+    }
+
     void onIdle() override {
         if (loadTime == -1.f) loadTime = (float) glfwGetTime();
 
@@ -526,6 +615,20 @@ public:
         handleInput(dt);
         scene.update(dt);
 
+        // Загружаем в GPU то, что успело декодироваться, в пределах бюджета кадра
+        streamer.pump();
+        uploader.pump();
+        if (streamer.idle() && uploader.idle() && !streamReported && streamer.getStats().requested > 0) {
+            streamReported = true;
+            streamer.printStats(std::cout);
+            uploader.printStats(std::cout);
+            ppgso::MeshCache::printStats(std::cout);
+            ppgso::TextureCache::printStats(std::cout);
+            packer.printStats(std::cout);
+            ppgso::MeshBase::printStats(std::cout);
+            GenericModel::printDedupStats(std::cout);
+        }
+
 
         // Build list of shadow-casting lights and compute their light space matrices
         // Light indices must match the order in scene.lights
@@ -592,6 +695,12 @@ public:
             }
         }
 
+        ppgso::MeshBase::resetTrianglesSubmitted();
+        ppgso::GeometryArena::resetBindCount();
+        ppgso::GeometryArena::resetBinding(); // между кадрами VAO могли создать загрузчики сцены
+        ppgso::TextureArray::resetBindCount();
+        ppgso::TextureArray::resetBinding();
+
         // PASS 1: Shadow map rendering for each shadow-casting light
         glViewport(0, 0, SHADOW_SIZE, SHADOW_SIZE);
         glDisable(GL_CULL_FACE);
@@ -636,10 +745,15 @@ public:
         }
 
         glUseProgram(0);
+        ppgso::Shader::resetBinding();
         glDisable(GL_POLYGON_OFFSET_FILL);
         glEnable(GL_CULL_FACE);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+        trianglesShadow += ppgso::MeshBase::getTrianglesSubmitted();
+        ppgso::MeshBase::resetTrianglesSubmitted();
+        ppgso::MeshBase::resetCullStats();
+
         // PASS 2: Main scene rendering
         glViewport(0, 0, size_x, size_y);
         glClearColor(.2f, .2f, .3f, 1.0f);
@@ -648,6 +762,7 @@ public:
         if (scene.camera && skybox) {
             glDepthMask(GL_FALSE);
             skybox->render(scene.camera->viewMatrix, scene.camera->projectionMatrix);
+            ppgso::GeometryArena::resetBinding(); // skybox привязывает свой VAO
             glDepthMask(GL_TRUE);
         }
 
@@ -661,7 +776,21 @@ public:
             glBindTexture(GL_TEXTURE_CUBE_MAP, pointShadowMaps[i]);
         }
         std::cout<<scene.camera->position.x << " " << scene.camera->position.y << " " << scene.camera->position.z <<std::endl;
+        auto mainPassStart = std::chrono::steady_clock::now();
         scene.render(shadowMaps, scene.numShadowMaps);
+        mainPassSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - mainPassStart).count();
+        trianglesMain += ppgso::MeshBase::getTrianglesSubmitted();
+        vertexArrayBinds += ppgso::GeometryArena::getBindCount();
+        textureArrayBinds += ppgso::TextureArray::getBindCount();
+        auto culled = ppgso::MeshBase::getCullStats();
+        meshletsCulled.tested += culled.tested;
+        meshletsCulled.outside += culled.outside;
+        meshletsCulled.backFacing += culled.backFacing;
+        meshletsCulled.ranges += culled.ranges;
+        // Кадр нарисован: догружаем нужные уровни текстур, вытесняем давно не рисованное сверх бюджета
+        GenericModel::streamMips(4 * 1024 * 1024);
+        GenericModel::residency.endFrame();
+        reportTriangles(sceneTime);
 
         // Unbind shadow maps
         for (int i = 0; i < NUM_SHADOW_MAPS; ++i) {
@@ -679,7 +808,17 @@ public:
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
             glfwSetWindowShouldClose(window, GLFW_TRUE);
         }
-
+        if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+            GenericModel::useLods = !GenericModel::useLods;
+            std::cout << "LOD " << (GenericModel::useLods ? "on" : "off") << std::endl;
+        }
+        if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+            ppgso::MemoryTracker::printStats(std::cout);
+        }
+        if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+            GenericModel::cullMeshlets = !GenericModel::cullMeshlets;
+            std::cout << "Meshlet culling " << (GenericModel::cullMeshlets ? "on" : "off") << std::endl;
+        }
 
     }
 
@@ -68,6 +68,12 @@ public:
    */
   virtual void render(Scene &scene, GLuint depthMap) = 0;
 
+  /*!
+   * Key by which opaque objects are ordered before rendering, objects sharing GPU state should return the same key
+   * @return 0 when the object has nothing to share
+   */
+  virtual GLuint renderKey() const { return 0; }
+
   /*!
    * Render the object in the scene
    * @param scene
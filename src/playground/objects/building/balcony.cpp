@@ -11,7 +11,6 @@
 
 #include <shader/phong_vert_glsl.h>
 #include <shader/phong_frag_glsl.h>
-#include <glm/gtc/type_ptr.hpp>
 
 
 std::unique_ptr<ppgso::Mesh> Balcony::mesh;
@@ -33,7 +32,10 @@ Balcony::Balcony(Object* parent) {
         shader = std::make_unique<ppgso::Shader>(phong_vert_glsl, phong_frag_glsl);
     }
     if (!texture) {
-        texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("textures/building/Balconies.bmp"));
+        // Мипмапы строятся на CPU, CPU-копия пикселей у текстуры не остаётся
+        texture = std::make_unique<ppgso::Texture>(ppgso::image::buildMipChain(
+            ppgso::image::loadBMP("textures/building/Balconies.bmp")));
+        texture->setOwner("Balcony");
     }
 }
 bool Balcony::update(Scene &scene, float dt,
@@ -51,13 +53,6 @@ void Balcony::render(Scene &scene, GLuint depthMap) {
     shader->setUniform("view", scene.camera->viewMatrix);
     shader->setUniform("model", modelMatrix);
 
-    // Set multiple light space matrices
-    shader->setUniform("numShadowMaps", scene.numShadowMaps);
-    for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "lightSpaceMatrix[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, scene.lightSpaceMatrices[i]);
-    }
-
     // Основная текстура: setUniform сам привязывает её к слоту 0 и устанавливает sampler
     shader->setUniform("Texture", *texture);
 
@@ -75,20 +70,12 @@ void Balcony::render(Scene &scene, GLuint depthMap) {
 
 void Balcony::renderForShadow(Scene &scene) {
     // Общий shadow-шейдер уже активен в PASS 1
-    GLint currentProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    GLint locModel = glGetUniformLocation(static_cast<GLuint>(currentProgram), "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
+    scene.shadowModelMatrix.set(modelMatrix);
     if (mesh) mesh->render();
 }
 
 void Balcony::renderForShadow(Scene &scene, GLuint shadowProgram) {
     // Оставляем для совместимости, но SceneWindow использует renderForShadow(Scene&)
-    GLint locModel = glGetUniformLocation(shadowProgram, "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
+    scene.shadowModelMatrix.set(modelMatrix);
     if (mesh) mesh->render();
 }
\ No newline at end of file
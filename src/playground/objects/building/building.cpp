@@ -5,7 +5,6 @@
 
 #include <shader/phong_vert_glsl.h>
 #include <shader/phong_frag_glsl.h>
-#include <glm/gtc/type_ptr.hpp>
 
 
 std::unique_ptr<ppgso::Mesh> Building::mesh;
@@ -28,7 +27,10 @@ Building::Building(Object* parent) {
         shader = std::make_unique<ppgso::Shader>(phong_vert_glsl, phong_frag_glsl);
     }
     if (!texture) {
-        texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("textures/atlas_building_base.bmp"));
+        // Мипмапы строятся на CPU, CPU-копия пикселей у текстуры не остаётся
+        texture = std::make_unique<ppgso::Texture>(ppgso::image::buildMipChain(
+            ppgso::image::loadBMP("textures/atlas_building_base.bmp")));
+        texture->setOwner("Building");
     }
 }
 bool Building::update(Scene &scene, float dt,
@@ -46,13 +48,6 @@ void Building::render(Scene &scene, GLuint depthMap) {
     shader->setUniform("view", scene.camera->viewMatrix);
     shader->setUniform("model", modelMatrix);
 
-    // Set multiple light space matrices
-    shader->setUniform("numShadowMaps", scene.numShadowMaps);
-    for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "lightSpaceMatrix[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, scene.lightSpaceMatrices[i]);
-    }
-
     // Основная текстура в слоте 0 (привязка выполняется внутри setUniform)
     shader->setUniform("Texture", *texture);
 
@@ -70,19 +65,11 @@ void Building::render(Scene &scene, GLuint depthMap) {
 
 void Building::renderForShadow(Scene &scene) {
     // Общий shadow-шейдер уже активен в PASS 1
-    GLint currentProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    GLint locModel = glGetUniformLocation(static_cast<GLuint>(currentProgram), "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
+    scene.shadowModelMatrix.set(modelMatrix);
     if (mesh) mesh->render();
 }
 
 void Building::renderForShadow(Scene &scene, GLuint shadowProgram) {
-    GLint locModel = glGetUniformLocation(shadowProgram, "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
+    scene.shadowModelMatrix.set(modelMatrix);
     if (mesh) mesh->render();
 }
@@ -2,7 +2,6 @@
 
 #include <shader/phong_vert_glsl.h>
 #include <shader/phong_frag_glsl.h>
-#include <glm/gtc/type_ptr.hpp>
 
 std::unique_ptr<ppgso::Mesh> Plane::mesh;
 std::unique_ptr<ppgso::Shader> Plane::shader;
@@ -21,7 +20,10 @@ Plane::Plane(Object* parent) {
         shader = std::make_unique<ppgso::Shader>(phong_vert_glsl, phong_frag_glsl);
     }
     if (!texture) {
-        texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("textures/ground.bmp"));
+        // Mipmaps are built on the CPU, the texture keeps no copy of the pixels
+        texture = std::make_unique<ppgso::Texture>(ppgso::image::buildMipChain(
+            ppgso::image::loadBMP("textures/ground.bmp")));
+        texture->setOwner("Plane");
     }
 }
 
@@ -38,13 +40,6 @@ void Plane::render(Scene &scene, GLuint depthMap) {
     shader->setUniform("view", scene.camera->viewMatrix);
     shader->setUniform("model", modelMatrix);
 
-    // Set multiple light space matrices
-    shader->setUniform("numShadowMaps", scene.numShadowMaps);
-    for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "lightSpaceMatrix[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, scene.lightSpaceMatrices[i]);
-    }
-
     shader->setUniform("Texture", *texture);
 
     // Shadow maps are already bound by SceneWindow to texture units 1-4
@@ -61,13 +56,8 @@ void Plane::render(Scene &scene, GLuint depthMap) {
 void Plane::renderForShadow(Scene &scene) {
     generateModelMatrix(parentObject ? parentObject->modelMatrix : glm::mat4{1.0f});
 
-    // Use the currently bound shadow shader from SceneWindow (don't call shader_shadow->use())
-    GLint currentProgram = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-    GLint locModel = glGetUniformLocation(static_cast<GLuint>(currentProgram), "ModelMatrix");
-    if (locModel >= 0) {
-        glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    }
+    // Use the shadow shader bound by SceneWindow (don't call shader_shadow->use())
+    scene.shadowModelMatrix.set(modelMatrix);
 
     mesh->render();
 }
@@ -10,9 +10,11 @@ Skybox::Skybox(const std::vector<std::string>& faces)
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
   // Загружаем все 6 граней кубмапы
+  textureMemory = {ppgso::MemoryTracker::Category::Texture, "Skybox"};
   for (unsigned int i = 0; i < faces.size(); i++) {
     auto image = ppgso::image::loadBMP(faces[i]);
     auto& framebuffer = image.getFramebuffer();
+    textureMemory.resize(textureMemory.getBytes() + framebuffer.size() * sizeof(ppgso::Image::Pixel));
 
     glTexImage2D(
       GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
@@ -41,6 +43,7 @@ Skybox::Skybox(const std::vector<std::string>& faces)
   glBindVertexArray(VAO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+  bufferMemory = {ppgso::MemoryTracker::Category::Buffer, "Skybox", sizeof(skyboxVertices)};
 
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
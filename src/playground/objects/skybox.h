@@ -10,6 +10,7 @@ private:
   ppgso::Shader shader;
   GLuint textureID;
   GLuint VAO, VBO;
+  ppgso::MemoryTracker::Allocation textureMemory, bufferMemory;
 
   // Skybox vertices
   float skyboxVertices[108] = {
@@ -1,8 +1,8 @@
 #include "scene.h"
 #include <vector>
 #include <algorithm>
+#include <cstddef>
 
-constexpr int MAX_LIGHTS = 10;
 constexpr glm::vec3 LIGHT_AMBIENT_INTENSITY{0.3f};
 constexpr glm::vec3 LIGHT_DIFFUSE_INTENSITY{0.6f};
 constexpr glm::vec3 LIGHT_SPECULAR_INTENSITY{0.3f};
@@ -10,6 +10,39 @@ constexpr glm::vec3 DEFAULT_MATERIAL_AMBIENT{0.7f};
 constexpr glm::vec3 DEFAULT_MATERIAL_DIFFUSE{0.8f};
 constexpr glm::vec3 DEFAULT_MATERIAL_SPECULAR{0.2f};
 
+// std140 макет блоков Lights и Shadows из phong_frag.glsl и phong_vert.glsl
+namespace {
+    struct LightData {
+        glm::vec3 position;
+        int type;
+        glm::vec3 direction;
+        float cutOff;
+        glm::vec3 color;
+        float outerCutOff;
+        float constant, linear, quadratic, maxDist;
+    };
+
+    struct LightBlock {
+        glm::vec3 viewPos;
+        int numberOfLights;
+        glm::vec4 ambient, diffuse, specular;   // Общие для всех источников, w не используется
+        LightData lights[MAX_LIGHTS];
+    };
+
+    struct ShadowBlock {
+        glm::mat4 lightSpaceMatrix[MAX_SHADOW_MAPS];
+        glm::ivec4 shadowCasterIndices;
+        glm::ivec4 pointShadowCasterIndices;
+        glm::vec4 pointShadowFarPlane;
+        int numShadowMaps;
+        int numPointShadowMaps;
+    };
+
+    static_assert(sizeof(LightData) == 64, "Light must match the std140 layout");
+    static_assert(sizeof(LightBlock) <= 16384, "Lights block must fit the minimal GL_MAX_UNIFORM_BLOCK_SIZE");
+    static_assert(MAX_SHADOW_MAPS == 4 && MAX_POINT_SHADOW_MAPS <= 4, "Shadow indices are packed into ivec4");
+}
+
 // Вспомогательная рекурсивная функция:
 // собирает ВСЕ объекты сцены (включая детей) в два списка – opaque и transparent.
 namespace {
@@ -48,6 +81,8 @@ void Scene::update(float time) {
 }
 
 void Scene::render(GLuint depthMaps[MAX_SHADOW_MAPS], int numMaps) {
+    // Свет и тени одинаковы для всех объектов кадра, заливаем их до первого draw
+    uploadLights();
     // Собираем ВСЕ объекты (включая детей) в два списка
     std::vector<Object*> opaque;
     std::vector<Object*> transparentObjects;
@@ -62,6 +97,11 @@ void Scene::render(GLuint depthMaps[MAX_SHADOW_MAPS], int numMaps) {
     // --- Непрозрачные: depth write ON, blending OFF ---
     glDisable(GL_BLEND);
     glDepthMask(GL_TRUE);
+    // Объекты с текстурой в одном массиве идут подряд, чтобы не перепривязывать текстуру.
+    // stable_sort сохраняет порядок объектов с одинаковым ключом
+    std::stable_sort(opaque.begin(), opaque.end(), [](Object* a, Object* b) {
+        return a->renderKey() < b->renderKey();
+    });
     for (auto* o : opaque) {
         o->render(*this, depthMaps[0]); // Pass first shadow map for backward compatibility
     }
@@ -94,10 +134,11 @@ void Scene::render(GLuint depthMaps[MAX_SHADOW_MAPS], int numMaps) {
     }
 }
 
-// language: cpp
-// Заменить реализацию Scene::renderLight в `src/playground/scene.cpp`
-void Scene::renderLight(std::unique_ptr<ppgso::Shader> &shader, bool) {
-    shader->use();
+void Scene::uploadLights() {
+    if (!lightBuffer) {
+        lightBuffer = std::make_unique<ppgso::UniformBuffer>(sizeof(LightBlock), LIGHTS_BINDING);
+        shadowBuffer = std::make_unique<ppgso::UniformBuffer>(sizeof(ShadowBlock), SHADOWS_BINDING);
+    }
 
     std::vector<Light*> activeLights;
     activeLights.reserve(lights.size() + 1);
@@ -111,60 +152,75 @@ void Scene::renderLight(std::unique_ptr<ppgso::Shader> &shader, bool) {
         activeLights.push_back(mainlight.get());
     }
 
+    // 16 KB, держим вне стека
+    static LightBlock block;
     int count = static_cast<int>(std::min<size_t>(activeLights.size(), static_cast<size_t>(MAX_LIGHTS)));
-    shader->setUniform("numberOfLights", count);
-    
-    // Set number of shadow maps and shadow caster indices
-    shader->setUniform("numShadowMaps", numShadowMaps);
-    shader->setUniform("numPointShadowMaps", numPointShadowMaps);
-    for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "shadowCasterIndices[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, i < numShadowMaps ? shadowCasterIndices[i] : -1);
-    }
-    for (int i = 0; i < MAX_POINT_SHADOW_MAPS; ++i) {
-        std::string uniformName = "pointShadowCasterIndices[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, i < numPointShadowMaps ? pointShadowCasterIndices[i] : -1);
-        uniformName = "pointShadowFarPlane[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, i < numPointShadowMaps ? pointShadowFarPlane[i] : 0.0f);
+    block.viewPos = camera ? camera->position : glm::vec3{0.0f};
+    block.numberOfLights = count;
+    block.ambient = glm::vec4{LIGHT_AMBIENT_INTENSITY, 0.0f};
+    block.diffuse = glm::vec4{LIGHT_DIFFUSE_INTENSITY, 0.0f};
+    block.specular = glm::vec4{LIGHT_SPECULAR_INTENSITY, 0.0f};
+    for (int i = 0; i < count; ++i) {
+        auto* L = activeLights[i];
+        block.lights[i] = {L->position, static_cast<int>(L->type), L->effectiveDirection(), L->cutOff,
+                           L->color, L->outerCutOff, L->constant, L->linear, L->quadratic, L->maxDist};
     }
+    // Заливаем только используемые источники
+    lightBuffer->update(&block, offsetof(LightBlock, lights) + count * sizeof(LightData));
 
-    // Set light space matrices for all shadow-casting lights
+    ShadowBlock shadows;
     for (int i = 0; i < MAX_SHADOW_MAPS; ++i) {
-        std::string uniformName = "lightSpaceMatrix[" + std::to_string(i) + "]";
-        shader->setUniform(uniformName, i < numShadowMaps ? lightSpaceMatrices[i] : glm::mat4(1.0f));
+        shadows.lightSpaceMatrix[i] = i < numShadowMaps ? lightSpaceMatrices[i] : glm::mat4(1.0f);
+        shadows.shadowCasterIndices[i] = i < numShadowMaps ? shadowCasterIndices[i] : -1;
     }
-
-    for (int i = 0; i < count; ++i) {
-        auto* L = activeLights[i];
-        const std::string idx = "lights[" + std::to_string(i) + "]";
-        auto dir = L->effectiveDirection();
-
-        shader->setUniform(idx + ".type", static_cast<int>(L->type));
-        shader->setUniform(idx + ".position", L->position);
-        shader->setUniform(idx + ".direction", dir);
-        shader->setUniform(idx + ".cutOff", L->cutOff);
-        shader->setUniform(idx + ".outerCutOff", L->outerCutOff);
-        shader->setUniform(idx + ".color", L->color);
-        shader->setUniform(idx + ".ambient", LIGHT_AMBIENT_INTENSITY);
-        shader->setUniform(idx + ".diffuse", LIGHT_DIFFUSE_INTENSITY);
-        shader->setUniform(idx + ".specular", LIGHT_SPECULAR_INTENSITY);
-        shader->setUniform(idx + ".constant", L->constant);
-        shader->setUniform(idx + ".linear", L->linear);
-        shader->setUniform(idx + ".quadratic", L->quadratic);
-        shader->setUniform(idx + ".maxDist", L->maxDist);
+    shadows.pointShadowCasterIndices = glm::ivec4{-1};
+    shadows.pointShadowFarPlane = glm::vec4{0.0f};
+    for (int i = 0; i < numPointShadowMaps && i < MAX_POINT_SHADOW_MAPS; ++i) {
+        shadows.pointShadowCasterIndices[i] = pointShadowCasterIndices[i];
+        shadows.pointShadowFarPlane[i] = pointShadowFarPlane[i];
     }
+    shadows.numShadowMaps = numShadowMaps;
+    shadows.numPointShadowMaps = numPointShadowMaps;
+    shadowBuffer->update(&shadows, sizeof(shadows));
+}
 
-    // камера и общие параметры
-    if (camera) shader->setUniform("viewPos", camera->position);
+const Scene::LightUniforms &Scene::lightUniformsFor(const ppgso::Shader &shader) {
+    auto cached = lightUniforms.find(&shader);
+    if (cached != lightUniforms.end()) return cached->second;
+
+    // Блоки света и теней привязываются к общим буферам один раз
+    shader.setUniformBlock("Lights", LIGHTS_BINDING);
+    shader.setUniformBlock("Shadows", SHADOWS_BINDING);
+    LightUniforms u;
+    u.transparency = shader.uniform<float>("Transparency");
+    u.textureOffset = shader.uniform<glm::vec2>("textureOffset");
+    u.textureArray = shader.uniform<int>("TextureArray");
+    u.textureLayer = shader.uniform<int>("TextureLayer");
+    u.materialAmbient = shader.uniform<glm::vec3>("material.ambient");
+    u.materialDiffuse = shader.uniform<glm::vec3>("material.diffuse");
+    u.materialSpecular = shader.uniform<glm::vec3>("material.specular");
+    u.materialShininess = shader.uniform<float>("material.shininess");
+    return lightUniforms.emplace(&shader, u).first->second;
+}
+
+// language: cpp
+// Заменить реализацию Scene::renderLight в `src/playground/scene.cpp`
+void Scene::renderLight(std::unique_ptr<ppgso::Shader> &shader, bool) {
+    shader->use();
+    // Свет, тени и камеру uploadLights() уже залил в общие блоки, здесь только значения объекта по умолчанию
+    auto &u = lightUniformsFor(*shader);
 
-    shader->setUniform("Transparency", 1.0f);
-    shader->setUniform("textureOffset", glm::vec2{0.0f, 0.0f});
+    u.transparency.set(1.0f);
+    u.textureOffset.set(glm::vec2{0.0f, 0.0f});
+    // По умолчанию объект берёт свою Texture, слой массива выставляет только GenericModel
+    u.textureArray.set(TEXTURE_ARRAY_UNIT);
+    u.textureLayer.set(-1);
 
     // материал по умолчанию (объекты могут переопределять)
-    shader->setUniform("material.ambient",  DEFAULT_MATERIAL_AMBIENT);
-    shader->setUniform("material.diffuse",  DEFAULT_MATERIAL_DIFFUSE);
-    shader->setUniform("material.specular", DEFAULT_MATERIAL_SPECULAR);
-    shader->setUniform("material.shininess", 32.0f);
+    u.materialAmbient.set(DEFAULT_MATERIAL_AMBIENT);
+    u.materialDiffuse.set(DEFAULT_MATERIAL_DIFFUSE);
+    u.materialSpecular.set(DEFAULT_MATERIAL_SPECULAR);
+    u.materialShininess.set(32.0f);
 }
 
 
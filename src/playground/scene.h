@@ -5,6 +5,7 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <unordered_map>
 
 #include "object.h"
 #include "camera.h"
@@ -13,6 +14,13 @@
 
 constexpr int MAX_SHADOW_MAPS = 4;
 constexpr int MAX_POINT_SHADOW_MAPS = 2;
+// Юнит 0 - Texture, 1-4 - карты теней, 5-6 - кубические карты теней точечных источников
+constexpr int TEXTURE_ARRAY_UNIT = 7;
+// Источники и тени лежат в std140 блоках, общих для всех phong-шейдеров, и заливаются один раз за кадр.
+// 255 источников по 64 байта с заголовком занимают ровно 16 KB, минимальный GL_MAX_UNIFORM_BLOCK_SIZE
+constexpr int MAX_LIGHTS = 255;
+constexpr GLuint LIGHTS_BINDING = 0;
+constexpr GLuint SHADOWS_BINDING = 1;
 
 class Scene {
 public:
@@ -31,6 +39,7 @@ public:
  bool showBoundingBoxes = false;
  bool showFPS = false;
  float lastFPSOutputTime = 0.f;
+ float viewportHeight = 720.f; // Framebuffer height for projected LOD error
  short scene_id = 0;
 
  // Support for multiple shadow-casting lights
@@ -44,6 +53,24 @@ public:
  // Legacy single light (for backward compatibility)
  glm::mat4 lightProjectionMatrix{1.f};
  glm::mat4 lightViewMatrix{1.f};
+
+ // ModelMatrix общего shadow-шейдера, ищется один раз при его создании в SceneWindow
+ ppgso::Uniform<glm::mat4> shadowModelMatrix;
+
+ // Uniform'ы объекта, которые renderLight сбрасывает к значениям по умолчанию, ищутся один раз для каждого шейдера
+ struct LightUniforms {
+  ppgso::Uniform<float> transparency;
+  ppgso::Uniform<glm::vec2> textureOffset;
+  ppgso::Uniform<int> textureArray, textureLayer;
+  ppgso::Uniform<glm::vec3> materialAmbient, materialDiffuse, materialSpecular;
+  ppgso::Uniform<float> materialShininess;
+ };
+
+private:
+ void uploadLights();
+ const LightUniforms &lightUniformsFor(const ppgso::Shader &shader);
+ std::unordered_map<const ppgso::Shader *, LightUniforms> lightUniforms;
+ std::unique_ptr<ppgso::UniformBuffer> lightBuffer, shadowBuffer;
 };
 
 #endif // _PPGSO_SCENE_H
\ No newline at end of file